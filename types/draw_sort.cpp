@@ -0,0 +1,124 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstring>
+
+#include "types/draw_sort.h"
+
+namespace lak
+{
+    // positive floats compare the same as their bit patterns
+    static inline uint32_t depthBits(float depth)
+    {
+        if (!(depth > 0.0f)) return 0;
+        uint32_t bits;
+        memcpy(&bits, &depth, sizeof(bits));
+        return bits;
+    }
+
+    uint64_t drawSortKey(uint32_t shader, uint32_t textureSet, uint32_t material, float depth, bool blend)
+    {
+        const uint64_t bits = depthBits(depth);
+        if (!blend)
+        {
+            // 0 | shader:10 | textureSet:16 | material:16 | depth:21
+            return ((uint64_t)(shader & 0x3FF) << 53) |
+                ((uint64_t)(textureSet & 0xFFFF) << 37) |
+                ((uint64_t)(material & 0xFFFF) << 21) |
+                (bits >> 10);
+        }
+        // 1 | inverted depth:24 | shader:10 | textureSet:16 | material:13
+        return ((uint64_t)1 << 63) |
+            ((~(bits >> 7) & 0xFFFFFF) << 39) |
+            ((uint64_t)(shader & 0x3FF) << 29) |
+            ((uint64_t)(textureSet & 0xFFFF) << 13) |
+            (uint64_t)(material & 0x1FFF);
+    }
+
+    void radixSort(vector<drawItem_t> *items, vector<drawItem_t> *scratch)
+    {
+        const size_t count = items->size();
+        scratch->resize(count);
+        if (count < 2) return;
+
+        // every pass's histogram in a single read of the keys
+        uint32_t histogram[8][256] = {};
+        for (const drawItem_t &item : *items)
+            for (size_t pass = 0; pass < 8; ++pass)
+                ++histogram[pass][(item.key >> (pass * 8)) & 0xFF];
+
+        drawItem_t *src = items->data();
+        drawItem_t *dst = scratch->data();
+        for (size_t pass = 0; pass < 8; ++pass)
+        {
+            uint32_t *h = histogram[pass];
+            const size_t shift = pass * 8;
+            // every key has the same byte here, nothing would move
+            if (h[(src[0].key >> shift) & 0xFF] == count) continue;
+
+            uint32_t offset = 0;
+            for (size_t b = 0; b < 256; ++b)
+            {
+                const uint32_t c = h[b];
+                h[b] = offset;
+                offset += c;
+            }
+            for (size_t i = 0; i < count; ++i)
+                dst[h[(src[i].key >> shift) & 0xFF]++] = src[i];
+            std::swap(src, dst);
+        }
+
+        if (src != items->data())
+            items->swap(*scratch);
+    }
+
+    void drawState_t::reset()
+    {
+        shader = nullptr;
+        memset(textures, 0, sizeof(textures));
+        activeUnit = 0;
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void drawState_t::useShader(shaderProgram_t &program)
+    {
+        if (shader == &program) return;
+        glUseProgram(program.program);
+        shader = &program;
+        ++shaderChanges;
+    }
+
+    void drawState_t::bindTexture(GLuint unit, texture_t &texture)
+    {
+        if (unit < maxUnits && textures[unit] == texture.tex) return;
+        if (activeUnit != unit)
+        {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            activeUnit = unit;
+        }
+        texture.bind();
+        if (unit < maxUnits) textures[unit] = texture.tex;
+        ++textureChanges;
+    }
+}
@@ -0,0 +1,86 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <vector>
+
+#ifndef LAK_GL_INCLUDE
+#define LAK_GL_INCLUDE <GL/gl3w.h>
+#endif
+#include LAK_GL_INCLUDE
+
+#include "types/shader.h"
+#include "types/texture.h"
+
+#ifndef LAK_DRAW_SORT_H
+#define LAK_DRAW_SORT_H
+
+namespace lak
+{
+    using std::vector;
+
+    struct drawItem_t
+    {
+        uint64_t key;
+        uint32_t index;     // into the caller's own list of draws
+    };
+
+    // opaque draws sort by shader, then texture set, then material, then
+    // front to back. blended draws sort after every opaque draw, back to
+    // front. ids wrap if they don't fit (shader 10 bits, textureSet and
+    // material 16 bits), which only costs some redundant state changes.
+    // depth is the (positive) view space distance
+    uint64_t drawSortKey(uint32_t shader, uint32_t textureSet, uint32_t material, float depth, bool blend);
+
+    // sorts items by key (stable, least significant byte first), scratch is
+    // resized to match items. passes where every key has the same byte are skipped
+    void radixSort(vector<drawItem_t> *items, vector<drawItem_t> *scratch);
+
+    // tracks bound GL state while submitting sorted draws so redundant
+    // glUseProgram/glBindTexture calls (and the glGetIntegerv in
+    // shaderProgram_t::enable) are skipped. call reset() if anything else
+    // may have changed the bindings. units past maxUnits are always rebound
+    struct drawState_t
+    {
+        static constexpr size_t maxUnits = 16;
+        shaderProgram_t *shader = nullptr;
+        GLuint textures[maxUnits] = {};
+        GLuint activeUnit = 0;
+        size_t shaderChanges = 0;
+        size_t textureChanges = 0;
+
+        void reset();
+        void useShader(shaderProgram_t &program);
+        void bindTexture(GLuint unit, texture_t &texture);
+    };
+}
+
+#ifdef LAK_DRAW_SORT_IMPLEM
+#   ifndef LAK_DRAW_SORT_HAS_IMPLEM
+#       define LAK_DRAW_SORT_HAS_IMPLEM
+#       include "types/draw_sort.cpp"
+#   endif // LAK_DRAW_SORT_HAS_IMPLEM
+#endif // LAK_DRAW_SORT_IMPLEM
+
+#endif // LAK_DRAW_SORT_H
@@ -57,9 +57,9 @@ namespace lak
             {
                 struct indices_t
                 {
-                    size_t bufferView;
-                    size_t byteOffset;
-                    GLenum componentType;
+                    size_t bufferView = -1;
+                    size_t byteOffset = 0;
+                    GLenum componentType = GL_UNSIGNED_INT;
                     template<typename ...JT>
                     bool operator=(const json_t<JT...> &json)
                     {
@@ -80,8 +80,8 @@ namespace lak
                 };
                 struct values_t
                 {
-                    size_t bufferView;
-                    size_t byteOffset;
+                    size_t bufferView = -1;
+                    size_t byteOffset = 0;
                     template<typename ...JT>
                     bool operator=(const json_t<JT...> &json)
                     {
@@ -98,7 +98,7 @@ namespace lak
                         json["byteOffset"s] = values.byteOffset;
                     }
                 };
-                size_t count;
+                size_t count = 0;       // 0 if the accessor isn't sparse
                 indices_t indices;
                 values_t values;
                 template<typename ...JT>
@@ -119,10 +119,11 @@ namespace lak
                     json["values"s] = sparce.values;
                 }
             };
-            size_t bufferView;
-            size_t byteOffset;
-            size_t count;
-            GLenum componentType;
+            size_t bufferView = -1;     // -1 if the accessor is all zeros
+            size_t byteOffset = 0;
+            size_t count = 0;
+            GLenum componentType = GL_FLOAT;
+            bool normalized = false;    // integer types map to [0, 1] or [-1, 1]
             string type;
             vector<double> min;
             vector<double> max;
@@ -135,6 +136,7 @@ namespace lak
                 rtn |= json("byteOffset"s, byteOffset);
                 rtn |= json("count"s, count);
                 rtn |= json("componentType"s, componentType);
+                rtn |= json("normalized"s, normalized);
                 rtn |= json("type"s, type);
                 rtn |= json("min"s, min);
                 rtn |= json("max"s, max);
@@ -145,14 +147,18 @@ namespace lak
             friend inline void operator<<(json_t<JT...> &json, const accessor_t &accessor)
             {
                 json = json_object_t<JT...>{};
-                json["bufferView"s] = accessor.bufferView;
-                json["byteOffset"s] = accessor.byteOffset;
+                if (accessor.bufferView != (size_t)-1)
+                {
+                    json["bufferView"s] = accessor.bufferView;
+                    json["byteOffset"s] = accessor.byteOffset;
+                }
                 json["count"s] = accessor.count;
                 json["componentType"s] = accessor.componentType;
+                if (accessor.normalized) json["normalized"s] = accessor.normalized;
                 json["type"s] = accessor.type;
-                json["min"s] = accessor.min;
-                json["max"s] = accessor.max;
-                json["sparse"s] = accessor.sparse;
+                if (!accessor.min.empty()) json["min"s] = accessor.min;
+                if (!accessor.max.empty()) json["max"s] = accessor.max;
+                if (accessor.sparse.count > 0) json["sparse"s] = accessor.sparse;
             }
         };
 
@@ -162,7 +168,7 @@ namespace lak
             {
                 struct target_t
                 {
-                    size_t node;
+                    size_t node = -1;
                     string path;
                     template<typename ...JT>
                     bool operator=(const json_t<JT...> &json)
@@ -176,11 +182,11 @@ namespace lak
                     friend inline void operator<<(json_t<JT...> &json, const target_t &target)
                     {
                         json = json_object_t<JT...>{};
-                        json["node"s] = target.node;
+                        if (target.node != (size_t)-1) json["node"s] = target.node;
                         json["path"s] = target.path;
                     }
                 };
-                size_t sampler;
+                size_t sampler = -1;
                 target_t target;
                 template<typename ...JT>
                 bool operator=(const json_t<JT...> &json)
@@ -200,9 +206,9 @@ namespace lak
             };
             struct sampler_t
             {
-                size_t input;
-                size_t output;
-                string interpolation;
+                size_t input = -1;
+                size_t output = -1;
+                string interpolation = "LINEAR";
                 template<typename ...JT>
                 bool operator=(const json_t<JT...> &json)
                 {
@@ -216,7 +222,7 @@ namespace lak
                 friend inline void operator<<(json_t<JT...> &json, const sampler_t &sampler)
                 {
                     json = json_object_t<JT...>{};
-                    json["inputs"s] = sampler.input;
+                    json["input"s] = sampler.input;
                     json["output"s] = sampler.output;
                     json["interpolation"s] = sampler.interpolation;
                 }
@@ -261,15 +267,16 @@ namespace lak
             friend inline void operator<<(json_t<JT...> &json, const asset_t &asset)
             {
                 json = json_object_t<JT...>{};
-                json["version"] = asset.version;
-                json["generator"] = asset.generator;
-                json["copyright"] = asset.copyright;
+                json["version"s] = asset.version;
+                if (asset.generator != "") json["generator"s] = asset.generator;
+                if (asset.copyright != "") json["copyright"s] = asset.copyright;
             }
         };
 
         struct buffer_t
         {
-            size_t byteLength;
+            size_t byteLength = 0;
+            // use empty string ("") to mark that we're using the GLB binary chunk
             string uri;
             template<typename ...JT>
             bool operator=(const json_t<JT...> &json)
@@ -284,17 +291,73 @@ namespace lak
             {
                 json = json_object_t<JT...>{};
                 json["byteLength"s] = buffer.byteLength;
-                json["uri"s] = buffer.uri;
+                if (buffer.uri != "") json["uri"s] = buffer.uri;
             }
         };
 
         struct bufferView_t
         {
-            size_t buffer;
-            size_t byteLength;
-            size_t byteOffset;
-            size_t byteStride;
-            GLenum target;
+            struct extensions_t
+            {
+                // EXT_meshopt_compression, the view's own buffer is the
+                // (usually uri-less) fallback that the decoded data goes into
+                struct meshopt_t
+                {
+                    size_t buffer = -1;     // -1 if the view isn't compressed
+                    size_t byteOffset = 0;
+                    size_t byteLength = 0;
+                    size_t byteStride = 0;
+                    size_t count = 0;
+                    string mode;            // "ATTRIBUTES", "TRIANGLES" or "INDICES"
+                    string filter = "NONE"; // "NONE", "OCTAHEDRAL", "QUATERNION" or "EXPONENTIAL"
+                    template<typename ...JT>
+                    bool operator=(const json_t<JT...> &json)
+                    {
+                        bool rtn = false;
+                        rtn |= json("buffer"s, buffer);
+                        rtn |= json("byteOffset"s, byteOffset);
+                        rtn |= json("byteLength"s, byteLength);
+                        rtn |= json("byteStride"s, byteStride);
+                        rtn |= json("count"s, count);
+                        rtn |= json("mode"s, mode);
+                        rtn |= json("filter"s, filter);
+                        return rtn;
+                    }
+                    template<typename ...JT>
+                    friend inline void operator<<(json_t<JT...> &json, const meshopt_t &meshopt)
+                    {
+                        json = json_object_t<JT...>{};
+                        json["buffer"s] = meshopt.buffer;
+                        json["byteOffset"s] = meshopt.byteOffset;
+                        json["byteLength"s] = meshopt.byteLength;
+                        json["byteStride"s] = meshopt.byteStride;
+                        json["count"s] = meshopt.count;
+                        json["mode"s] = meshopt.mode;
+                        json["filter"s] = meshopt.filter;
+                    }
+                };
+                meshopt_t meshopt;
+                template<typename ...JT>
+                bool operator=(const json_t<JT...> &json)
+                {
+                    bool rtn = false;
+                    rtn |= json("EXT_meshopt_compression"s, meshopt);
+                    return rtn;
+                }
+                template<typename ...JT>
+                friend inline void operator<<(json_t<JT...> &json, const extensions_t &extensions)
+                {
+                    json = json_object_t<JT...>{};
+                    if (extensions.meshopt.buffer != (size_t)-1)
+                        json["EXT_meshopt_compression"s] = extensions.meshopt;
+                }
+            };
+            size_t buffer = -1;
+            size_t byteLength = 0;
+            size_t byteOffset = 0;
+            size_t byteStride = 0;      // 0 if tightly packed
+            GLenum target = 0;
+            extensions_t extensions;
             template<typename ...JT>
             bool operator=(const json_t<JT...> &json)
             {
@@ -304,6 +367,7 @@ namespace lak
                 rtn |= json("byteOffset"s, byteOffset);
                 rtn |= json("byteStride"s, byteStride);
                 rtn |= json("target"s, target);
+                rtn |= json("extensions"s, extensions);
                 return rtn;
             }
             template<typename ...JT>
@@ -313,8 +377,10 @@ namespace lak
                 json["buffer"s] = bufferView.buffer;
                 json["byteLength"s] = bufferView.byteLength;
                 json["byteOffset"s] = bufferView.byteOffset;
-                json["byteStride"s] = bufferView.byteStride;
-                json["target"s] = bufferView.target;
+                if (bufferView.byteStride) json["byteStride"s] = bufferView.byteStride;
+                if (bufferView.target) json["target"s] = bufferView.target;
+                if (bufferView.extensions.meshopt.buffer != (size_t)-1)
+                    json["extensions"s] = bufferView.extensions;
             }
         };
 
@@ -425,7 +491,7 @@ namespace lak
             string mimeType;
             // use empty string ("") to mark that we're using bufferView
             string uri;
-            size_t bufferView;
+            size_t bufferView = -1;
             template<typename ...JT>
             bool operator=(const json_t<JT...> &json)
             {
@@ -442,7 +508,7 @@ namespace lak
             friend inline void operator<<(json_t<JT...> &json, const image_t &image)
             {
                 json = json_object_t<JT...>{};
-                json["mimeType"s] = image.mimeType;
+                if (image.mimeType != "") json["mimeType"s] = image.mimeType;
                 if (image.uri != "")
                     json["uri"s] = image.uri;
                 else
@@ -453,25 +519,20 @@ namespace lak
         struct material_t
         {
             string name;
-            JSON details;
+            JSON details;   // the whole material object (pbrMetallicRoughness, etc)
             template<typename ...JT>
             bool operator=(const json_t<JT...> &json)
             {
-                bool rtn = false;
-                rtn |= json("name"s, name);
-                if (const JSON *obj = json("details"s); obj)
-                {
-                    details = *obj;
-                    rtn |= true;
-                }
+                json("name"s, name);
+                details = json;
                 return true;
             }
             template<typename ...JT>
             friend inline void operator<<(json_t<JT...> &json, const material_t &material)
             {
-                json = json_object_t<JT...>{};
-                json["name"s] = material.name;
-                json["details"s] = material.details; // JSON -> json_t<JT...> conversion
+                json = material.details; // JSON -> json_t<JT...> conversion
+                if (!json.template holds<json_object_t<JT...>>()) json = json_object_t<JT...>{};
+                if (material.name != "") json["name"s] = material.name;
             }
         };
 
@@ -480,10 +541,10 @@ namespace lak
             struct primitive_t
             {
                 unordered_map<string, size_t> attributes;
-                unordered_map<string, size_t> targets;
-                size_t indices;
-                size_t material;
-                size_t mode;
+                vector<unordered_map<string, size_t>> targets;
+                size_t indices = -1;
+                size_t material = -1;
+                size_t mode = GL_TRIANGLES;
                 template<typename ...JT>
                 bool operator=(const json_t<JT...> &json)
                 {
@@ -500,9 +561,9 @@ namespace lak
                 {
                     json = json_object_t<JT...>{};
                     json["attributes"s] = primitive.attributes;
-                    json["targets"s] = primitive.targets;
-                    json["indices"s] = primitive.indices;
-                    json["material"s] = primitive.material;
+                    if (!primitive.targets.empty()) json["targets"s] = primitive.targets;
+                    if (primitive.indices != (size_t)-1) json["indices"s] = primitive.indices;
+                    if (primitive.material != (size_t)-1) json["material"s] = primitive.material;
                     json["mode"s] = primitive.mode;
                 }
             };
@@ -524,21 +585,23 @@ namespace lak
                 json = json_object_t<JT...>{};
                 json["name"s] = mesh.name;
                 json["primitives"s] = mesh.primitives;
-                json["weights"s] = mesh.weights;
+                if (!mesh.weights.empty()) json["weights"s] = mesh.weights;
             }
         };
 
         struct node_t
         {
             string name;
-            size_t mesh;
-            size_t skin;
+            size_t mesh = -1;
+            size_t skin = -1;
             // NOTE: Must be TRS *OR* matrix, not both!
-            glm::vec3 translation;
-            glm::vec4 rotation;
-            glm::vec3 scale;
-            glm::mat4 matrix;
+            glm::vec3 translation = glm::vec3(0.0f);
+            glm::vec4 rotation = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f); // quaternion (x, y, z, w)
+            glm::vec3 scale = glm::vec3(1.0f);
+            glm::mat4 matrix = glm::mat4(1.0f);
+            bool useMatrix = false;     // true if matrix was set instead of TRS
             vector<size_t> children;
+            vector<double> weights;     // overrides mesh_t::weights if not empty
             template<typename ...JT>
             bool operator=(const json_t<JT...> &json)
             {
@@ -546,11 +609,32 @@ namespace lak
                 rtn |= json("name"s, name);
                 rtn |= json("mesh"s, mesh);
                 rtn |= json("skin"s, skin);
-                // TODO - translation
-                // TODO - rotation
-                // TODO - scale
-                // TODO - matrix
+                vector<double> v;
+                if (json("translation"s, v) && v.size() == 3)
+                {
+                    translation = glm::vec3(v[0], v[1], v[2]);
+                    rtn |= true;
+                }
+                if (json("rotation"s, v) && v.size() == 4)
+                {
+                    rotation = glm::vec4(v[0], v[1], v[2], v[3]);
+                    rtn |= true;
+                }
+                if (json("scale"s, v) && v.size() == 3)
+                {
+                    scale = glm::vec3(v[0], v[1], v[2]);
+                    rtn |= true;
+                }
+                if (json("matrix"s, v) && v.size() == 16)
+                {
+                    // column major, same as glm
+                    for (size_t c = 0; c < 4; ++c)
+                        matrix[c] = glm::vec4(v[c*4], v[(c*4)+1], v[(c*4)+2], v[(c*4)+3]);
+                    useMatrix = true;
+                    rtn |= true;
+                }
                 rtn |= json("children"s, children);
+                rtn |= json("weights"s, weights);
                 return rtn;
             }
             template<typename ...JT>
@@ -558,21 +642,34 @@ namespace lak
             {
                 json = json_object_t<JT...>{};
                 json["name"s] = node.name;
-                json["skin"s] = node.skin;
-                // TODO - translation
-                // TODO - rotation
-                // TODO - scale
-                // TODO - matrix
-                json["children"s] = node.children;
+                if (node.mesh != (size_t)-1) json["mesh"s] = node.mesh;
+                if (node.skin != (size_t)-1) json["skin"s] = node.skin;
+                if (node.useMatrix)
+                {
+                    vector<double> m; m.reserve(16);
+                    for (size_t c = 0; c < 4; ++c)
+                        for (size_t r = 0; r < 4; ++r)
+                            m.push_back(node.matrix[c][r]);
+                    json["matrix"s] = m;
+                }
+                else
+                {
+                    json["translation"s] = vector<double>{node.translation.x, node.translation.y, node.translation.z};
+                    json["rotation"s] = vector<double>{node.rotation.x, node.rotation.y, node.rotation.z, node.rotation.w};
+                    json["scale"s] = vector<double>{node.scale.x, node.scale.y, node.scale.z};
+                }
+                if (!node.children.empty()) json["children"s] = node.children;
+                if (!node.weights.empty())
+                    json["weights"s] = node.weights;
             }
         };
 
         struct sampler_t
         {
-            GLenum magFilter;
-            GLenum minFilter;
-            GLenum wrapS;
-            GLenum wrapT;
+            GLenum magFilter = 0;       // 0 if unspecified
+            GLenum minFilter = 0;       // 0 if unspecified
+            GLenum wrapS = GL_REPEAT;
+            GLenum wrapT = GL_REPEAT;
             template<typename ...JT>
             bool operator=(const json_t<JT...> &json)
             {
@@ -587,8 +684,8 @@ namespace lak
             friend inline void operator<<(json_t<JT...> &json, const sampler_t &sampler)
             {
                 json = json_object_t<JT...>{};
-                json["magFilter"s] = sampler.magFilter;
-                json["minFilter"s] = sampler.minFilter;
+                if (sampler.magFilter) json["magFilter"s] = sampler.magFilter;
+                if (sampler.minFilter) json["minFilter"s] = sampler.minFilter;
                 json["wrapS"s] = sampler.wrapS;
                 json["wrapT"s] = sampler.wrapT;
             }
@@ -618,8 +715,8 @@ namespace lak
         struct skin_t
         {
             string name;
-            size_t inverseBindMatrices;
-            size_t skeleton;
+            size_t inverseBindMatrices = -1;
+            size_t skeleton = -1;
             vector<size_t> joints;
             template<typename ...JT>
             bool operator=(const json_t<JT...> &json)
@@ -636,16 +733,16 @@ namespace lak
             {
                 json = json_object_t<JT...>{};
                 json["name"s] = skin.name;
-                json["inverseBindMatrices"s] = skin.inverseBindMatrices;
-                json["skeleton"s] = skin.skeleton;
+                if (skin.inverseBindMatrices != (size_t)-1) json["inverseBindMatrices"s] = skin.inverseBindMatrices;
+                if (skin.skeleton != (size_t)-1) json["skeleton"s] = skin.skeleton;
                 json["joints"s] = skin.joints;
             }
         };
 
         struct texture_t
         {
-            size_t sampler;
-            size_t source;
+            size_t sampler = -1;
+            size_t source = -1;
             template<typename ...JT>
             bool operator=(const json_t<JT...> &json)
             {
@@ -658,8 +755,8 @@ namespace lak
             friend inline void operator<<(json_t<JT...> &json, const texture_t &texture)
             {
                 json = json_object_t<JT...>{};
-                json["sampler"s] = texture.sampler;
-                json["source"s] = texture.source;
+                if (texture.sampler != (size_t)-1) json["sampler"s] = texture.sampler;
+                if (texture.source != (size_t)-1) json["source"s] = texture.source;
             }
         };
 
@@ -706,7 +803,7 @@ namespace lak
         vector<mesh_t> meshes;
         vector<node_t> nodes;
         vector<sampler_t> samplers;
-        size_t scene;                       // default scene (scene to show at load)
+        size_t scene = 0;                   // default scene (scene to show at load)
         vector<scene_t> scenes;
         vector<skin_t> skins;
         vector<texture_t> textures;
@@ -752,25 +849,27 @@ namespace lak
         friend inline void operator<<(json_t<JT...> &json, const gltf_t &gltf)
         {
             json = json_object_t<JT...>{};
-            json["extensionsUsed"s] = gltf.extensionsUsed;
-            json["extensionsRequired"s] = gltf.extensionsRequired;
-            json["accessors"s] = gltf.accessors;
-            json["animations"s] = gltf.animations;
+            // top level arrays must not be empty if they're present
+            if (!gltf.extensionsUsed.empty()) json["extensionsUsed"s] = gltf.extensionsUsed;
+            if (!gltf.extensionsRequired.empty()) json["extensionsRequired"s] = gltf.extensionsRequired;
+            if (!gltf.accessors.empty()) json["accessors"s] = gltf.accessors;
+            if (!gltf.animations.empty()) json["animations"s] = gltf.animations;
             json["asset"s] = gltf.asset;
-            json["buffers"s] = gltf.buffers;
-            json["bufferViews"s] = gltf.bufferViews;
-            json["cameras"s] = gltf.cameras;
-            json["images"s] = gltf.images;
-            json["materails"s] = gltf.materials;
-            json["meshes"s] = gltf.meshes;
-            json["nodes"s] = gltf.nodes;
-            json["samplers"s] = gltf.samplers;
-            json["scene"s] = gltf.scene;
-            json["scenes"s] = gltf.scenes;
-            json["skins"s] = gltf.skins;
-            json["textures"s] = gltf.textures;
-            json["extensions"s] = gltf.extensions;
-            json["extras"s] = gltf.extras;
+            if (!gltf.buffers.empty()) json["buffers"s] = gltf.buffers;
+            if (!gltf.bufferViews.empty()) json["bufferViews"s] = gltf.bufferViews;
+            if (!gltf.cameras.empty()) json["cameras"s] = gltf.cameras;
+            if (!gltf.images.empty()) json["images"s] = gltf.images;
+            if (!gltf.materials.empty()) json["materials"s] = gltf.materials;
+            if (!gltf.meshes.empty()) json["meshes"s] = gltf.meshes;
+            if (!gltf.nodes.empty()) json["nodes"s] = gltf.nodes;
+            if (!gltf.samplers.empty()) json["samplers"s] = gltf.samplers;
+            if (!gltf.scenes.empty())
+            {
+                json["scene"s] = gltf.scene;
+                json["scenes"s] = gltf.scenes;
+            }
+            if (!gltf.skins.empty()) json["skins"s] = gltf.skins;
+            if (!gltf.textures.empty()) json["textures"s] = gltf.textures;
         }
     };
 }
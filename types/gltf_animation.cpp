@@ -0,0 +1,237 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cmath>
+#include <algorithm>
+
+#include "types/gltf_animation.h"
+
+namespace lak
+{
+    bool animationClip_t::build(const gltf_t &gltf, const gltfData_t &data, size_t animation, const sceneGraph_t &graph)
+    {
+        samplers.clear();
+        for (auto &group : channels) group.clear();
+        start = end = 0.0f;
+        if (animation >= gltf.animations.size()) return false;
+        const auto &anim = gltf.animations[animation];
+
+        bool first = true;
+        samplers.resize(anim.samplers.size());
+        for (size_t i = 0; i < anim.samplers.size(); ++i)
+        {
+            const auto &src = anim.samplers[i];
+            auto &dst = samplers[i];
+            if (src.input >= data.accessors.size() || src.output >= data.accessors.size()) return false;
+            if (!accessorToFloat(gltf, src.input, data.accessors[src.input], &dst.input, false)) return false;
+            // integer outputs are always normalized for animations
+            if (!accessorToFloat(gltf, src.output, data.accessors[src.output], &dst.output, true)) return false;
+            if (dst.input.empty()) return false;
+
+            if (src.interpolation == "STEP") dst.interpolation = animationSampler_t::STEP;
+            else if (src.interpolation == "CUBICSPLINE") dst.interpolation = animationSampler_t::CUBICSPLINE;
+            else dst.interpolation = animationSampler_t::LINEAR;
+
+            const size_t values = dst.input.size() * (dst.interpolation == animationSampler_t::CUBICSPLINE ? 3 : 1);
+            dst.components = dst.output.size() / values;
+            if (dst.components == 0) return false;
+
+            if (first || dst.input.front() < start) start = dst.input.front();
+            if (first || dst.input.back() > end) end = dst.input.back();
+            first = false;
+        }
+
+        for (const auto &src : anim.channels)
+        {
+            if (src.sampler >= samplers.size() || src.target.node >= graph.index.size()) continue;
+            animationChannel_t channel;
+            channel.sampler = src.sampler;
+            channel.target = graph.index[src.target.node];
+            if (channel.target == (size_t)-1) continue; // node isn't in this scene
+            const size_t components = samplers[src.sampler].components;
+            if (src.target.path == "translation" && components == 3) channels[TRANSLATION].push_back(channel);
+            else if (src.target.path == "rotation" && components == 4) channels[ROTATION].push_back(channel);
+            else if (src.target.path == "scale" && components == 3) channels[SCALE].push_back(channel);
+            else if (src.target.path == "weights") channels[WEIGHTS].push_back(channel);
+        }
+        return true;
+    }
+
+    // finds k such that input[k] <= time < input[k+1], starting from the
+    // previous result. sequential playback only ever moves 0 or 1 keys
+    static inline size_t findKey(const vector<float> &input, float time, size_t &cursor)
+    {
+        const size_t last = input.size() - 1;
+        if (last == 0) return cursor = 0;
+        size_t k = cursor < last ? cursor : 0;
+        if (time >= input[k])
+        {
+            for (size_t steps = 0; k + 1 < last && time >= input[k + 1]; ++k)
+                if (++steps > 4) { k = last; break; } // jumped, fall back to a search
+            if (k < last) return cursor = k;
+        }
+        k = std::upper_bound(input.begin(), input.end(), time) - input.begin();
+        k = k == 0 ? 0 : k - 1;
+        return cursor = (k < last ? k : last - 1);
+    }
+
+    // samples a keyframe pair into out (N components, or n if N == 0)
+    template<size_t N>
+    static inline void sample(const animationSampler_t &sampler, size_t &cursor, float time, float *out, size_t n = N)
+    {
+        if constexpr (N != 0) n = N;
+        const size_t k = findKey(sampler.input, time, cursor);
+        const float *v = sampler.output.data();
+        if (sampler.input.size() == 1)
+        {
+            const float *v0 = v + (sampler.interpolation == animationSampler_t::CUBICSPLINE ? n : 0);
+            for (size_t c = 0; c < n; ++c) out[c] = v0[c];
+            return;
+        }
+        const float t0 = sampler.input[k];
+        const float dt = sampler.input[k + 1] - t0;
+        float t = dt > 0.0f ? (time - t0) / dt : 0.0f;
+        t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+
+        switch (sampler.interpolation)
+        {
+            case animationSampler_t::STEP: {
+                // findKey stops at the second last key, so the last key
+                // is only reached through t
+                const float *v0 = v + ((t >= 1.0f ? k + 1 : k) * n);
+                for (size_t c = 0; c < n; ++c) out[c] = v0[c];
+            } break;
+            case animationSampler_t::CUBICSPLINE: {
+                // each key is stored as (in-tangent, value, out-tangent)
+                const float *p0 = v + (k * 3 * n) + n;
+                const float *b0 = p0 + n;
+                const float *a1 = v + ((k + 1) * 3 * n);
+                const float *p1 = a1 + n;
+                const float t2 = t * t, t3 = t2 * t;
+                const float h00 = (2.0f * t3) - (3.0f * t2) + 1.0f;
+                const float h10 = (t3 - (2.0f * t2) + t) * dt;
+                const float h01 = (-2.0f * t3) + (3.0f * t2);
+                const float h11 = (t3 - t2) * dt;
+                for (size_t c = 0; c < n; ++c)
+                    out[c] = (h00 * p0[c]) + (h10 * b0[c]) + (h01 * p1[c]) + (h11 * a1[c]);
+            } break;
+            default: {
+                const float *v0 = v + (k * n);
+                const float *v1 = v0 + n;
+                for (size_t c = 0; c < n; ++c)
+                    out[c] = v0[c] + ((v1[c] - v0[c]) * t);
+            } break;
+        }
+    }
+
+    static inline glm::quat sampleRotation(const animationSampler_t &sampler, size_t &cursor, float time)
+    {
+        float q[4];
+        if (sampler.interpolation == animationSampler_t::LINEAR && sampler.input.size() > 1)
+        {
+            // slerp rather than lerp for rotations
+            const size_t k = findKey(sampler.input, time, cursor);
+            const float t0 = sampler.input[k];
+            const float dt = sampler.input[k + 1] - t0;
+            float t = dt > 0.0f ? (time - t0) / dt : 0.0f;
+            t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+            const float *a = sampler.output.data() + (k * 4);
+            const float *b = a + 4;
+            float d = (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]) + (a[3] * b[3]);
+            const float sign = d < 0.0f ? -1.0f : 1.0f;
+            d *= sign;
+            float s0, s1;
+            if (d > 0.9995f)
+            {
+                s0 = 1.0f - t;
+                s1 = t * sign;
+            }
+            else
+            {
+                const float theta = std::acos(d);
+                const float inv = 1.0f / std::sin(theta);
+                s0 = std::sin((1.0f - t) * theta) * inv;
+                s1 = std::sin(t * theta) * inv * sign;
+            }
+            for (size_t c = 0; c < 4; ++c) q[c] = (a[c] * s0) + (b[c] * s1);
+        }
+        else sample<4>(sampler, cursor, time, q);
+
+        const float len = std::sqrt((q[0] * q[0]) + (q[1] * q[1]) + (q[2] * q[2]) + (q[3] * q[3]));
+        const float inv = len > 0.0f ? 1.0f / len : 0.0f;
+        return glm::quat(q[3] * inv, q[0] * inv, q[1] * inv, q[2] * inv);
+    }
+
+    void animationState_t::evaluate()
+    {
+        if (clip == nullptr || graph == nullptr) return;
+        if (_cursor.size() != clip->samplers.size()) _cursor.assign(clip->samplers.size(), 0);
+
+        float t = time;
+        const float length = clip->end - clip->start;
+        if (loop && length > 0.0f)
+        {
+            t = std::fmod(t - clip->start, length);
+            if (t < 0.0f) t += length;
+            t += clip->start;
+        }
+
+        const auto &samplers = clip->samplers;
+        for (const auto &channel : clip->channels[animationClip_t::TRANSLATION])
+        {
+            float v[3];
+            sample<3>(samplers[channel.sampler], _cursor[channel.sampler], t, v);
+            graph->translation[channel.target] = glm::vec3(v[0], v[1], v[2]);
+            graph->dirty[channel.target] = true;
+        }
+        for (const auto &channel : clip->channels[animationClip_t::ROTATION])
+        {
+            graph->rotation[channel.target] = sampleRotation(samplers[channel.sampler], _cursor[channel.sampler], t);
+            graph->dirty[channel.target] = true;
+        }
+        for (const auto &channel : clip->channels[animationClip_t::SCALE])
+        {
+            float v[3];
+            sample<3>(samplers[channel.sampler], _cursor[channel.sampler], t, v);
+            graph->scale[channel.target] = glm::vec3(v[0], v[1], v[2]);
+            graph->dirty[channel.target] = true;
+        }
+        for (const auto &channel : clip->channels[animationClip_t::WEIGHTS])
+        {
+            const size_t offset = graph->weightOffset[channel.target];
+            const size_t count = graph->weightOffset[channel.target + 1] - offset;
+            const auto &sampler = samplers[channel.sampler];
+            if (count == 0 || sampler.components != count) continue;
+            sample<0>(sampler, _cursor[channel.sampler], t, graph->weights.data() + offset, count);
+        }
+    }
+
+    void evaluateAnimations(workerPool_t &pool, vector<animationState_t> &states)
+    {
+        parallelFor(pool, states.size(), [&states](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+                states[i].evaluate();
+        }, 16);
+    }
+}
@@ -0,0 +1,93 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <vector>
+
+#include "types/gltf.h"
+#include "types/gltf_loader.h"
+#include "types/scene_graph.h"
+#include "types/worker_pool.h"
+
+#ifndef LAK_GLTF_ANIMATION_H
+#define LAK_GLTF_ANIMATION_H
+
+namespace lak
+{
+    using std::vector;
+
+    struct animationSampler_t
+    {
+        enum interpolation_t { LINEAR, STEP, CUBICSPLINE } interpolation = LINEAR;
+        size_t components = 0;      // floats per keyframe value
+        vector<float> input;        // keyframe times
+        vector<float> output;       // keyframe values (in-tangent, value, out-tangent for CUBICSPLINE)
+    };
+
+    struct animationChannel_t
+    {
+        size_t sampler = -1;
+        size_t target = -1;         // sceneGraph_t index
+    };
+
+    // an animation decoded into flat arrays, channels are grouped by the
+    // property they animate so each group is evaluated in a single loop
+    struct animationClip_t
+    {
+        enum path_t { TRANSLATION, ROTATION, SCALE, WEIGHTS, PATH_COUNT };
+        vector<animationSampler_t> samplers;
+        vector<animationChannel_t> channels[PATH_COUNT];
+        float start = 0.0f;
+        float end = 0.0f;
+
+        // decodes gltf.animations[animation], targets are mapped through graph.index
+        // so any sceneGraph_t built from the same gltf_t can share this clip
+        bool build(const gltf_t &gltf, const gltfData_t &data, size_t animation, const sceneGraph_t &graph);
+    };
+
+    // playback state for one animated instance of a clip
+    struct animationState_t
+    {
+        const animationClip_t *clip = nullptr;
+        sceneGraph_t *graph = nullptr;
+        float time = 0.0f;
+        bool loop = true;
+        vector<size_t> _cursor;     // last keyframe used, per sampler
+
+        // writes clip at time into graph, sets the dirty flag of animated nodes
+        void evaluate();
+    };
+
+    // evaluates every state in parallel, each state must have its own graph
+    void evaluateAnimations(workerPool_t &pool, vector<animationState_t> &states);
+}
+
+#ifdef LAK_GLTF_ANIMATION_IMPLEM
+#   ifndef LAK_GLTF_ANIMATION_HAS_IMPLEM
+#       define LAK_GLTF_ANIMATION_HAS_IMPLEM
+#       include "types/gltf_animation.cpp"
+#   endif // LAK_GLTF_ANIMATION_HAS_IMPLEM
+#endif // LAK_GLTF_ANIMATION_IMPLEM
+
+#endif // LAK_GLTF_ANIMATION_H
@@ -0,0 +1,186 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string>
+#include <cstring>
+#include <unordered_map>
+#include <algorithm>
+
+#include "types/gltf_batch.h"
+
+namespace lak
+{
+    using std::string;
+    using std::unordered_map;
+
+    // layout key, primitives with the same key can share a vertex buffer
+    static string batchKey(const gltf_t &gltf, const gltf_t::mesh_t::primitive_t &prim)
+    {
+        vector<string> attributes;
+        attributes.reserve(prim.attributes.size());
+        for (const auto &attr : prim.attributes)
+        {
+            if (attr.second >= gltf.accessors.size()) return "";
+            const auto &acc = gltf.accessors[attr.second];
+            attributes.push_back(attr.first + ":" + std::to_string(acc.componentType) + ":" + acc.type + (acc.normalized ? ":n" : ""));
+        }
+        std::sort(attributes.begin(), attributes.end());
+        string key = std::to_string(prim.mode);
+        for (const auto &attr : attributes)
+            key += ";" + attr;
+        return key;
+    }
+
+    bool buildBatches(const gltf_t &gltf, const gltfData_t &data, size_t scene, gltfBatches_t *out)
+    {
+        out->batches.clear();
+        out->lookup.clear();
+        out->lookup.resize(gltf.meshes.size());
+        for (size_t m = 0; m < gltf.meshes.size(); ++m)
+            out->lookup[m].resize(gltf.meshes[m].primitives.size());
+
+        // meshes used by the scene
+        vector<bool> used(gltf.meshes.size(), scene >= gltf.scenes.size());
+        if (scene < gltf.scenes.size())
+        {
+            vector<bool> visited(gltf.nodes.size(), false);
+            vector<size_t> stack(gltf.scenes[scene].nodes.begin(), gltf.scenes[scene].nodes.end());
+            while (!stack.empty())
+            {
+                const size_t n = stack.back();
+                stack.pop_back();
+                if (n >= gltf.nodes.size() || visited[n]) continue;
+                visited[n] = true;
+                if (gltf.nodes[n].mesh < used.size()) used[gltf.nodes[n].mesh] = true;
+                stack.insert(stack.end(), gltf.nodes[n].children.begin(), gltf.nodes[n].children.end());
+            }
+        }
+
+        // group primitives by layout
+        unordered_map<string, size_t> batchOf;
+        vector<vector<gltfBatchSource_t>> groups;
+        for (size_t m = 0; m < gltf.meshes.size(); ++m)
+        {
+            if (!used[m]) continue;
+            for (size_t p = 0; p < gltf.meshes[m].primitives.size(); ++p)
+            {
+                const auto &prim = gltf.meshes[m].primitives[p];
+                const auto position = prim.attributes.find("POSITION");
+                if (position == prim.attributes.end() || position->second >= gltf.accessors.size()) continue;
+                const size_t vertexCount = gltf.accessors[position->second].count;
+                bool valid = vertexCount > 0;
+                for (const auto &attr : prim.attributes)
+                    valid = valid && attr.second < gltf.accessors.size() && attr.second < data.accessors.size() &&
+                        gltf.accessors[attr.second].count == vertexCount;
+                if (prim.indices != (size_t)-1)
+                    valid = valid && prim.indices < data.accessors.size();
+                const string key = valid ? batchKey(gltf, prim) : "";
+                if (key.empty()) continue;
+
+                const auto it = batchOf.find(key);
+                const size_t batch = it == batchOf.end() ? groups.size() : it->second;
+                if (it == batchOf.end())
+                {
+                    batchOf[key] = batch;
+                    groups.emplace_back();
+                }
+                gltfBatchSource_t source;
+                source.mesh = m;
+                source.primitive = p;
+                source.material = prim.material;
+                groups[batch].push_back(source);
+            }
+        }
+
+        out->batches.resize(groups.size());
+        for (size_t b = 0; b < groups.size(); ++b)
+        {
+            const auto &group = groups[b];
+            auto &batch = out->batches[b];
+            const auto &first = gltf.meshes[group[0].mesh].primitives[group[0].primitive];
+            batch.mesh = std::make_shared<mesh_t>();
+            batch.mesh->drawMode = first.mode;
+            batch.mesh->vertArray.buffers.resize(1);
+            auto &elements = batch.mesh->vertArray.buffers[0].elements;
+            batch.sources = group;
+            batch.ranges.resize(group.size());
+
+            // size everything up front
+            size_t vertexCount = 0;
+            size_t indexCount = 0;
+            for (size_t r = 0; r < group.size(); ++r)
+            {
+                const auto &prim = gltf.meshes[group[r].mesh].primitives[group[r].primitive];
+                const size_t vertices = gltf.accessors[prim.attributes.at("POSITION")].count;
+                auto &range = batch.ranges[r];
+                range.baseVertex = (GLint)vertexCount;
+                range.firstIndex = indexCount;
+                range.count = (GLsizei)(prim.indices != (size_t)-1 ? gltf.accessors[prim.indices].count : vertices);
+                vertexCount += vertices;
+                indexCount += range.count;
+                out->lookup[group[r].mesh][group[r].primitive] = {b, r};
+            }
+
+            // vertex data, padded to 4 bytes per element like gltfVertexElement
+            for (const auto &attr : first.attributes)
+            {
+                const auto &acc = gltf.accessors[attr.second];
+                const size_t elemSize = gltfComponentSize(acc.componentType) * gltfComponentCount(acc.type);
+                const size_t padded = (elemSize + 3) & ~(size_t)3;
+                auto &element = elements[attr.first];
+                element.type = acc.componentType;
+                element.size = (GLint)gltfComponentCount(acc.type);
+                element.normalised = acc.normalized;
+                element.active = true;
+                element.dirty = true;
+                element.data.init(vertexCount * padded, padded);
+                uint8_t *dst = element.data.data.data();
+                for (size_t r = 0; r < group.size(); ++r)
+                {
+                    const auto &prim = gltf.meshes[group[r].mesh].primitives[group[r].primitive];
+                    const stride_vector &src = data.accessors[prim.attributes.at(attr.first)];
+                    uint8_t *vertex = dst + (batch.ranges[r].baseVertex * padded);
+                    const size_t count = src.size() / elemSize;
+                    if (padded == elemSize)
+                        memcpy(vertex, src.data.data(), count * elemSize);
+                    else for (size_t i = 0; i < count; ++i)
+                        memcpy(vertex + (i * padded), src.data.data() + (i * elemSize), elemSize);
+                }
+            }
+
+            // indices are stored relative to each primitive, baseVertex offsets them
+            auto &index = batch.mesh->index;
+            index.resize(indexCount);
+            for (size_t r = 0; r < group.size(); ++r)
+            {
+                const auto &prim = gltf.meshes[group[r].mesh].primitives[group[r].primitive];
+                const auto &range = batch.ranges[r];
+                gltfIndices(gltf, data, prim.indices, index.data() + range.firstIndex, range.count);
+            }
+            batch.mesh->indexCount = indexCount;
+        }
+
+        return !out->batches.empty();
+    }
+}
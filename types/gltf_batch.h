@@ -0,0 +1,96 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <vector>
+#include <memory>
+
+#include "types/gltf.h"
+#include "types/gltf_loader.h"
+#include "types/mesh.h"
+
+#ifndef LAK_GLTF_BATCH_H
+#define LAK_GLTF_BATCH_H
+
+namespace lak
+{
+    using std::vector;
+    using std::shared_ptr;
+
+    struct gltfBatchSource_t
+    {
+        size_t mesh = -1;
+        size_t primitive = -1;
+        size_t material = -1;
+    };
+
+    // a simplified version of a batched primitive, indices share the
+    // primitive's vertices (see buildBatchLods)
+    struct gltfLod_t
+    {
+        drawRange_t range;
+        float error = 0.0f;     // how far the surface moved, in mesh units
+    };
+
+    // primitives that share an attribute layout and draw mode, packed into a
+    // single vertex buffer and index buffer
+    struct gltfBatch_t
+    {
+        // elements are named after the glTF attributes ("POSITION", "TEXCOORD_0", etc)
+        // set mesh->shader (and textures) before drawing
+        shared_ptr<mesh_t> mesh;
+        vector<drawRange_t> ranges;         // one per primitive
+        vector<gltfBatchSource_t> sources;  // index matches ranges
+        vector<vector<gltfLod_t>> lods;     // [range][level], empty unless built
+        inline void draw() { mesh->draw(ranges.data(), ranges.size()); }
+    };
+
+    // where a primitive ended up in a gltfBatches_t (-1 if it wasn't batched)
+    struct gltfBatchRef_t
+    {
+        size_t batch = -1;
+        size_t range = -1;
+    };
+
+    struct gltfBatches_t
+    {
+        vector<gltfBatch_t> batches;
+        vector<vector<gltfBatchRef_t>> lookup;  // [mesh][primitive]
+    };
+
+    // packs every primitive used by scene (or every mesh if scene is -1) into
+    // as few batches as possible, each primitive is only added once no matter
+    // how many nodes use it. non-indexed primitives get sequential indices.
+    // data must be done loading, no GL calls are made until the first draw
+    bool buildBatches(const gltf_t &gltf, const gltfData_t &data, size_t scene, gltfBatches_t *out);
+}
+
+#ifdef LAK_GLTF_BATCH_IMPLEM
+#   ifndef LAK_GLTF_BATCH_HAS_IMPLEM
+#       define LAK_GLTF_BATCH_HAS_IMPLEM
+#       include "types/gltf_batch.cpp"
+#   endif // LAK_GLTF_BATCH_HAS_IMPLEM
+#endif // LAK_GLTF_BATCH_IMPLEM
+
+#endif // LAK_GLTF_BATCH_H
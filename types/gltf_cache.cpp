@@ -0,0 +1,650 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+#include "utils/ldebug.h"
+#include "types/gltf_cache.h"
+
+namespace lak
+{
+    using std::ofstream;
+
+    //
+    // file layout, everything is little endian and every section is 16 byte
+    // aligned so the arrays can be used in place. offsets are from the start
+    // of the file and are turned into pointers (after bounds checking) by open
+    //
+
+    static const uint32_t cacheMagic = 0x4743414C; // "LACG"
+    static const uint32_t cacheByteOrder = 0x01020304;
+    static const uint32_t cacheNone = 0xFFFFFFFF;   // stored size_t(-1)
+
+    struct _cacheHeader_t
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t sourceCount;
+        uint64_t fileSize;
+        uint64_t sources;       // _cacheSource_t[sourceCount]
+        uint32_t batchCount;
+        uint32_t textureCount;
+        uint32_t imageCount;
+        uint32_t hasGraph;
+        uint64_t batches;       // _cacheBatch_t[batchCount]
+        uint64_t textures;      // _cacheTexture_t[textureCount]
+        uint64_t images;        // _cacheImage_t[imageCount]
+        uint64_t graph;         // _cacheGraph_t
+    };
+
+    struct _cacheSource_t
+    {
+        uint64_t path;          // char[pathLength]
+        uint64_t pathLength;
+        uint64_t hash;
+    };
+
+    struct _cacheElement_t
+    {
+        char name[48];          // null terminated
+        uint32_t type;
+        int32_t size;
+        uint32_t offset;
+        uint32_t normalised;
+    };
+
+    struct _cacheRange_t
+    {
+        uint32_t count;
+        int32_t baseVertex;
+        uint64_t firstIndex;
+        uint32_t mesh;
+        uint32_t primitive;
+        uint32_t material;
+        uint32_t lodCount;
+        uint64_t lods;          // _cacheLod_t[lodCount], level 0 is the range itself
+    };
+
+    struct _cacheLod_t
+    {
+        uint32_t count;
+        int32_t baseVertex;
+        uint64_t firstIndex;
+        float error;
+        uint32_t _pad;
+    };
+
+    struct _cacheBatch_t
+    {
+        uint32_t drawMode;
+        uint32_t stride;
+        uint32_t elementCount;
+        uint32_t rangeCount;
+        uint64_t elements;      // _cacheElement_t[elementCount]
+        uint64_t ranges;        // _cacheRange_t[rangeCount]
+        uint64_t vertices;      // uint8_t[vertexBytes]
+        uint64_t vertexBytes;
+        uint64_t indices;       // GLuint[indexCount]
+        uint64_t indexCount;
+    };
+
+    struct _cacheTexture_t
+    {
+        uint32_t image;
+        uint32_t hasSampler;
+        int32_t magFilter;
+        int32_t minFilter;
+        int32_t wrapS;
+        int32_t wrapT;
+    };
+
+    struct _cacheImage_t
+    {
+        uint32_t width;
+        uint32_t height;
+        uint64_t pixels;        // uint8_t[width * height * 4]
+    };
+
+    struct _cacheGraph_t
+    {
+        uint64_t size;          // number of graph nodes
+        uint64_t nodeCount;     // number of gltf_t nodes (size of index)
+        uint64_t weightCount;
+        uint64_t parent;        // uint32_t[size]
+        uint64_t node;          // uint32_t[size]
+        uint64_t index;         // uint32_t[nodeCount]
+        uint64_t hasTRS;        // uint8_t[size]
+        uint64_t local;         // float[size * 16]
+        uint64_t translation;   // float[size * 3]
+        uint64_t rotation;      // float[size * 4] (x, y, z, w)
+        uint64_t scale;         // float[size * 3]
+        uint64_t weightOffset;  // uint32_t[size + 1]
+        uint64_t weights;       // float[weightCount]
+    };
+
+    static inline uint32_t toU32(size_t v) { return v == (size_t)-1 ? cacheNone : (uint32_t)v; }
+    static inline size_t fromU32(uint32_t v) { return v == cacheNone ? (size_t)-1 : (size_t)v; }
+
+    //
+    // writing
+    //
+
+    struct _cacheWriter_t
+    {
+        vector<uint8_t> out;
+
+        // appends size bytes (16 byte aligned) and returns their offset
+        uint64_t append(const void *data, size_t size)
+        {
+            out.resize((out.size() + 15) & ~(size_t)15);
+            const uint64_t offset = out.size();
+            out.resize(out.size() + size);
+            if (size > 0 && data != nullptr) memcpy(out.data() + offset, data, size);
+            return offset;
+        }
+
+        template<typename T>
+        uint64_t append(const vector<T> &data) { return append(data.data(), data.size() * sizeof(T)); }
+
+        template<typename T>
+        T *at(uint64_t offset) { return (T*)(out.data() + offset); }
+    };
+
+    vector<string> gltfSources(const gltf_t &gltf, const string &path, const string &directory)
+    {
+        vector<string> sources = {path};
+        auto add = [&](const string &uri) {
+            if (uri.empty() || uri.compare(0, 5, "data:") == 0) return;
+            const string file = directory.empty() ? uri : directory + "/" + uri;
+            if (std::find(sources.begin(), sources.end(), file) == sources.end())
+                sources.push_back(file);
+        };
+        for (const auto &buffer : gltf.buffers) add(buffer.uri);
+        for (const auto &image : gltf.images) add(image.uri);
+        return sources;
+    }
+
+    bool writeGLTFCache(const string &path, const vector<string> &sources, const gltf_t &gltf, const gltfData_t &data, const gltfBatches_t &batches, const sceneGraph_t &graph)
+    {
+        _cacheWriter_t w;
+        const uint64_t headerOffset = w.append(nullptr, sizeof(_cacheHeader_t));
+        _cacheHeader_t header = {};
+        header.magic = cacheMagic;
+        header.version = gltfCacheVersion;
+        header.byteOrder = cacheByteOrder;
+
+        // sources
+        vector<_cacheSource_t> sourceRecords(sources.size());
+        for (size_t i = 0; i < sources.size(); ++i)
+        {
+            if (!hashFile(sources[i], &sourceRecords[i].hash)) return false;
+            sourceRecords[i].path = w.append(sources[i].data(), sources[i].size());
+            sourceRecords[i].pathLength = sources[i].size();
+        }
+        header.sourceCount = (uint32_t)sources.size();
+        header.sources = w.append(sourceRecords);
+
+        // batches, interlaced with elements sorted by name so the layout is stable
+        vector<_cacheBatch_t> batchRecords(batches.batches.size());
+        for (size_t b = 0; b < batches.batches.size(); ++b)
+        {
+            const auto &batch = batches.batches[b];
+            auto &record = batchRecords[b];
+            record = {};
+            if (!batch.mesh || batch.mesh->vertArray.buffers.empty()) return false;
+            const auto &elementMap = batch.mesh->vertArray.buffers[0].elements;
+
+            vector<string> names;
+            for (const auto &elem : elementMap)
+                if (elem.second.active && elem.second.data.stride) names.push_back(elem.first);
+            std::sort(names.begin(), names.end());
+
+            vector<_cacheElement_t> elements(names.size());
+            vector<stride_vector*> interleave;
+            size_t stride = 0;
+            for (size_t e = 0; e < names.size(); ++e)
+            {
+                const auto &elem = elementMap.at(names[e]);
+                if (names[e].size() >= sizeof(elements[e].name)) return false;
+                memset(&elements[e], 0, sizeof(elements[e]));
+                memcpy(elements[e].name, names[e].data(), names[e].size());
+                elements[e].type = elem.type;
+                elements[e].size = elem.size;
+                elements[e].offset = (uint32_t)stride;
+                elements[e].normalised = elem.normalised;
+                interleave.push_back(const_cast<stride_vector*>(&elem.data));
+                stride += elem.data.stride;
+            }
+            const stride_vector vertices = stride_vector::interleave(interleave);
+
+            vector<_cacheRange_t> ranges(batch.ranges.size());
+            for (size_t r = 0; r < ranges.size(); ++r)
+            {
+                ranges[r] = {};
+                ranges[r].count = (uint32_t)batch.ranges[r].count;
+                ranges[r].baseVertex = batch.ranges[r].baseVertex;
+                ranges[r].firstIndex = batch.ranges[r].firstIndex;
+                if (r < batch.sources.size())
+                {
+                    ranges[r].mesh = toU32(batch.sources[r].mesh);
+                    ranges[r].primitive = toU32(batch.sources[r].primitive);
+                    ranges[r].material = toU32(batch.sources[r].material);
+                }
+                if (r < batch.lods.size() && !batch.lods[r].empty())
+                {
+                    vector<_cacheLod_t> lods(batch.lods[r].size());
+                    for (size_t l = 0; l < lods.size(); ++l)
+                    {
+                        const auto &lod = batch.lods[r][l];
+                        lods[l] = {};
+                        lods[l].count = (uint32_t)lod.range.count;
+                        lods[l].baseVertex = lod.range.baseVertex;
+                        lods[l].firstIndex = lod.range.firstIndex;
+                        lods[l].error = lod.error;
+                    }
+                    ranges[r].lodCount = (uint32_t)lods.size();
+                    ranges[r].lods = w.append(lods);
+                }
+            }
+
+            record.drawMode = batch.mesh->drawMode;
+            record.stride = (uint32_t)stride;
+            record.elementCount = (uint32_t)elements.size();
+            record.rangeCount = (uint32_t)ranges.size();
+            record.elements = w.append(elements);
+            record.ranges = w.append(ranges);
+            record.vertices = w.append(vertices.data);
+            record.vertexBytes = vertices.size();
+            record.indices = w.append(batch.mesh->index);
+            record.indexCount = batch.mesh->index.size();
+        }
+        header.batchCount = (uint32_t)batchRecords.size();
+        header.batches = w.append(batchRecords);
+
+        // textures and images
+        vector<_cacheTexture_t> textureRecords(gltf.textures.size());
+        for (size_t t = 0; t < gltf.textures.size(); ++t)
+        {
+            auto &record = textureRecords[t];
+            record = {};
+            record.image = toU32(gltf.textures[t].source);
+            record.wrapS = GL_REPEAT;
+            record.wrapT = GL_REPEAT;
+            if (gltf.textures[t].sampler < gltf.samplers.size())
+            {
+                const auto &sampler = gltf.samplers[gltf.textures[t].sampler];
+                record.hasSampler = 1;
+                record.magFilter = (int32_t)sampler.magFilter;
+                record.minFilter = (int32_t)sampler.minFilter;
+                record.wrapS = (int32_t)sampler.wrapS;
+                record.wrapT = (int32_t)sampler.wrapT;
+            }
+        }
+        header.textureCount = (uint32_t)textureRecords.size();
+        header.textures = w.append(textureRecords);
+
+        vector<_cacheImage_t> imageRecords(data.images.size());
+        for (size_t i = 0; i < data.images.size(); ++i)
+        {
+            const auto &image = data.images[i];
+            imageRecords[i] = {};
+            imageRecords[i].width = (uint32_t)image.w;
+            imageRecords[i].height = (uint32_t)image.h;
+            imageRecords[i].pixels = w.append(image.pixels.data(), image.w * image.h * 4);
+        }
+        header.imageCount = (uint32_t)imageRecords.size();
+        header.images = w.append(imageRecords);
+
+        // node arrays
+        {
+            const size_t n = graph.size();
+            _cacheGraph_t g = {};
+            g.size = n;
+            g.nodeCount = graph.index.size();
+            g.weightCount = graph.weights.size();
+            vector<uint32_t> u32(n);
+            for (size_t i = 0; i < n; ++i) u32[i] = toU32(graph.parent[i]);
+            g.parent = w.append(u32);
+            for (size_t i = 0; i < n; ++i) u32[i] = toU32(graph.node[i]);
+            g.node = w.append(u32);
+            u32.resize(graph.index.size());
+            for (size_t i = 0; i < graph.index.size(); ++i) u32[i] = toU32(graph.index[i]);
+            g.index = w.append(u32);
+            g.hasTRS = w.append(graph.hasTRS);
+            vector<float> floats(n * 16);
+            for (size_t i = 0; i < n; ++i)
+                for (int c = 0; c < 4; ++c)
+                    for (int r = 0; r < 4; ++r)
+                        floats[(i * 16) + (c * 4) + r] = graph.local[i][c][r];
+            g.local = w.append(floats);
+            floats.resize(n * 3);
+            for (size_t i = 0; i < n; ++i)
+                for (int c = 0; c < 3; ++c)
+                    floats[(i * 3) + c] = graph.translation[i][c];
+            g.translation = w.append(floats);
+            for (size_t i = 0; i < n; ++i)
+                for (int c = 0; c < 3; ++c)
+                    floats[(i * 3) + c] = graph.scale[i][c];
+            g.scale = w.append(floats);
+            floats.resize(n * 4);
+            for (size_t i = 0; i < n; ++i)
+            {
+                floats[(i * 4) + 0] = graph.rotation[i].x;
+                floats[(i * 4) + 1] = graph.rotation[i].y;
+                floats[(i * 4) + 2] = graph.rotation[i].z;
+                floats[(i * 4) + 3] = graph.rotation[i].w;
+            }
+            g.rotation = w.append(floats);
+            u32.resize(graph.weightOffset.size());
+            for (size_t i = 0; i < graph.weightOffset.size(); ++i) u32[i] = (uint32_t)graph.weightOffset[i];
+            if (u32.size() != n + 1) u32.assign(n + 1, 0);
+            g.weightOffset = w.append(u32);
+            g.weights = w.append(graph.weights);
+            header.hasGraph = 1;
+            header.graph = w.append(&g, sizeof(g));
+        }
+
+        header.fileSize = w.out.size();
+        memcpy(w.at<_cacheHeader_t>(headerOffset), &header, sizeof(header));
+
+        // write to a temporary file first so a failed write never looks like a valid cache
+        const string temp = path + ".tmp";
+        {
+            ofstream strm(temp, std::ios::binary | std::ios::trunc);
+            if (!strm.is_open()) return false;
+            if (!strm.write((const char*)w.out.data(), w.out.size())) return false;
+        }
+        std::remove(path.c_str());
+        return std::rename(temp.c_str(), path.c_str()) == 0;
+    }
+
+    //
+    // reading
+    //
+
+    // bounds checked pointer into the cache
+    template<typename T>
+    static const T *cachePtr(const mappedFile_t &file, uint64_t offset, uint64_t count)
+    {
+        if (offset % alignof(T) != 0 || offset > file.size) return nullptr;
+        if (count > (file.size - offset) / sizeof(T)) return nullptr;
+        return (const T*)(file.data + offset);
+    }
+
+    void gltfCache_t::close()
+    {
+        batches.clear();
+        textures.clear();
+        images.clear();
+        _graph = nullptr;
+        file.close();
+    }
+
+    bool gltfCache_t::open(const string &path)
+    {
+        close();
+        if (!file.open(path)) return false;
+        auto fail = [this](const char *reason) {
+            LDEBUG("Cache miss: " << reason);
+            close();
+            return false;
+        };
+
+        const _cacheHeader_t *header = cachePtr<_cacheHeader_t>(file, 0, 1);
+        if (header == nullptr || header->magic != cacheMagic || header->byteOrder != cacheByteOrder)
+            return fail("not a cache file");
+        if (header->version != gltfCacheVersion) return fail("version mismatch");
+        if (header->fileSize != file.size) return fail("truncated");
+
+        const _cacheSource_t *sources = cachePtr<_cacheSource_t>(file, header->sources, header->sourceCount);
+        if (sources == nullptr) return fail("bad sources");
+        for (size_t i = 0; i < header->sourceCount; ++i)
+        {
+            const char *name = cachePtr<char>(file, sources[i].path, sources[i].pathLength);
+            if (name == nullptr) return fail("bad sources");
+            uint64_t hash;
+            if (!hashFile(string(name, sources[i].pathLength), &hash) || hash != sources[i].hash)
+                return fail("source changed");
+        }
+
+        const _cacheBatch_t *batchRecords = cachePtr<_cacheBatch_t>(file, header->batches, header->batchCount);
+        if (batchRecords == nullptr) return fail("bad batches");
+        batches.resize(header->batchCount);
+        for (size_t b = 0; b < batches.size(); ++b)
+        {
+            const auto &record = batchRecords[b];
+            auto &batch = batches[b];
+            const _cacheElement_t *elements = cachePtr<_cacheElement_t>(file, record.elements, record.elementCount);
+            const _cacheRange_t *ranges = cachePtr<_cacheRange_t>(file, record.ranges, record.rangeCount);
+            batch.vertices = cachePtr<uint8_t>(file, record.vertices, record.vertexBytes);
+            batch.indices = cachePtr<GLuint>(file, record.indices, record.indexCount);
+            if (elements == nullptr || ranges == nullptr || batch.vertices == nullptr || batch.indices == nullptr)
+                return fail("bad batch");
+            batch.drawMode = record.drawMode;
+            batch.stride = record.stride;
+            batch.vertexBytes = record.vertexBytes;
+            batch.indexCount = record.indexCount;
+            batch.elements.resize(record.elementCount);
+            for (size_t e = 0; e < batch.elements.size(); ++e)
+            {
+                auto &element = batch.elements[e];
+                element.name.assign(elements[e].name, strnlen(elements[e].name, sizeof(elements[e].name)));
+                element.type = elements[e].type;
+                element.size = elements[e].size;
+                element.normalised = elements[e].normalised != 0;
+                element.offset = elements[e].offset;
+            }
+            batch.ranges.resize(record.rangeCount);
+            batch.sources.resize(record.rangeCount);
+            for (size_t r = 0; r < batch.ranges.size(); ++r)
+            {
+                if (ranges[r].firstIndex + ranges[r].count > batch.indexCount) return fail("bad range");
+                batch.ranges[r].count = (GLsizei)ranges[r].count;
+                batch.ranges[r].firstIndex = ranges[r].firstIndex;
+                batch.ranges[r].baseVertex = ranges[r].baseVertex;
+                batch.sources[r].mesh = fromU32(ranges[r].mesh);
+                batch.sources[r].primitive = fromU32(ranges[r].primitive);
+                batch.sources[r].material = fromU32(ranges[r].material);
+            }
+            for (size_t r = 0; r < batch.ranges.size(); ++r)
+            {
+                if (ranges[r].lodCount == 0) continue;
+                const _cacheLod_t *lods = cachePtr<_cacheLod_t>(file, ranges[r].lods, ranges[r].lodCount);
+                if (lods == nullptr) return fail("bad lods");
+                batch.lods.resize(batch.ranges.size());
+                batch.lods[r].resize(ranges[r].lodCount);
+                for (size_t l = 0; l < batch.lods[r].size(); ++l)
+                {
+                    if (lods[l].firstIndex + lods[l].count > batch.indexCount) return fail("bad lods");
+                    auto &lod = batch.lods[r][l];
+                    lod.range.count = (GLsizei)lods[l].count;
+                    lod.range.firstIndex = lods[l].firstIndex;
+                    lod.range.baseVertex = lods[l].baseVertex;
+                    lod.error = lods[l].error;
+                }
+            }
+        }
+
+        const _cacheTexture_t *textureRecords = cachePtr<_cacheTexture_t>(file, header->textures, header->textureCount);
+        const _cacheImage_t *imageRecords = cachePtr<_cacheImage_t>(file, header->images, header->imageCount);
+        if (textureRecords == nullptr || imageRecords == nullptr) return fail("bad textures");
+        textures.resize(header->textureCount);
+        for (size_t t = 0; t < textures.size(); ++t)
+        {
+            textures[t].image = fromU32(textureRecords[t].image);
+            textures[t].hasSampler = textureRecords[t].hasSampler != 0;
+            textures[t].magFilter = textureRecords[t].magFilter;
+            textures[t].minFilter = textureRecords[t].minFilter;
+            textures[t].wrapS = textureRecords[t].wrapS;
+            textures[t].wrapT = textureRecords[t].wrapT;
+        }
+        images.resize(header->imageCount);
+        for (size_t i = 0; i < images.size(); ++i)
+        {
+            images[i].width = imageRecords[i].width;
+            images[i].height = imageRecords[i].height;
+            images[i].pixels = cachePtr<uint8_t>(file, imageRecords[i].pixels, (uint64_t)images[i].width * images[i].height * 4);
+            if (images[i].pixels == nullptr && images[i].width * images[i].height > 0) return fail("bad image");
+        }
+
+        if (header->hasGraph)
+        {
+            const _cacheGraph_t *g = cachePtr<_cacheGraph_t>(file, header->graph, 1);
+            if (g == nullptr) return fail("bad graph");
+            const bool valid =
+                cachePtr<uint32_t>(file, g->parent, g->size) && cachePtr<uint32_t>(file, g->node, g->size) &&
+                cachePtr<uint32_t>(file, g->index, g->nodeCount) && cachePtr<uint8_t>(file, g->hasTRS, g->size) &&
+                cachePtr<float>(file, g->local, g->size * 16) && cachePtr<float>(file, g->translation, g->size * 3) &&
+                cachePtr<float>(file, g->rotation, g->size * 4) && cachePtr<float>(file, g->scale, g->size * 3) &&
+                cachePtr<uint32_t>(file, g->weightOffset, g->size + 1) && cachePtr<float>(file, g->weights, g->weightCount);
+            if (!valid) return fail("bad graph");
+            _graph = (const uint8_t*)g;
+        }
+
+        return true;
+    }
+
+    bool gltfCache_t::restore(sceneGraph_t *graph) const
+    {
+        if (_graph == nullptr) return false;
+        const _cacheGraph_t &g = *(const _cacheGraph_t*)_graph;
+        const uint8_t *base = file.data;
+        const size_t n = g.size;
+        const uint32_t *parent = (const uint32_t*)(base + g.parent);
+        const uint32_t *node = (const uint32_t*)(base + g.node);
+        const uint32_t *index = (const uint32_t*)(base + g.index);
+        const uint8_t *hasTRS = base + g.hasTRS;
+        const float *local = (const float*)(base + g.local);
+        const float *translation = (const float*)(base + g.translation);
+        const float *rotation = (const float*)(base + g.rotation);
+        const float *scale = (const float*)(base + g.scale);
+        const uint32_t *weightOffset = (const uint32_t*)(base + g.weightOffset);
+        const float *weights = (const float*)(base + g.weights);
+
+        graph->parent.resize(n);
+        graph->node.resize(n);
+        graph->local.resize(n);
+        graph->world.resize(n);
+        graph->translation.resize(n);
+        graph->rotation.resize(n);
+        graph->scale.resize(n);
+        graph->weightOffset.resize(n + 1);
+        for (size_t i = 0; i < n; ++i)
+        {
+            graph->parent[i] = fromU32(parent[i]);
+            graph->node[i] = fromU32(node[i]);
+            for (int c = 0; c < 4; ++c)
+                for (int r = 0; r < 4; ++r)
+                    graph->local[i][c][r] = local[(i * 16) + (c * 4) + r];
+            graph->translation[i] = glm::vec3(translation[i * 3], translation[(i * 3) + 1], translation[(i * 3) + 2]);
+            graph->rotation[i] = glm::quat(rotation[(i * 4) + 3], rotation[i * 4], rotation[(i * 4) + 1], rotation[(i * 4) + 2]);
+            graph->scale[i] = glm::vec3(scale[i * 3], scale[(i * 3) + 1], scale[(i * 3) + 2]);
+        }
+        for (size_t i = 0; i <= n; ++i)
+            graph->weightOffset[i] = weightOffset[i];
+        graph->index.resize(g.nodeCount);
+        for (size_t i = 0; i < g.nodeCount; ++i)
+            graph->index[i] = fromU32(index[i]);
+        graph->hasTRS.assign(hasTRS, hasTRS + n);
+        graph->weights.assign(weights, weights + g.weightCount);
+        // world transforms aren't cached, recompute everything on the next update
+        graph->dirty.assign(n, true);
+        return true;
+    }
+
+    void gltfCache_t::upload(gltfBatches_t *out, vector<shared_ptr<texture_t>> *outTextures) const
+    {
+        if (out != nullptr)
+        {
+            out->batches.clear();
+            out->lookup.clear();
+            out->batches.resize(batches.size());
+            for (size_t b = 0; b < batches.size(); ++b)
+            {
+                const auto &src = batches[b];
+                auto &batch = out->batches[b];
+                batch.mesh = std::make_shared<mesh_t>();
+                batch.mesh->drawMode = src.drawMode;
+                batch.mesh->vertArray.buffers.resize(1);
+                auto &buffer = batch.mesh->vertArray.buffers[0];
+                for (const auto &elem : src.elements)
+                {
+                    auto &element = buffer.elements[elem.name];
+                    element.type = elem.type;
+                    element.size = elem.size;
+                    element.normalised = elem.normalised;
+                    element.offset = (GLintptr)elem.offset;
+                    element.interlacedStride = src.stride;
+                    element.active = true;
+                }
+                buffer.setInterlaced(src.vertices, src.vertexBytes);
+                batch.mesh->index.assign(src.indices, src.indices + src.indexCount);
+                batch.mesh->indexCount = src.indexCount;
+                batch.ranges = src.ranges;
+                batch.sources = src.sources;
+                batch.lods = src.lods;
+
+                for (size_t r = 0; r < src.sources.size(); ++r)
+                {
+                    const auto &source = src.sources[r];
+                    if (source.mesh == (size_t)-1 || source.primitive == (size_t)-1) continue;
+                    if (out->lookup.size() <= source.mesh) out->lookup.resize(source.mesh + 1);
+                    auto &prims = out->lookup[source.mesh];
+                    if (prims.size() <= source.primitive) prims.resize(source.primitive + 1);
+                    prims[source.primitive] = {b, r};
+                }
+            }
+        }
+
+        if (outTextures != nullptr)
+        {
+            outTextures->clear();
+            outTextures->resize(textures.size());
+            for (size_t t = 0; t < textures.size(); ++t)
+            {
+                const auto &tex = textures[t];
+                if (tex.image >= images.size() || images[tex.image].pixels == nullptr) continue;
+                const auto &image = images[tex.image];
+                vector<texparam_t> params;
+                bool mipmap = false;
+                if (tex.hasSampler)
+                {
+                    if (tex.magFilter) params.emplace_back(GL_TEXTURE_MAG_FILTER, tex.magFilter);
+                    if (tex.minFilter) params.emplace_back(GL_TEXTURE_MIN_FILTER, tex.minFilter);
+                    params.emplace_back(GL_TEXTURE_WRAP_S, tex.wrapS);
+                    params.emplace_back(GL_TEXTURE_WRAP_T, tex.wrapT);
+                    mipmap = tex.minFilter != 0 && tex.minFilter != GL_NEAREST && tex.minFilter != GL_LINEAR;
+                }
+                auto texture = std::make_shared<texture_t>();
+                texture->generate(GL_TEXTURE_2D, 0, GL_RGBA8, 0, image.width, image.height, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels, params);
+                if (mipmap) glGenerateMipmap(GL_TEXTURE_2D);
+                (*outTextures)[t] = texture;
+            }
+        }
+    }
+}
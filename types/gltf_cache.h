@@ -0,0 +1,135 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <memory>
+
+#ifndef LAK_GL_INCLUDE
+#define LAK_GL_INCLUDE <GL/gl3w.h>
+#endif
+#include LAK_GL_INCLUDE
+
+#include "utils/mapped_file.h"
+#include "types/gltf.h"
+#include "types/gltf_loader.h"
+#include "types/gltf_batch.h"
+#include "types/scene_graph.h"
+#include "types/texture.h"
+
+#ifndef LAK_GLTF_CACHE_H
+#define LAK_GLTF_CACHE_H
+
+namespace lak
+{
+    using std::vector;
+    using std::string;
+    using std::shared_ptr;
+
+    // bump whenever the cache layout changes, old caches are then ignored
+    static const uint32_t gltfCacheVersion = 2;
+
+    struct gltfCacheElement_t
+    {
+        string name;
+        GLenum type = GL_FLOAT;
+        GLint size = 0;
+        bool normalised = false;
+        size_t offset = 0;          // byte offset within a vertex
+    };
+
+    // pointers are into the mapped cache file
+    struct gltfCacheBatch_t
+    {
+        GLenum drawMode = GL_TRIANGLES;
+        size_t stride = 0;
+        vector<gltfCacheElement_t> elements;
+        const uint8_t *vertices = nullptr;  // already interlaced
+        size_t vertexBytes = 0;
+        const GLuint *indices = nullptr;
+        size_t indexCount = 0;
+        vector<drawRange_t> ranges;
+        vector<gltfBatchSource_t> sources;
+        vector<vector<gltfLod_t>> lods;     // [range][level], see gltfBatch_t
+    };
+
+    struct gltfCacheImage_t
+    {
+        size_t width = 0;
+        size_t height = 0;
+        const uint8_t *pixels = nullptr;    // RGBA8
+    };
+
+    struct gltfCacheTexture_t
+    {
+        size_t image = -1;
+        bool hasSampler = false;
+        GLint magFilter = 0;
+        GLint minFilter = 0;
+        GLint wrapS = GL_REPEAT;
+        GLint wrapT = GL_REPEAT;
+    };
+
+    // fully processed glTF scene (interlaced batches, decoded images and the
+    // flattened node arrays) loaded straight out of a memory mapped file
+    struct gltfCache_t
+    {
+        // readonly
+        mappedFile_t file;
+        vector<gltfCacheBatch_t> batches;
+        vector<gltfCacheTexture_t> textures;    // index matches gltf_t::textures
+        vector<gltfCacheImage_t> images;        // index matches gltf_t::images
+        const uint8_t *_graph = nullptr;
+
+        // maps the cache, returns false if it's missing, corrupt, from another
+        // version, or if any of the source files it was built from changed
+        bool open(const string &path);
+        void close();
+
+        // copies the cached node arrays into graph (world transforms are
+        // recomputed by the next graph->update())
+        bool restore(sceneGraph_t *graph) const;
+
+        // creates the batch meshes and textures, must be called from the
+        // thread that owns the GL context
+        void upload(gltfBatches_t *out, vector<shared_ptr<texture_t>> *outTextures) const;
+    };
+
+    // files a glTF depends on: path itself plus every external buffer and image
+    vector<string> gltfSources(const gltf_t &gltf, const string &path, const string &directory);
+
+    // writes everything gltfCache_t needs to path, sources (see gltfSources)
+    // are hashed so the cache can be invalidated when they change
+    bool writeGLTFCache(const string &path, const vector<string> &sources, const gltf_t &gltf, const gltfData_t &data, const gltfBatches_t &batches, const sceneGraph_t &graph);
+}
+
+#ifdef LAK_GLTF_CACHE_IMPLEM
+#   ifndef LAK_GLTF_CACHE_HAS_IMPLEM
+#       define LAK_GLTF_CACHE_HAS_IMPLEM
+#       include "types/gltf_cache.cpp"
+#   endif // LAK_GLTF_CACHE_HAS_IMPLEM
+#endif // LAK_GLTF_CACHE_IMPLEM
+
+#endif // LAK_GLTF_CACHE_H
@@ -0,0 +1,115 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstring>
+
+#include "types/gltf_instancing.h"
+
+namespace lak
+{
+    void instanceGroup_t::update(const sceneGraph_t &graph)
+    {
+        if (!instanced || instanced->vertArray.buffers.size() < 2) return;
+        auto &buffer = instanced->vertArray.buffers[1];
+        auto &element = buffer.elements[matrixAttribute];
+        const size_t bytes = nodes.size() * sizeof(glm::mat4);
+        element.data.init(bytes, sizeof(glm::mat4));
+        uint8_t *dst = element.data.data.data();
+        for (size_t i = 0; i < nodes.size(); ++i)
+            memcpy(dst + (i * sizeof(glm::mat4)), &graph.world[nodes[i]], sizeof(glm::mat4));
+
+        // skip the re-interlace and index re-upload if the buffer already exists
+        if (buffer.init && buffer.size == bytes && !instanced->dirty)
+            buffer.write(dst, bytes);
+        else
+        {
+            element.dirty = true;
+            instanced->dirty = true;
+        }
+    }
+
+    void buildInstanceGroups(const gltf_t &gltf, const gltfData_t &data, const sceneGraph_t &graph, vector<instanceGroup_t> *out, const string &matrixAttribute)
+    {
+        out->clear();
+
+        // graph nodes that draw each mesh
+        vector<vector<size_t>> users(gltf.meshes.size());
+        for (size_t i = 0; i < graph.size(); ++i)
+        {
+            const auto &node = gltf.nodes[graph.node[i]];
+            if (node.mesh >= gltf.meshes.size() || node.skin != (size_t)-1) continue;
+            users[node.mesh].push_back(i);
+        }
+
+        for (size_t m = 0; m < gltf.meshes.size(); ++m)
+        {
+            if (users[m].empty()) continue;
+            for (size_t p = 0; p < gltf.meshes[m].primitives.size(); ++p)
+            {
+                const auto &prim = gltf.meshes[m].primitives[p];
+                const auto position = prim.attributes.find("POSITION");
+                if (!prim.targets.empty() || position == prim.attributes.end() || position->second >= gltf.accessors.size())
+                    continue;
+
+                instanceGroup_t group;
+                group.mesh = m;
+                group.primitive = p;
+                group.material = prim.material;
+                group.nodes = users[m];
+                group.matrixAttribute = matrixAttribute;
+                group.instanced = std::make_shared<mesh_t>();
+                group.instanced->drawMode = prim.mode;
+                group.instanced->vertArray.buffers.resize(2);
+
+                // geometry
+                bool valid = true;
+                for (const auto &attr : prim.attributes)
+                {
+                    vertexElement_t element;
+                    if (!gltfVertexElement(gltf, data, attr.second, &element)) { valid = false; break; }
+                    element.setActive(true);
+                    group.instanced->vertArray.buffers[0].elements[attr.first] = element;
+                }
+                if (!valid) continue;
+                const size_t indexCount = prim.indices != (size_t)-1 && prim.indices < gltf.accessors.size()
+                    ? gltf.accessors[prim.indices].count
+                    : gltf.accessors[position->second].count;
+                group.instanced->index.resize(indexCount);
+                gltfIndices(gltf, data, prim.indices, group.instanced->index.data(), indexCount);
+                group.instanced->indexCount = indexCount;
+
+                // instance matrices, rewritten every update so keep them dynamic
+                auto &instances = group.instanced->vertArray.buffers[1];
+                instances.usage = GL_DYNAMIC_DRAW;
+                auto &matrix = instances.elements[matrixAttribute];
+                matrix.type = GL_FLOAT;
+                matrix.size = 16;
+                matrix.setDivisor(1).setActive(true);
+                group.update(graph);
+
+                out->push_back(std::move(group));
+            }
+        }
+    }
+}
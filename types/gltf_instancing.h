@@ -0,0 +1,77 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <memory>
+
+#include "types/gltf.h"
+#include "types/gltf_loader.h"
+#include "types/scene_graph.h"
+#include "types/mesh.h"
+
+#ifndef LAK_GLTF_INSTANCING_H
+#define LAK_GLTF_INSTANCING_H
+
+namespace lak
+{
+    using std::vector;
+    using std::string;
+    using std::shared_ptr;
+
+    // every node that draws the same primitive, drawn with a single
+    // instanced call using a per instance world matrix (divisor 1)
+    struct instanceGroup_t
+    {
+        size_t mesh = -1;
+        size_t primitive = -1;
+        size_t material = -1;
+        vector<size_t> nodes;       // sceneGraph_t indices of each instance
+        // buffers[0] holds the geometry (elements named after the glTF
+        // attributes), buffers[1] the instance matrices
+        shared_ptr<mesh_t> instanced;
+        string matrixAttribute;
+
+        // copies the world matrices of nodes into the instance buffer, call
+        // after graph.update() whenever any of the instances moved
+        void update(const sceneGraph_t &graph);
+        inline void draw() { if (instanced && nodes.size()) instanced->draw((GLsizei)nodes.size()); }
+    };
+
+    // groups the nodes of graph by the mesh they draw and builds one
+    // instanceGroup_t per primitive. skinned nodes and meshes with morph
+    // targets are left out since their instances can't share vertex data.
+    // matrixAttribute is the mat4 shader attribute that receives the world matrix
+    void buildInstanceGroups(const gltf_t &gltf, const gltfData_t &data, const sceneGraph_t &graph, vector<instanceGroup_t> *out, const string &matrixAttribute = "instanceMatrix");
+}
+
+#ifdef LAK_GLTF_INSTANCING_IMPLEM
+#   ifndef LAK_GLTF_INSTANCING_HAS_IMPLEM
+#       define LAK_GLTF_INSTANCING_HAS_IMPLEM
+#       include "types/gltf_instancing.cpp"
+#   endif // LAK_GLTF_INSTANCING_HAS_IMPLEM
+#endif // LAK_GLTF_INSTANCING_IMPLEM
+
+#endif // LAK_GLTF_INSTANCING_H
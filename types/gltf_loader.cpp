@@ -0,0 +1,579 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <fstream>
+#include <cstring>
+#include <functional>
+#include <algorithm>
+
+#ifndef LAK_NO_STB_IMAGE_IMPLEM
+#define STB_IMAGE_IMPLEMENTATION
+#endif // LAK_NO_STB_IMAGE_IMPLEM
+#include <stb_image.h>
+
+#include "utils/ldebug.h"
+#include "types/gltf_loader.h"
+#include "types/meshopt.h"
+
+namespace lak
+{
+    using std::function;
+    using std::make_shared;
+    using std::lock_guard;
+    using std::ifstream;
+
+    bool decodeBase64(const char *str, size_t len, vector<uint8_t> *out)
+    {
+        out->clear();
+        out->reserve((len / 4) * 3);
+        uint32_t accum = 0;
+        size_t bits = 0;
+        for (size_t i = 0; i < len; ++i)
+        {
+            const char c = str[i];
+            uint32_t v;
+            if (c >= 'A' && c <= 'Z') v = c - 'A';
+            else if (c >= 'a' && c <= 'z') v = c - 'a' + 26;
+            else if (c >= '0' && c <= '9') v = c - '0' + 52;
+            else if (c == '+' || c == '-') v = 62;
+            else if (c == '/' || c == '_') v = 63;
+            else if (c == '=') break;
+            else if (c == ' ' || c == '\n' || c == '\r' || c == '\t') continue;
+            else return false;
+            accum = (accum << 6) | v;
+            bits += 6;
+            if (bits >= 8)
+            {
+                bits -= 8;
+                out->push_back((uint8_t)(accum >> bits));
+            }
+        }
+        return true;
+    }
+
+    size_t gltfComponentSize(GLenum componentType)
+    {
+        switch (componentType)
+        {
+            case GL_BYTE:
+            case GL_UNSIGNED_BYTE: return 1;
+            case GL_SHORT:
+            case GL_UNSIGNED_SHORT: return 2;
+            case GL_UNSIGNED_INT:
+            case GL_FLOAT: return 4;
+            default: return 0;
+        }
+    }
+
+    size_t gltfComponentCount(const string &type)
+    {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        if (type == "MAT2") return 4;
+        if (type == "MAT3") return 9;
+        if (type == "MAT4") return 16;
+        return 0;
+    }
+
+    template<typename BUFFER>
+    static const uint8_t *bufferViewOf(const gltf_t &gltf, const vector<BUFFER> &buffers, size_t bufferView)
+    {
+        if (bufferView >= gltf.bufferViews.size()) return nullptr;
+        const auto &view = gltf.bufferViews[bufferView];
+        if (view.buffer >= buffers.size()) return nullptr;
+        const auto &buffer = buffers[view.buffer];
+        if (view.byteOffset + view.byteLength > buffer.size()) return nullptr;
+        return buffer.data() + view.byteOffset;
+    }
+
+    const uint8_t *gltfBufferView(const gltf_t &gltf, const vector<vector<uint8_t>> &buffers, size_t bufferView)
+    {
+        return bufferViewOf(gltf, buffers, bufferView);
+    }
+
+    const uint8_t *gltfBufferView(const gltf_t &gltf, const vector<gltfBuffer_t> &buffers, size_t bufferView)
+    {
+        return bufferViewOf(gltf, buffers, bufferView);
+    }
+
+    template<typename BUFFER>
+    static bool readAccessorOf(const gltf_t &gltf, const vector<BUFFER> &buffers, size_t accessor, stride_vector *out)
+    {
+        if (accessor >= gltf.accessors.size()) return false;
+        const auto &acc = gltf.accessors[accessor];
+        const size_t elemSize = gltfComponentSize(acc.componentType) * gltfComponentCount(acc.type);
+        if (elemSize == 0) return false;
+
+        out->init(acc.count * elemSize, elemSize);
+        if (acc.count == 0) return true;
+
+        // no bufferView means all zeros (init already zeroed the data)
+        if (acc.bufferView != (size_t)-1)
+        {
+            const uint8_t *view = gltfBufferView(gltf, buffers, acc.bufferView);
+            if (view == nullptr) return false;
+            const auto &bv = gltf.bufferViews[acc.bufferView];
+            const size_t stride = bv.byteStride ? bv.byteStride : elemSize;
+            if (acc.byteOffset + (stride * (acc.count - 1)) + elemSize > bv.byteLength) return false;
+            const uint8_t *src = view + acc.byteOffset;
+            uint8_t *dst = out->data.data();
+            if (stride == elemSize)
+                memcpy(dst, src, acc.count * elemSize);
+            else for (size_t i = 0; i < acc.count; ++i)
+                memcpy(dst + (i * elemSize), src + (i * stride), elemSize);
+        }
+
+        if (acc.sparse.count > 0)
+        {
+            const auto &sparse = acc.sparse;
+            const size_t indexSize = gltfComponentSize(sparse.indices.componentType);
+            const uint8_t *indices = gltfBufferView(gltf, buffers, sparse.indices.bufferView);
+            const uint8_t *values = gltfBufferView(gltf, buffers, sparse.values.bufferView);
+            if (indices == nullptr || values == nullptr || indexSize == 0) return false;
+            if (sparse.indices.byteOffset + (sparse.count * indexSize) > gltf.bufferViews[sparse.indices.bufferView].byteLength) return false;
+            if (sparse.values.byteOffset + (sparse.count * elemSize) > gltf.bufferViews[sparse.values.bufferView].byteLength) return false;
+            indices += sparse.indices.byteOffset;
+            values += sparse.values.byteOffset;
+            for (size_t i = 0; i < sparse.count; ++i)
+            {
+                size_t index;
+                switch (indexSize)
+                {
+                    case 1: index = indices[i]; break;
+                    case 2: { uint16_t v; memcpy(&v, indices + (i * 2), 2); index = v; } break;
+                    default: { uint32_t v; memcpy(&v, indices + (i * 4), 4); index = v; } break;
+                }
+                if (index >= acc.count) return false;
+                memcpy(out->data.data() + (index * elemSize), values + (i * elemSize), elemSize);
+            }
+        }
+
+        return true;
+    }
+
+    bool readAccessor(const gltf_t &gltf, const vector<vector<uint8_t>> &buffers, size_t accessor, stride_vector *out)
+    {
+        return readAccessorOf(gltf, buffers, accessor, out);
+    }
+
+    bool readAccessor(const gltf_t &gltf, const vector<gltfBuffer_t> &buffers, size_t accessor, stride_vector *out)
+    {
+        return readAccessorOf(gltf, buffers, accessor, out);
+    }
+
+    template<typename T>
+    static void toFloat(const uint8_t *src, size_t count, float *dst, float scale, float minimum)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            T v;
+            memcpy(&v, src + (i * sizeof(T)), sizeof(T));
+            const float f = (float)v * scale;
+            dst[i] = f < minimum ? minimum : f;
+        }
+    }
+
+    bool accessorToFloat(const gltf_t &gltf, size_t accessor, const stride_vector &data, vector<float> *out, bool normalized)
+    {
+        if (accessor >= gltf.accessors.size()) return false;
+        const GLenum type = gltf.accessors[accessor].componentType;
+        const size_t size = gltfComponentSize(type);
+        if (size == 0) return false;
+        const size_t count = data.size() / size;
+        out->resize(count);
+        const uint8_t *src = data.data.data();
+        float *dst = out->data();
+        // normalization as defined by the glTF spec
+        switch (type)
+        {
+            case GL_FLOAT: memcpy(dst, src, count * sizeof(float)); break;
+            case GL_BYTE: toFloat<int8_t>(src, count, dst, normalized ? 1.0f / 127.0f : 1.0f, normalized ? -1.0f : -128.0f); break;
+            case GL_UNSIGNED_BYTE: toFloat<uint8_t>(src, count, dst, normalized ? 1.0f / 255.0f : 1.0f, 0.0f); break;
+            case GL_SHORT: toFloat<int16_t>(src, count, dst, normalized ? 1.0f / 32767.0f : 1.0f, normalized ? -1.0f : -32768.0f); break;
+            case GL_UNSIGNED_SHORT: toFloat<uint16_t>(src, count, dst, normalized ? 1.0f / 65535.0f : 1.0f, 0.0f); break;
+            case GL_UNSIGNED_INT: toFloat<uint32_t>(src, count, dst, normalized ? 1.0f / 4294967295.0f : 1.0f, 0.0f); break;
+            default: return false;
+        }
+        return true;
+    }
+
+    bool gltfExtensionSupported(const string &extension)
+    {
+        static const char *supported[] = {
+            "KHR_mesh_quantization",
+            "EXT_meshopt_compression",
+        };
+        for (const char *ext : supported)
+            if (extension == ext) return true;
+        return false;
+    }
+
+    static bool readBinaryFile(const string &path, vector<uint8_t> *out)
+    {
+        ifstream strm(path, std::ios::binary | std::ios::ate);
+        if (!strm.is_open()) return false;
+        const std::streamsize size = strm.tellg();
+        if (size < 0) return false;
+        out->resize((size_t)size);
+        strm.seekg(0);
+        return size == 0 || (bool)strm.read((char*)out->data(), size);
+    }
+
+    // loads either a data uri or a file relative to directory
+    static bool readURI(const string &uri, const string &directory, vector<uint8_t> *out)
+    {
+        if (uri.compare(0, 5, "data:") == 0)
+        {
+            const size_t start = uri.find(";base64,");
+            if (start == string::npos) return false;
+            return decodeBase64(uri.c_str() + start + 8, uri.size() - (start + 8), out);
+        }
+        if (directory.empty() || directory.back() == '/' || directory.back() == '\\')
+            return readBinaryFile(directory + uri, out);
+        return readBinaryFile(directory + "/" + uri, out);
+    }
+
+    bool gltfDecodeImage(const uint8_t *src, size_t size, imageRGBA8_t *out)
+    {
+        int w, h, channels;
+        stbi_uc *pixels = stbi_load_from_memory(src, (int)size, &w, &h, &channels, 4);
+        if (pixels == nullptr) return false;
+        out->resize(w, h);
+        static_assert(sizeof(colorRGBA8_t) == 4);
+        memcpy((void*)out->pixels.data(), pixels, (size_t)w * (size_t)h * 4);
+        stbi_image_free(pixels);
+        return true;
+    }
+
+    // shared state for a single call to loadGLTF, kept alive by the tasks
+    struct _gltfLoad_t
+    {
+        const gltf_t &gltf;
+        string directory;
+        workerPool_t &pool;
+        gltfData_t *data;
+        // tasks that need one or more buffers to be loaded first
+        vector<function<void()>> waiting;
+        std::unique_ptr<atomic<size_t>[]> waitCount;
+        vector<vector<size_t>> dependents;  // index matches gltf_t::buffers
+        std::unique_ptr<atomic<size_t>[]> decodeCount; // compressed views left to decode per buffer
+
+        _gltfLoad_t(const gltf_t &g, const string &dir, workerPool_t &p, gltfData_t *d)
+        : gltf(g), directory(dir), pool(p), data(d) {}
+
+        void error(const string &msg)
+        {
+            LERROR(msg);
+            lock_guard<mutex> lock(data->_lock);
+            data->errors.push_back(msg);
+        }
+
+        // queues func once all of buffers have been loaded
+        void after(const vector<size_t> &buffers, function<void()> func)
+        {
+            vector<size_t> unique;
+            for (size_t b : buffers)
+                if (b < dependents.size() && std::find(unique.begin(), unique.end(), b) == unique.end())
+                    unique.push_back(b);
+            if (unique.empty())
+            {
+                pool.push(std::move(func));
+                return;
+            }
+            const size_t task = waiting.size();
+            waiting.push_back(std::move(func));
+            for (size_t b : unique)
+                dependents[b].push_back(task);
+        }
+
+        void bufferLoaded(size_t buffer)
+        {
+            for (size_t task : dependents[buffer])
+                if (--waitCount[task] == 0)
+                    pool.push(std::move(waiting[task])); // breaks the load <-> task cycle
+        }
+    };
+
+    void loadGLTF(const gltf_t &gltf, const string &directory, workerPool_t &pool, gltfData_t *data)
+    {
+        data->buffers.resize(gltf.buffers.size());
+        data->images.clear();
+        data->images.resize(gltf.images.size());
+        data->accessors.clear();
+        data->accessors.resize(gltf.accessors.size());
+        data->textures.clear();
+        data->textures.resize(gltf.textures.size());
+        data->errors.clear();
+        data->_decoded.clear();
+
+        // still try to load, anything unsupported just won't decode properly
+        for (const auto &ext : gltf.extensionsRequired)
+            if (!gltfExtensionSupported(ext))
+                data->errors.push_back("Unsupported required extension " + ext);
+
+        auto load = make_shared<_gltfLoad_t>(gltf, directory, pool, data);
+        load->dependents.resize(gltf.buffers.size());
+
+        auto bufferOf = [&gltf](size_t bufferView) -> size_t {
+            return bufferView < gltf.bufferViews.size() ? gltf.bufferViews[bufferView].buffer : (size_t)-1;
+        };
+
+        // one task per buffer, image and accessor
+        data->_remaining = gltf.buffers.size() + gltf.images.size() + gltf.accessors.size();
+
+        // EXT_meshopt_compression views are decoded (one task each) into their
+        // fallback buffer, which counts as loaded once all its views are done
+        auto compressedView = [&gltf](const gltf_t::bufferView_t &view) {
+            const auto &meshopt = view.extensions.meshopt;
+            return meshopt.buffer < gltf.buffers.size() && view.buffer < gltf.buffers.size() && meshopt.buffer != view.buffer;
+        };
+        vector<size_t> compressed(gltf.buffers.size(), 0);
+        for (const auto &view : gltf.bufferViews)
+            if (compressedView(view)) ++compressed[view.buffer];
+        load->decodeCount.reset(new atomic<size_t>[compressed.size()]());
+        for (size_t i = 0; i < compressed.size(); ++i)
+        {
+            load->decodeCount[i] = compressed[i];
+            if (compressed[i] > 0) data->buffers[i].assign(gltf.buffers[i].byteLength, 0);
+        }
+        for (size_t i = 0; i < gltf.bufferViews.size(); ++i)
+        {
+            if (!compressedView(gltf.bufferViews[i])) continue;
+            load->after({gltf.bufferViews[i].extensions.meshopt.buffer}, [load, i]{
+                const auto &view = load->gltf.bufferViews[i];
+                const auto &meshopt = view.extensions.meshopt;
+                const auto &src = load->data->buffers[meshopt.buffer];
+                auto &dst = load->data->buffers[view.buffer];
+                const size_t size = meshopt.count * meshopt.byteStride;
+                if (meshopt.byteOffset + meshopt.byteLength > src.size() || size > view.byteLength || view.byteOffset + size > dst.size())
+                    load->error("Compressed bufferView " + std::to_string(i) + " is out of range");
+                else if (!decodeMeshopt(meshopt, src.data() + meshopt.byteOffset, dst.data() + view.byteOffset))
+                    load->error("Failed to decode bufferView " + std::to_string(i));
+                if (--load->decodeCount[view.buffer] == 0)
+                {
+                    load->bufferLoaded(view.buffer);
+                    --load->data->_remaining;
+                }
+            });
+        }
+
+        // images
+        vector<function<void()>> immediate;
+        for (size_t i = 0; i < gltf.images.size(); ++i)
+        {
+            const auto &image = gltf.images[i];
+            auto decode = [load, i]{
+                const auto &image = load->gltf.images[i];
+                gltfData_t *data = load->data;
+                bool loaded = false;
+                if (image.uri != "")
+                {
+                    vector<uint8_t> file;
+                    if (readURI(image.uri, load->directory, &file))
+                        loaded = gltfDecodeImage(file.data(), file.size(), &data->images[i]);
+                }
+                else if (const uint8_t *view = gltfBufferView(load->gltf, data->buffers, image.bufferView); view)
+                {
+                    loaded = gltfDecodeImage(view, load->gltf.bufferViews[image.bufferView].byteLength, &data->images[i]);
+                }
+                if (loaded)
+                {
+                    lock_guard<mutex> lock(data->_lock);
+                    data->_decoded.push_back(i);
+                }
+                else load->error("Failed to load image " + std::to_string(i));
+                --data->_remaining;
+            };
+            if (image.uri != "")
+                immediate.push_back(decode);
+            else
+                load->after({bufferOf(image.bufferView)}, decode);
+        }
+
+        // accessors
+        for (size_t i = 0; i < gltf.accessors.size(); ++i)
+        {
+            const auto &acc = gltf.accessors[i];
+            auto convert = [load, i]{
+                if (!readAccessor(load->gltf, load->data->buffers, i, &load->data->accessors[i]))
+                    load->error("Failed to read accessor " + std::to_string(i));
+                --load->data->_remaining;
+            };
+            vector<size_t> needs;
+            if (acc.bufferView != (size_t)-1) needs.push_back(bufferOf(acc.bufferView));
+            if (acc.sparse.count > 0)
+            {
+                needs.push_back(bufferOf(acc.sparse.indices.bufferView));
+                needs.push_back(bufferOf(acc.sparse.values.bufferView));
+            }
+            load->after(needs, convert);
+        }
+
+        load->waitCount.reset(new atomic<size_t>[load->waiting.size()]());
+        for (size_t b = 0; b < load->dependents.size(); ++b)
+            for (size_t task : load->dependents[b])
+                ++load->waitCount[task];
+
+        // everything is set up, start the buffer loads
+        for (size_t i = 0; i < gltf.buffers.size(); ++i)
+        {
+            // filled in by the decode tasks instead
+            if (compressed[i] > 0) continue;
+            pool.push([load, i]{
+                const auto &buffer = load->gltf.buffers[i];
+                auto &dst = load->data->buffers[i];
+                if (buffer.uri == "")
+                {
+                    // GLB binary chunk, should already be loaded
+                    if (dst.size() < buffer.byteLength)
+                        load->error("Missing binary chunk for buffer " + std::to_string(i));
+                }
+                else if (!readURI(buffer.uri, load->directory, &dst))
+                    load->error("Failed to load buffer " + std::to_string(i) + " (" + buffer.uri + ")");
+                else if (dst.size() < buffer.byteLength)
+                    load->error("Buffer " + std::to_string(i) + " is smaller than byteLength");
+                // dependents check bounds themselves, so release them either way
+                load->bufferLoaded(i);
+                --load->data->_remaining;
+            });
+        }
+        for (auto &task : immediate)
+            pool.push(std::move(task));
+    }
+
+    size_t uploadGLTF(const gltf_t &gltf, gltfData_t *data, size_t maxUploads)
+    {
+        vector<size_t> decoded;
+        {
+            lock_guard<mutex> lock(data->_lock);
+            if (data->_decoded.size() <= maxUploads)
+                decoded.swap(data->_decoded);
+            else
+            {
+                decoded.assign(data->_decoded.begin(), data->_decoded.begin() + maxUploads);
+                data->_decoded.erase(data->_decoded.begin(), data->_decoded.begin() + maxUploads);
+            }
+        }
+
+        data->textures.resize(gltf.textures.size());
+        for (size_t image : decoded)
+        {
+            for (size_t t = 0; t < gltf.textures.size(); ++t)
+            {
+                if (gltf.textures[t].source != image) continue;
+                data->textures[t] = gltfTexture(gltf, t, data->images[image]);
+            }
+        }
+        return decoded.size();
+    }
+
+    shared_ptr<texture_t> gltfTexture(const gltf_t &gltf, size_t texture, const imageRGBA8_t &image)
+    {
+        vector<texparam_t> params;
+        bool mipmap = false;
+        if (texture < gltf.textures.size() && gltf.textures[texture].sampler < gltf.samplers.size())
+        {
+            const auto &sampler = gltf.samplers[gltf.textures[texture].sampler];
+            if (sampler.magFilter) params.emplace_back(GL_TEXTURE_MAG_FILTER, (GLint)sampler.magFilter);
+            if (sampler.minFilter) params.emplace_back(GL_TEXTURE_MIN_FILTER, (GLint)sampler.minFilter);
+            params.emplace_back(GL_TEXTURE_WRAP_S, (GLint)sampler.wrapS);
+            params.emplace_back(GL_TEXTURE_WRAP_T, (GLint)sampler.wrapT);
+            mipmap = sampler.minFilter != 0 && sampler.minFilter != GL_NEAREST && sampler.minFilter != GL_LINEAR;
+        }
+        auto result = make_shared<texture_t>();
+        result->generate(GL_TEXTURE_2D, 0, GL_RGBA8, 0, image, params);
+        if (mipmap) glGenerateMipmap(GL_TEXTURE_2D);
+        return result;
+    }
+
+    bool gltfVertexElement(const gltf_t &gltf, const gltfData_t &data, size_t accessor, vertexElement_t *element)
+    {
+        if (accessor >= data.accessors.size()) return false;
+        return gltfVertexElement(gltf, data.accessors[accessor], accessor, element);
+    }
+
+    bool gltfVertexElement(const gltf_t &gltf, const stride_vector &src, size_t accessor, vertexElement_t *element)
+    {
+        if (accessor >= gltf.accessors.size()) return false;
+        const auto &acc = gltf.accessors[accessor];
+        const GLint count = (GLint)gltfComponentCount(acc.type);
+        // matrices can't be a single vertex attribute
+        if (count == 0 || count > 4 || src.stride == 0) return false;
+
+        const size_t padded = (src.stride + 3) & ~(size_t)3;
+        if (padded == src.stride)
+        {
+            element->setData(acc.componentType, count, src);
+        }
+        else
+        {
+            const size_t elems = src.size() / src.stride;
+            stride_vector dst;
+            dst.init(elems * padded, padded);
+            for (size_t i = 0; i < elems; ++i)
+                memcpy(dst.data.data() + (i * padded), src.data.data() + (i * src.stride), src.stride);
+            element->setData(acc.componentType, count, dst);
+        }
+        element->setNormalised(acc.normalized);
+        return true;
+    }
+
+    bool gltfIndices(const gltf_t &gltf, const gltfData_t &data, size_t accessor, GLuint *out, size_t count)
+    {
+        return gltfIndices(gltf, accessor < data.accessors.size() ? &data.accessors[accessor] : nullptr, accessor, out, count);
+    }
+
+    bool gltfIndices(const gltf_t &gltf, const stride_vector *src, size_t accessor, GLuint *out, size_t count)
+    {
+        if (accessor == (size_t)-1)
+        {
+            for (size_t i = 0; i < count; ++i)
+                out[i] = (GLuint)i;
+            return true;
+        }
+        const size_t indexSize = accessor < gltf.accessors.size() ? gltfComponentSize(gltf.accessors[accessor].componentType) : 0;
+        if (src == nullptr || indexSize == 0 || src->size() < count * indexSize)
+        {
+            // draw nothing rather than garbage
+            memset(out, 0, count * sizeof(GLuint));
+            return false;
+        }
+        const uint8_t *bytes = src->data.data();
+        switch (indexSize)
+        {
+            case 1:
+                for (size_t i = 0; i < count; ++i) out[i] = bytes[i];
+                break;
+            case 2:
+                for (size_t i = 0; i < count; ++i) { uint16_t v; memcpy(&v, bytes + (i * 2), 2); out[i] = v; }
+                break;
+            default:
+                memcpy(out, bytes, count * sizeof(GLuint));
+                break;
+        }
+        return true;
+    }
+}
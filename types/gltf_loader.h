@@ -0,0 +1,147 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+#ifndef LAK_GL_INCLUDE
+#define LAK_GL_INCLUDE <GL/gl3w.h>
+#endif
+#include LAK_GL_INCLUDE
+
+#include "types/gltf.h"
+#include "types/image.h"
+#include "types/texture.h"
+#include "types/stride_vector.h"
+#include "types/worker_pool.h"
+#include "types/mesh.h"
+
+#ifndef LAK_GLTF_LOADER_H
+#define LAK_GLTF_LOADER_H
+
+namespace lak
+{
+    using std::vector;
+    using std::string;
+    using std::shared_ptr;
+    using std::mutex;
+    using std::atomic;
+
+    // decodes base64 (whitespace is ignored), returns false on bad input
+    bool decodeBase64(const char *str, size_t len, vector<uint8_t> *out);
+
+    // size in bytes of a glTF componentType (GL_FLOAT = 4, etc), 0 if invalid
+    size_t gltfComponentSize(GLenum componentType);
+    // component count of a glTF accessor type ("SCALAR" = 1, "VEC3" = 3, etc), 0 if invalid
+    size_t gltfComponentCount(const string &type);
+
+    // buffer contents that aren't owned by a vector (memory mapped files, etc)
+    struct gltfBuffer_t
+    {
+        const uint8_t *ptr = nullptr;
+        size_t bytes = 0;
+        inline const uint8_t *data() const { return ptr; }
+        inline size_t size() const { return bytes; }
+    };
+
+    // pointer to the start of a bufferView, nullptr if it's out of range
+    const uint8_t *gltfBufferView(const gltf_t &gltf, const vector<vector<uint8_t>> &buffers, size_t bufferView);
+    const uint8_t *gltfBufferView(const gltf_t &gltf, const vector<gltfBuffer_t> &buffers, size_t bufferView);
+
+    // copies an accessor into out as tightly packed elements (out->stride is
+    // the element size), componentType is left as is and sparse values are
+    // applied. returns false if the accessor references data out of range
+    bool readAccessor(const gltf_t &gltf, const vector<vector<uint8_t>> &buffers, size_t accessor, stride_vector *out);
+    bool readAccessor(const gltf_t &gltf, const vector<gltfBuffer_t> &buffers, size_t accessor, stride_vector *out);
+
+    // converts the elements of an accessor (as read by readAccessor) to
+    // floats, integer types are mapped to [0, 1] or [-1, 1] if normalized
+    bool accessorToFloat(const gltf_t &gltf, size_t accessor, const stride_vector &data, vector<float> *out, bool normalized);
+
+    // true for extensions loadGLTF understands (KHR_mesh_quantization, etc)
+    bool gltfExtensionSupported(const string &extension);
+
+    // decodes a png/jpeg/etc image to RGBA8, returns false if stb_image can't
+    bool gltfDecodeImage(const uint8_t *src, size_t size, imageRGBA8_t *out);
+
+    struct gltfData_t
+    {
+        // readonly (once done() returns true)
+        vector<vector<uint8_t>> buffers;        // index matches gltf_t::buffers
+        vector<imageRGBA8_t> images;            // index matches gltf_t::images
+        vector<stride_vector> accessors;        // index matches gltf_t::accessors
+        vector<shared_ptr<texture_t>> textures; // index matches gltf_t::textures (filled by uploadGLTF)
+        vector<string> errors;
+        // NOTE: buffers[0] can be filled before calling loadGLTF with the
+        // contents of a GLB binary chunk, buffers without a uri are not loaded
+        atomic<size_t> _remaining{0};
+        mutex _lock;
+        vector<size_t> _decoded;                // images decoded but not yet uploaded
+        inline bool done() const { return _remaining == 0; }
+    };
+
+    // queues up buffer loading, base64 decoding, image decoding and accessor
+    // conversion as tasks in pool. returns immediately, gltf and data must
+    // outlive the load (use pool.wait() or data->done() to check for completion)
+    // uris are relative to directory
+    void loadGLTF(const gltf_t &gltf, const string &directory, workerPool_t &pool, gltfData_t *data);
+
+    // creates textures for any images that have finished decoding since the
+    // last call, must be called from the thread that owns the GL context.
+    // returns the number of images uploaded, call with maxUploads to limit
+    // the amount of work done per frame
+    size_t uploadGLTF(const gltf_t &gltf, gltfData_t *data, size_t maxUploads = -1);
+
+    // creates gltf.textures[texture] from image using its sampler's filter and
+    // wrap modes (generating mipmaps if needed), must be called from the
+    // thread that owns the GL context
+    shared_ptr<texture_t> gltfTexture(const gltf_t &gltf, size_t texture, const imageRGBA8_t &image);
+
+    // sets up element to push an accessor to the GPU as is, integer
+    // (quantized) data is not expanded to floats and normalized accessors
+    // are normalised by GL. elements are padded to 4 bytes so they stay
+    // aligned when interlaced
+    bool gltfVertexElement(const gltf_t &gltf, const gltfData_t &data, size_t accessor, vertexElement_t *element);
+    // as above, for accessor data read with readAccessor
+    bool gltfVertexElement(const gltf_t &gltf, const stride_vector &src, size_t accessor, vertexElement_t *element);
+
+    // writes count indices from an index accessor to out as GLuints, or 0 to
+    // count-1 if accessor is -1 (non-indexed primitive). out is zeroed if the
+    // accessor didn't load
+    bool gltfIndices(const gltf_t &gltf, const gltfData_t &data, size_t accessor, GLuint *out, size_t count);
+    bool gltfIndices(const gltf_t &gltf, const stride_vector *src, size_t accessor, GLuint *out, size_t count);
+}
+
+#ifdef LAK_GLTF_LOADER_IMPLEM
+#   ifndef LAK_GLTF_LOADER_HAS_IMPLEM
+#       define LAK_GLTF_LOADER_HAS_IMPLEM
+#       include "types/gltf_loader.cpp"
+#   endif // LAK_GLTF_LOADER_HAS_IMPLEM
+#endif // LAK_GLTF_LOADER_IMPLEM
+
+#endif // LAK_GLTF_LOADER_H
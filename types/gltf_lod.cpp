@@ -0,0 +1,132 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+
+#include "types/gltf_lod.h"
+#include "types/mesh_simplify.h"
+
+namespace lak
+{
+    // float attribute of a batch usable by the simplifier, null otherwise
+    static const vertexElement_t *floatElement(const mesh_t &mesh, const char *name, GLint minSize)
+    {
+        const auto &elements = mesh.vertArray.buffers[0].elements;
+        const auto it = elements.find(name);
+        if (it == elements.end()) return nullptr;
+        const auto &elem = it->second;
+        if (!elem.active || elem.type != GL_FLOAT || elem.size < minSize) return nullptr;
+        if (elem.data.stride < sizeof(float) * elem.size || elem.data.size() == 0) return nullptr;
+        return &elem;
+    }
+
+    void buildBatchLods(gltfBatches_t *batches, size_t levels, float ratio, float maxError)
+    {
+        vector<uint32_t> lod;
+        for (auto &batch : batches->batches)
+        {
+            batch.lods.clear();
+            if (!batch.mesh || batch.mesh->drawMode != GL_TRIANGLES || batch.mesh->vertArray.buffers.empty()) continue;
+            const vertexElement_t *position = floatElement(*batch.mesh, "POSITION", 3);
+            if (position == nullptr) continue;
+            const vertexElement_t *normal = floatElement(*batch.mesh, "NORMAL", 3);
+            const vertexElement_t *texcoord = floatElement(*batch.mesh, "TEXCOORD_0", 2);
+            const size_t vertexTotal = position->data.size() / position->data.stride;
+            auto &index = batch.mesh->index;
+
+            batch.lods.resize(batch.ranges.size());
+            for (size_t r = 0; r < batch.ranges.size(); ++r)
+            {
+                const drawRange_t original = batch.ranges[r];
+                auto &chain = batch.lods[r];
+                chain.push_back({original, 0.0f});
+                if (original.baseVertex < 0 || (size_t)original.baseVertex >= vertexTotal) continue;
+
+                // indices are relative to baseVertex, so the primitive's
+                // vertices can be handed over as their own array
+                const size_t base = original.baseVertex;
+                const auto vertexAt = [&](const vertexElement_t *elem) {
+                    return (const float*)(elem->data.data.data() + (base * elem->data.stride));
+                };
+                if (original.count < 3 || original.firstIndex + original.count > index.size()) continue;
+                const float *positions = vertexAt(position);
+                // only this primitive's vertices, errors are relative to its
+                // own extent and the simplifier's arrays stay its size
+                const size_t vertexCount = (size_t)*std::max_element(index.begin() + original.firstIndex,
+                    index.begin() + original.firstIndex + original.count) + 1;
+                if (vertexCount > vertexTotal - base) continue;
+                const float scale = simplifyScale(positions, vertexCount, position->data.stride);
+                if (scale <= 0.0f) continue;
+
+                simplifyAttribute_t attributes[2];
+                size_t attributeCount = 0;
+                if (normal) attributes[attributeCount++] = {vertexAt(normal), normal->data.stride, 3, 0.01f};
+                if (texcoord) attributes[attributeCount++] = {vertexAt(texcoord), texcoord->data.stride, 2, 0.1f};
+
+                for (size_t level = 1; level < levels; ++level)
+                {
+                    const drawRange_t &previous = chain.back().range;
+                    const size_t target = (size_t)(previous.count * ratio) / 3 * 3;
+                    // each level is only measured against the previous one,
+                    // so errors add up and later levels get what's left
+                    const float budget = maxError - (chain.back().error / scale);
+                    if (budget <= 0.0f) break;
+                    lod.resize(previous.count);
+                    float error = 0.0f;
+                    const size_t count = simplifyMesh(lod.data(), index.data() + previous.firstIndex, previous.count,
+                        positions, vertexCount, position->data.stride, attributes, attributeCount, target, budget, &error);
+                    // not worth another draw range
+                    if (count == 0 || count > (size_t)previous.count - (previous.count / 20)) break;
+                    const float total = chain.back().error + (error * scale);
+                    if (total > maxError * scale) break;
+
+                    gltfLod_t next;
+                    next.range.count = (GLsizei)count;
+                    next.range.firstIndex = index.size();
+                    next.range.baseVertex = original.baseVertex;
+                    next.error = total;
+                    index.insert(index.end(), lod.begin(), lod.begin() + count);
+                    chain.push_back(next);
+                }
+            }
+            batch.mesh->indexCount = index.size();
+            batch.mesh->dirty = true;
+        }
+    }
+
+    size_t selectLod(const vector<gltfLod_t> &lods, float distance, float scale, float pixelsPerUnit, float maxPixels)
+    {
+        if (lods.empty()) return 0;
+        // anything at or behind the camera plane gets full detail
+        if (distance <= 0.0f) return 0;
+        const float pixelsPerError = (scale * pixelsPerUnit) / distance;
+        size_t best = 0;
+        for (size_t l = 1; l < lods.size(); ++l)
+        {
+            if (lods[l].error * pixelsPerError > maxPixels) break;
+            best = l;
+        }
+        return best;
+    }
+}
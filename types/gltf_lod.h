@@ -0,0 +1,62 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <vector>
+
+#include "types/gltf_batch.h"
+
+#ifndef LAK_GLTF_LOD_H
+#define LAK_GLTF_LOD_H
+
+namespace lak
+{
+    using std::vector;
+
+    // simplifies every triangle range in batches into a chain of up to levels
+    // lods (level 0 is the original range), each aiming for ratio times the
+    // indices of the previous one. the new indices are appended to each
+    // batch's index buffer and reuse its vertices, so lods are drawn exactly
+    // like the original ranges. each level's error is the sum of the errors
+    // of the steps leading to it (a conservative bound against the original
+    // range), and a chain stops early once that would exceed maxError
+    // (relative to the primitive's size) or a level barely reduces it. only batches with a float POSITION are simplified,
+    // float NORMAL and TEXCOORD_0 are kept from sliding across the surface.
+    // must run before the batch meshes are first drawn (or set mesh->dirty)
+    void buildBatchLods(gltfBatches_t *batches, size_t levels = 4, float ratio = 0.5f, float maxError = 0.05f);
+
+    // picks the coarsest lod whose error projects to at most maxPixels.
+    // distance is from the camera to the object, scale the largest axis of
+    // its world scale and pixelsPerUnit = viewportHeight / (2 * tan(fovY / 2)).
+    // returns 0 (the original) if lods is empty
+    size_t selectLod(const vector<gltfLod_t> &lods, float distance, float scale, float pixelsPerUnit, float maxPixels = 1.0f);
+}
+
+#ifdef LAK_GLTF_LOD_IMPLEM
+#   ifndef LAK_GLTF_LOD_HAS_IMPLEM
+#       define LAK_GLTF_LOD_HAS_IMPLEM
+#       include "types/gltf_lod.cpp"
+#   endif // LAK_GLTF_LOD_HAS_IMPLEM
+#endif // LAK_GLTF_LOD_IMPLEM
+
+#endif // LAK_GLTF_LOD_H
@@ -0,0 +1,126 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <map>
+#include <array>
+
+#include "types/gltf_material.h"
+
+namespace lak
+{
+    using std::map;
+    using std::array;
+
+    // reads a textureInfo object ({"index": n, "texCoord": n, ...})
+    static bool readTexture(const JSON *info, const gltf_t &gltf, gltfMaterial_t *material, gltfMaterial_t::slot_t slot)
+    {
+        if (info == nullptr) return true;
+        size_t index = -1;
+        size_t texCoord = 0;
+        (*info)("index"s, index);
+        (*info)("texCoord"s, texCoord);
+        if (index >= gltf.textures.size()) return false;
+        material->texture[slot] = (uint32_t)index;
+        material->texCoord[slot] = (uint8_t)texCoord;
+        return true;
+    }
+
+    static glm::vec4 readVec4(const JSON &json, const string &key, const glm::vec4 &fallback)
+    {
+        vector<double> v;
+        if (!json(key, v) || v.size() != 4) return fallback;
+        return glm::vec4((float)v[0], (float)v[1], (float)v[2], (float)v[3]);
+    }
+
+    static glm::vec3 readVec3(const JSON &json, const string &key, const glm::vec3 &fallback)
+    {
+        vector<double> v;
+        if (!json(key, v) || v.size() != 3) return fallback;
+        return glm::vec3((float)v[0], (float)v[1], (float)v[2]);
+    }
+
+    bool compileMaterials(const gltf_t &gltf, vector<gltfMaterial_t> *out)
+    {
+        bool ok = true;
+        out->assign(gltf.materials.size() + 1, gltfMaterial_t());
+
+        for (size_t i = 0; i < gltf.materials.size(); ++i)
+        {
+            const JSON &details = gltf.materials[i].details;
+            gltfMaterial_t &material = (*out)[i];
+
+            if (const JSON *pbr = details("pbrMetallicRoughness"s); pbr)
+            {
+                material.baseColorFactor = readVec4(*pbr, "baseColorFactor"s, material.baseColorFactor);
+                (*pbr)("metallicFactor"s, material.metallicFactor);
+                (*pbr)("roughnessFactor"s, material.roughnessFactor);
+                ok &= readTexture((*pbr)("baseColorTexture"s), gltf, &material, gltfMaterial_t::BASE_COLOR);
+                ok &= readTexture((*pbr)("metallicRoughnessTexture"s), gltf, &material, gltfMaterial_t::METALLIC_ROUGHNESS);
+            }
+            if (const JSON *normal = details("normalTexture"s); normal)
+            {
+                ok &= readTexture(normal, gltf, &material, gltfMaterial_t::NORMAL);
+                (*normal)("scale"s, material.normalScale);
+            }
+            if (const JSON *occlusion = details("occlusionTexture"s); occlusion)
+            {
+                ok &= readTexture(occlusion, gltf, &material, gltfMaterial_t::OCCLUSION);
+                (*occlusion)("strength"s, material.occlusionStrength);
+            }
+            ok &= readTexture(details("emissiveTexture"s), gltf, &material, gltfMaterial_t::EMISSIVE);
+            material.emissiveFactor = readVec3(details, "emissiveFactor"s, material.emissiveFactor);
+
+            string alphaMode;
+            details("alphaMode"s, alphaMode);
+            if (alphaMode == "MASK") material.alphaMode = gltfMaterial_t::ALPHA_MASK;
+            else if (alphaMode == "BLEND") material.alphaMode = gltfMaterial_t::ALPHA_BLEND;
+            details("alphaCutoff"s, material.alphaCutoff);
+            details("doubleSided"s, material.doubleSided);
+        }
+
+        // number the unique texture combinations so draws can be grouped by them
+        map<array<uint32_t, gltfMaterial_t::SLOT_COUNT>, uint32_t> sets;
+        for (auto &material : *out)
+        {
+            array<uint32_t, gltfMaterial_t::SLOT_COUNT> key;
+            bool textured = false;
+            for (size_t s = 0; s < key.size(); ++s)
+            {
+                key[s] = material.texture[s];
+                textured |= key[s] != (uint32_t)-1;
+            }
+            if (!textured) continue;
+            material.textureSet = sets.emplace(key, (uint32_t)sets.size() + 1).first->second;
+        }
+
+        return ok;
+    }
+
+    uint64_t gltfDrawKey(const vector<gltfMaterial_t> &materials, size_t material, uint32_t shader, float depth)
+    {
+        if (material >= materials.size()) material = materials.size() - 1;
+        const gltfMaterial_t &m = materials[material];
+        return drawSortKey(shader, m.textureSet, (uint32_t)material, depth, m.alphaMode == gltfMaterial_t::ALPHA_BLEND);
+    }
+}
@@ -0,0 +1,79 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <vector>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "types/gltf.h"
+#include "types/draw_sort.h"
+
+#ifndef LAK_GLTF_MATERIAL_H
+#define LAK_GLTF_MATERIAL_H
+
+namespace lak
+{
+    using std::vector;
+
+    // a gltf_t::material_t with its JSON decoded into plain values
+    struct gltfMaterial_t
+    {
+        enum alphaMode_t : uint8_t { ALPHA_OPAQUE, ALPHA_MASK, ALPHA_BLEND };
+        enum slot_t : uint8_t { BASE_COLOR, METALLIC_ROUGHNESS, NORMAL, OCCLUSION, EMISSIVE, SLOT_COUNT };
+
+        glm::vec4 baseColorFactor = glm::vec4(1.0f);
+        glm::vec3 emissiveFactor = glm::vec3(0.0f);
+        float metallicFactor = 1.0f;
+        float roughnessFactor = 1.0f;
+        float normalScale = 1.0f;
+        float occlusionStrength = 1.0f;
+        float alphaCutoff = 0.5f;
+        uint32_t texture[SLOT_COUNT] = {(uint32_t)-1, (uint32_t)-1, (uint32_t)-1, (uint32_t)-1, (uint32_t)-1}; // gltf_t::textures index, -1 if unused
+        uint8_t texCoord[SLOT_COUNT] = {};
+        alphaMode_t alphaMode = ALPHA_OPAQUE;
+        bool doubleSided = false;
+        uint32_t textureSet = 0;    // materials with identical textures share a set, 0 if untextured
+    };
+
+    // decodes every material of gltf, out gets materials.size() + 1 entries
+    // with the last being the glTF default material (for primitives with no
+    // material). returns false if any texture index is out of range (those
+    // textures are treated as unused)
+    bool compileMaterials(const gltf_t &gltf, vector<gltfMaterial_t> *out);
+
+    // drawSortKey for a primitive using materials[material] (-1 for the
+    // default material), blended if its alphaMode is ALPHA_BLEND
+    uint64_t gltfDrawKey(const vector<gltfMaterial_t> &materials, size_t material, uint32_t shader, float depth);
+}
+
+#ifdef LAK_GLTF_MATERIAL_IMPLEM
+#   ifndef LAK_GLTF_MATERIAL_HAS_IMPLEM
+#       define LAK_GLTF_MATERIAL_HAS_IMPLEM
+#       include "types/gltf_material.cpp"
+#   endif // LAK_GLTF_MATERIAL_HAS_IMPLEM
+#endif // LAK_GLTF_MATERIAL_IMPLEM
+
+#endif // LAK_GLTF_MATERIAL_H
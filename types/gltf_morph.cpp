@@ -0,0 +1,221 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cmath>
+#include <cstring>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif // __AVX2__
+
+#include "types/gltf_morph.h"
+
+namespace lak
+{
+    morphLayout_t morphLayout(const vertexBuffer_t &buffer, const string &position, const string &normal, const string &tangent)
+    {
+        morphLayout_t layout;
+        auto find = [&](const string &name, size_t *offset) {
+            if (name.empty()) return;
+            const auto it = buffer.elements.find(name);
+            if (it == buffer.elements.end() || !it->second.active) return;
+            *offset = it->second.offset;
+            layout.stride = it->second.interlacedStride;
+        };
+        find(position, &layout.position);
+        find(normal, &layout.normal);
+        find(tangent, &layout.tangent);
+        return layout;
+    }
+
+    // reads a morph target attribute, keeping sparse accessors sparse
+    static bool readDelta(const gltf_t &gltf, const gltfData_t &data, size_t accessor, morphDelta_t *out)
+    {
+        if (accessor >= gltf.accessors.size()) return false;
+        const auto &acc = gltf.accessors[accessor];
+        if (acc.bufferView == (size_t)-1 && acc.sparse.count > 0)
+        {
+            // only the sparse values are non zero, so don't expand them
+            const auto &sparse = acc.sparse;
+            const size_t indexSize = gltfComponentSize(sparse.indices.componentType);
+            const size_t elemSize = gltfComponentSize(acc.componentType) * 3;
+            const uint8_t *indices = gltfBufferView(gltf, data.buffers, sparse.indices.bufferView);
+            const uint8_t *values = gltfBufferView(gltf, data.buffers, sparse.values.bufferView);
+            if (indices == nullptr || values == nullptr || indexSize == 0 || elemSize == 0) return false;
+            if (sparse.indices.byteOffset + (sparse.count * indexSize) > gltf.bufferViews[sparse.indices.bufferView].byteLength) return false;
+            if (sparse.values.byteOffset + (sparse.count * elemSize) > gltf.bufferViews[sparse.values.bufferView].byteLength) return false;
+            indices += sparse.indices.byteOffset;
+            values += sparse.values.byteOffset;
+
+            out->indices.resize(sparse.count);
+            for (size_t i = 0; i < sparse.count; ++i)
+            {
+                switch (indexSize)
+                {
+                    case 1: out->indices[i] = indices[i]; break;
+                    case 2: { uint16_t v; memcpy(&v, indices + (i * 2), 2); out->indices[i] = v; } break;
+                    default: { uint32_t v; memcpy(&v, indices + (i * 4), 4); out->indices[i] = v; } break;
+                }
+                if (out->indices[i] >= acc.count) return false;
+            }
+            stride_vector raw;
+            raw.init(sparse.count * elemSize, elemSize);
+            memcpy(raw.data.data(), values, raw.size());
+            return accessorToFloat(gltf, accessor, raw, &out->values, acc.normalized);
+        }
+        if (accessor >= data.accessors.size()) return false;
+        out->indices.clear();
+        return accessorToFloat(gltf, accessor, data.accessors[accessor], &out->values, acc.normalized);
+    }
+
+    bool morphPrimitive_t::build(const gltf_t &gltf, const gltfData_t &data, size_t mesh, size_t primitive)
+    {
+        vertexCount = 0;
+        position.clear(); normal.clear(); tangent.clear(); targets.clear();
+        if (mesh >= gltf.meshes.size() || primitive >= gltf.meshes[mesh].primitives.size()) return false;
+        const auto &prim = gltf.meshes[mesh].primitives[primitive];
+
+        auto read = [&](const char *name, vector<float> *out) -> bool {
+            const auto it = prim.attributes.find(name);
+            if (it == prim.attributes.end() || it->second >= data.accessors.size()) return false;
+            return accessorToFloat(gltf, it->second, data.accessors[it->second], out, gltf.accessors[it->second].normalized);
+        };
+
+        if (!read("POSITION", &position)) return false;
+        vertexCount = position.size() / 3;
+        if (!read("NORMAL", &normal) || normal.size() != vertexCount * 3) normal.clear();
+        if (!read("TANGENT", &tangent) || tangent.size() != vertexCount * 4) tangent.clear();
+
+        targets.resize(prim.targets.size());
+        for (size_t t = 0; t < prim.targets.size(); ++t)
+        {
+            const auto &src = prim.targets[t];
+            auto &dst = targets[t];
+            auto readTarget = [&](const char *name, morphDelta_t *out, bool wanted) {
+                const auto it = src.find(name);
+                if (!wanted || it == src.end()) return;
+                if (!readDelta(gltf, data, it->second, out)) *out = {};
+                // dense deltas must cover every vertex
+                else if (out->indices.empty() && out->values.size() != vertexCount * 3) *out = {};
+                // sparse deltas must only touch this primitive's vertices
+                else for (const auto index : out->indices)
+                    if (index >= vertexCount) { *out = {}; break; }
+            };
+            readTarget("POSITION", &dst.position, true);
+            readTarget("NORMAL", &dst.normal, !normal.empty());
+            readTarget("TANGENT", &dst.tangent, !tangent.empty());
+        }
+        return true;
+    }
+
+    // acc[i] += delta[i] * w
+    static inline void madd(float *acc, const float *delta, float w, size_t count)
+    {
+        size_t i = 0;
+        #ifdef __AVX2__
+        const __m256 vw = _mm256_set1_ps(w);
+        for (; i + 8 <= count; i += 8)
+        {
+            #ifdef __FMA__
+            _mm256_storeu_ps(acc + i, _mm256_fmadd_ps(_mm256_loadu_ps(delta + i), vw, _mm256_loadu_ps(acc + i)));
+            #else
+            _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(_mm256_loadu_ps(delta + i), vw)));
+            #endif // __FMA__
+        }
+        #endif // __AVX2__
+        for (; i < count; ++i)
+            acc[i] += delta[i] * w;
+    }
+
+    static inline void accumulate(float *acc, const morphDelta_t &delta, float w, size_t vertexCount)
+    {
+        if (delta.empty()) return;
+        if (delta.indices.empty())
+        {
+            madd(acc, delta.values.data(), w, vertexCount * 3);
+            return;
+        }
+        const float *v = delta.values.data();
+        for (size_t i = 0; i < delta.indices.size(); ++i, v += 3)
+        {
+            float *a = acc + (delta.indices[i] * 3);
+            a[0] += v[0] * w;
+            a[1] += v[1] * w;
+            a[2] += v[2] * w;
+        }
+    }
+
+    void morphPrimitive_t::apply(const float *weights, size_t weightCount, const morphLayout_t &layout, uint8_t *out) const
+    {
+        if (layout.stride == 0 || out == nullptr) return;
+
+        // scratch space is reused between calls on the same thread
+        thread_local vector<float> pos, nrm, tan;
+        const bool doPos = layout.position != (size_t)-1;
+        const bool doNrm = layout.normal != (size_t)-1 && !normal.empty();
+        const bool doTan = layout.tangent != (size_t)-1 && !tangent.empty();
+
+        if (doPos) pos.assign(position.begin(), position.end());
+        if (doNrm) nrm.assign(normal.begin(), normal.end());
+        if (doTan)
+        {
+            // tangents are vec4 but the deltas are vec3, w is kept from the base
+            tan.resize(vertexCount * 3);
+            for (size_t v = 0; v < vertexCount; ++v)
+                memcpy(&tan[v * 3], &tangent[v * 4], sizeof(float) * 3);
+        }
+
+        const size_t count = weightCount < targets.size() ? weightCount : targets.size();
+        for (size_t t = 0; t < count; ++t)
+        {
+            const float w = weights[t];
+            if (w == 0.0f) continue;
+            if (doPos) accumulate(pos.data(), targets[t].position, w, vertexCount);
+            if (doNrm) accumulate(nrm.data(), targets[t].normal, w, vertexCount);
+            if (doTan) accumulate(tan.data(), targets[t].tangent, w, vertexCount);
+        }
+
+        auto normalize = [](float *v) {
+            const float len = std::sqrt((v[0] * v[0]) + (v[1] * v[1]) + (v[2] * v[2]));
+            if (len > 0.0f) { v[0] /= len; v[1] /= len; v[2] /= len; }
+        };
+
+        uint8_t *vertex = out;
+        for (size_t v = 0; v < vertexCount; ++v, vertex += layout.stride)
+        {
+            if (doPos) memcpy(vertex + layout.position, &pos[v * 3], sizeof(float) * 3);
+            if (doNrm)
+            {
+                normalize(&nrm[v * 3]);
+                memcpy(vertex + layout.normal, &nrm[v * 3], sizeof(float) * 3);
+            }
+            if (doTan)
+            {
+                normalize(&tan[v * 3]);
+                memcpy(vertex + layout.tangent, &tan[v * 3], sizeof(float) * 3);
+                memcpy(vertex + layout.tangent + (sizeof(float) * 3), &tangent[(v * 4) + 3], sizeof(float));
+            }
+        }
+    }
+}
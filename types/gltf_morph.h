@@ -0,0 +1,94 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+#include "types/gltf.h"
+#include "types/gltf_loader.h"
+#include "types/mesh.h"
+
+#ifndef LAK_GLTF_MORPH_H
+#define LAK_GLTF_MORPH_H
+
+namespace lak
+{
+    using std::vector;
+    using std::string;
+
+    // per vertex deltas for one attribute of a morph target
+    struct morphDelta_t
+    {
+        vector<float> values;       // 3 per vertex, or 3 per index if sparse
+        vector<uint32_t> indices;   // empty if dense
+        inline bool empty() const { return values.empty(); }
+    };
+
+    struct morphTarget_t
+    {
+        morphDelta_t position;
+        morphDelta_t normal;
+        morphDelta_t tangent;
+    };
+
+    // where each morphed attribute lives in an interlaced vertex buffer,
+    // offsets are in bytes and -1 means the attribute isn't written
+    struct morphLayout_t
+    {
+        size_t stride = 0;
+        size_t position = -1;
+        size_t normal = -1;
+        size_t tangent = -1;
+    };
+
+    // reads the layout from buffer (must have been update()d at least once),
+    // names are the vertexBuffer_t::elements keys, use "" to skip an attribute
+    morphLayout_t morphLayout(const vertexBuffer_t &buffer, const string &position, const string &normal = "", const string &tangent = "");
+
+    struct morphPrimitive_t
+    {
+        size_t vertexCount = 0;
+        vector<float> position;     // 3 per vertex
+        vector<float> normal;       // 3 per vertex (can be empty)
+        vector<float> tangent;      // 4 per vertex (can be empty)
+        vector<morphTarget_t> targets;
+
+        bool build(const gltf_t &gltf, const gltfData_t &data, size_t mesh, size_t primitive);
+
+        // blends the targets by weights and writes the result into the
+        // interlaced vertex data out (float attributes only, see morphLayout_t)
+        // targets with a weight of 0 are skipped entirely
+        void apply(const float *weights, size_t weightCount, const morphLayout_t &layout, uint8_t *out) const;
+    };
+}
+
+#ifdef LAK_GLTF_MORPH_IMPLEM
+#   ifndef LAK_GLTF_MORPH_HAS_IMPLEM
+#       define LAK_GLTF_MORPH_HAS_IMPLEM
+#       include "types/gltf_morph.cpp"
+#   endif // LAK_GLTF_MORPH_HAS_IMPLEM
+#endif // LAK_GLTF_MORPH_IMPLEM
+
+#endif // LAK_GLTF_MORPH_H
@@ -0,0 +1,308 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cmath>
+#include <cstring>
+
+#include <glm/matrix.hpp>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif // __AVX2__
+
+#include "types/gltf_skin.h"
+
+namespace lak
+{
+    void computeJointMatrices(const gltf_t &gltf, const gltfData_t &data, size_t skin,
+        const sceneGraph_t &graph, size_t meshNode, vector<glm::mat4> *out)
+    {
+        out->clear();
+        if (skin >= gltf.skins.size()) return;
+        const auto &s = gltf.skins[skin];
+        out->resize(s.joints.size(), glm::mat4(1.0f));
+
+        vector<float> ibm;
+        if (s.inverseBindMatrices < data.accessors.size())
+            accessorToFloat(gltf, s.inverseBindMatrices, data.accessors[s.inverseBindMatrices], &ibm, false);
+
+        const glm::mat4 inverseMesh = meshNode < graph.size() ? glm::inverse(graph.world[meshNode]) : glm::mat4(1.0f);
+        for (size_t j = 0; j < s.joints.size(); ++j)
+        {
+            glm::mat4 inverseBind(1.0f);
+            if ((j + 1) * 16 <= ibm.size())
+                memcpy(&inverseBind[0][0], &ibm[j * 16], sizeof(float) * 16);
+            const size_t node = s.joints[j] < graph.index.size() ? graph.index[s.joints[j]] : (size_t)-1;
+            const glm::mat4 world = node != (size_t)-1 ? graph.world[node] : glm::mat4(1.0f);
+            (*out)[j] = inverseMesh * world * inverseBind;
+        }
+    }
+
+    bool skinnedPrimitive_t::build(const gltf_t &gltf, const gltfData_t &data, size_t mesh, size_t primitive)
+    {
+        vertexCount = 0;
+        positions.clear(); normals.clear(); joints.clear(); weights.clear();
+        if (mesh >= gltf.meshes.size() || primitive >= gltf.meshes[mesh].primitives.size()) return false;
+        const auto &attributes = gltf.meshes[mesh].primitives[primitive].attributes;
+
+        auto read = [&](const char *name, vector<float> *out, bool normalized) -> bool {
+            const auto it = attributes.find(name);
+            if (it == attributes.end() || it->second >= data.accessors.size()) return false;
+            return accessorToFloat(gltf, it->second, data.accessors[it->second], out, normalized || gltf.accessors[it->second].normalized);
+        };
+
+        vector<float> j;
+        if (!read("POSITION", &positions, false) || !read("JOINTS_0", &j, false) || !read("WEIGHTS_0", &weights, true))
+            return false;
+        vertexCount = positions.size() / 3;
+        if (!read("NORMAL", &normals, false) || normals.size() != vertexCount * 3)
+            normals.clear();
+        if (j.size() != vertexCount * 4 || weights.size() != vertexCount * 4)
+        {
+            vertexCount = 0;
+            return false;
+        }
+        joints.resize(j.size());
+        for (size_t i = 0; i < j.size(); ++i)
+            joints[i] = (uint16_t)j[i];
+        return true;
+    }
+
+    // blends the (column major) joint matrices for vertex v into m
+    static inline void blendMatrix(const skinJob_t &job, size_t v, float *m)
+    {
+        const uint16_t *joint = &job.primitive->joints[v * 4];
+        const float *weight = &job.primitive->weights[v * 4];
+        for (size_t i = 0; i < 16; ++i) m[i] = 0.0f;
+        for (size_t i = 0; i < 4; ++i)
+        {
+            if (weight[i] == 0.0f || joint[i] >= job.jointCount) continue;
+            const float *src = &job.joints[joint[i]][0][0];
+            for (size_t c = 0; c < 16; ++c) m[c] += src[c] * weight[i];
+        }
+    }
+
+    static inline void normalize3(float *n)
+    {
+        const float len = std::sqrt((n[0] * n[0]) + (n[1] * n[1]) + (n[2] * n[2]));
+        if (len > 0.0f) { n[0] /= len; n[1] /= len; n[2] /= len; }
+    }
+
+    void skinLinear(const skinJob_t &job)
+    {
+        const skinnedPrimitive_t &prim = *job.primitive;
+        const bool doNormals = job.normals != nullptr && !prim.normals.empty();
+        size_t v = 0;
+
+        #ifdef __AVX2__
+        // each joint matrix is loaded as two 256 bit halves (columns 0|1 and 2|3),
+        // so blending four joints and transforming a vertex is a handful of ops
+        for (; v < prim.vertexCount; ++v)
+        {
+            const uint16_t *joint = &prim.joints[v * 4];
+            const float *weight = &prim.weights[v * 4];
+            __m256 c01 = _mm256_setzero_ps();
+            __m256 c23 = _mm256_setzero_ps();
+            for (size_t i = 0; i < 4; ++i)
+            {
+                if (weight[i] == 0.0f || joint[i] >= job.jointCount) continue;
+                const float *m = &job.joints[joint[i]][0][0];
+                const __m256 w = _mm256_set1_ps(weight[i]);
+                #ifdef __FMA__
+                c01 = _mm256_fmadd_ps(w, _mm256_loadu_ps(m), c01);
+                c23 = _mm256_fmadd_ps(w, _mm256_loadu_ps(m + 8), c23);
+                #else
+                c01 = _mm256_add_ps(c01, _mm256_mul_ps(w, _mm256_loadu_ps(m)));
+                c23 = _mm256_add_ps(c23, _mm256_mul_ps(w, _mm256_loadu_ps(m + 8)));
+                #endif // __FMA__
+            }
+
+            const float *p = &prim.positions[v * 3];
+            const __m256 pxy = _mm256_set_m128(_mm_set1_ps(p[1]), _mm_set1_ps(p[0]));
+            const __m256 pzw = _mm256_set_m128(_mm_set1_ps(1.0f), _mm_set1_ps(p[2]));
+            const __m256 r = _mm256_add_ps(_mm256_mul_ps(c01, pxy), _mm256_mul_ps(c23, pzw));
+            alignas(16) float out[4];
+            _mm_store_ps(out, _mm_add_ps(_mm256_castps256_ps128(r), _mm256_extractf128_ps(r, 1)));
+            job.positions[(v * 3) + 0] = out[0];
+            job.positions[(v * 3) + 1] = out[1];
+            job.positions[(v * 3) + 2] = out[2];
+
+            if (doNormals)
+            {
+                const float *n = &prim.normals[v * 3];
+                const __m256 nxy = _mm256_set_m128(_mm_set1_ps(n[1]), _mm_set1_ps(n[0]));
+                const __m256 nzw = _mm256_set_m128(_mm_setzero_ps(), _mm_set1_ps(n[2]));
+                const __m256 rn = _mm256_add_ps(_mm256_mul_ps(c01, nxy), _mm256_mul_ps(c23, nzw));
+                _mm_store_ps(out, _mm_add_ps(_mm256_castps256_ps128(rn), _mm256_extractf128_ps(rn, 1)));
+                normalize3(out);
+                job.normals[(v * 3) + 0] = out[0];
+                job.normals[(v * 3) + 1] = out[1];
+                job.normals[(v * 3) + 2] = out[2];
+            }
+        }
+        #endif // __AVX2__
+
+        // scalar fallback (or the whole thing without AVX2)
+        for (; v < prim.vertexCount; ++v)
+        {
+            float m[16];
+            blendMatrix(job, v, m);
+            const float *p = &prim.positions[v * 3];
+            float *op = &job.positions[v * 3];
+            for (size_t r = 0; r < 3; ++r)
+                op[r] = (m[r] * p[0]) + (m[4 + r] * p[1]) + (m[8 + r] * p[2]) + m[12 + r];
+            if (doNormals)
+            {
+                const float *n = &prim.normals[v * 3];
+                float *on = &job.normals[v * 3];
+                for (size_t r = 0; r < 3; ++r)
+                    on[r] = (m[r] * n[0]) + (m[4 + r] * n[1]) + (m[8 + r] * n[2]);
+                normalize3(on);
+            }
+        }
+    }
+
+    // dual quaternion as (real x, y, z, w, dual x, y, z, w)
+    static void matrixToDualQuat(const glm::mat4 &mat, float *dq)
+    {
+        const float *m = &mat[0][0];
+        // strip any scale from the rotation columns
+        float c[3][3];
+        for (size_t i = 0; i < 3; ++i)
+        {
+            const float len = std::sqrt((m[i*4] * m[i*4]) + (m[(i*4)+1] * m[(i*4)+1]) + (m[(i*4)+2] * m[(i*4)+2]));
+            const float inv = len > 0.0f ? 1.0f / len : 0.0f;
+            for (size_t r = 0; r < 3; ++r) c[i][r] = m[(i*4)+r] * inv;
+        }
+        float *q = dq;
+        const float trace = c[0][0] + c[1][1] + c[2][2];
+        if (trace > 0.0f)
+        {
+            const float s = std::sqrt(trace + 1.0f) * 2.0f;
+            q[3] = 0.25f * s;
+            q[0] = (c[1][2] - c[2][1]) / s;
+            q[1] = (c[2][0] - c[0][2]) / s;
+            q[2] = (c[0][1] - c[1][0]) / s;
+        }
+        else if (c[0][0] > c[1][1] && c[0][0] > c[2][2])
+        {
+            const float s = std::sqrt(1.0f + c[0][0] - c[1][1] - c[2][2]) * 2.0f;
+            q[3] = (c[1][2] - c[2][1]) / s;
+            q[0] = 0.25f * s;
+            q[1] = (c[1][0] + c[0][1]) / s;
+            q[2] = (c[2][0] + c[0][2]) / s;
+        }
+        else if (c[1][1] > c[2][2])
+        {
+            const float s = std::sqrt(1.0f + c[1][1] - c[0][0] - c[2][2]) * 2.0f;
+            q[3] = (c[2][0] - c[0][2]) / s;
+            q[0] = (c[1][0] + c[0][1]) / s;
+            q[1] = 0.25f * s;
+            q[2] = (c[2][1] + c[1][2]) / s;
+        }
+        else
+        {
+            const float s = std::sqrt(1.0f + c[2][2] - c[0][0] - c[1][1]) * 2.0f;
+            q[3] = (c[0][1] - c[1][0]) / s;
+            q[0] = (c[2][0] + c[0][2]) / s;
+            q[1] = (c[2][1] + c[1][2]) / s;
+            q[2] = 0.25f * s;
+        }
+        // dual = 0.5 * (t, 0) * real
+        const float tx = m[12], ty = m[13], tz = m[14];
+        dq[4] = 0.5f * ((tx * q[3]) + (ty * q[2]) - (tz * q[1]));
+        dq[5] = 0.5f * ((-tx * q[2]) + (ty * q[3]) + (tz * q[0]));
+        dq[6] = 0.5f * ((tx * q[1]) - (ty * q[0]) + (tz * q[3]));
+        dq[7] = 0.5f * ((-tx * q[0]) - (ty * q[1]) - (tz * q[2]));
+    }
+
+    // rotates v by unit quaternion q
+    static inline void rotate(const float *q, const float *v, float *out)
+    {
+        // t = 2 * cross(q.xyz, v), out = v + q.w * t + cross(q.xyz, t)
+        const float tx = 2.0f * ((q[1] * v[2]) - (q[2] * v[1]));
+        const float ty = 2.0f * ((q[2] * v[0]) - (q[0] * v[2]));
+        const float tz = 2.0f * ((q[0] * v[1]) - (q[1] * v[0]));
+        out[0] = v[0] + (q[3] * tx) + ((q[1] * tz) - (q[2] * ty));
+        out[1] = v[1] + (q[3] * ty) + ((q[2] * tx) - (q[0] * tz));
+        out[2] = v[2] + (q[3] * tz) + ((q[0] * ty) - (q[1] * tx));
+    }
+
+    void skinDualQuat(const skinJob_t &job)
+    {
+        const skinnedPrimitive_t &prim = *job.primitive;
+        const bool doNormals = job.normals != nullptr && !prim.normals.empty();
+
+        vector<float> dqs(job.jointCount * 8);
+        for (size_t j = 0; j < job.jointCount; ++j)
+            matrixToDualQuat(job.joints[j], &dqs[j * 8]);
+
+        for (size_t v = 0; v < prim.vertexCount; ++v)
+        {
+            const uint16_t *joint = &prim.joints[v * 4];
+            const float *weight = &prim.weights[v * 4];
+            float b[8] = {};
+            const float *pivot = nullptr;
+            for (size_t i = 0; i < 4; ++i)
+            {
+                if (weight[i] == 0.0f || joint[i] >= job.jointCount) continue;
+                const float *dq = &dqs[joint[i] * 8];
+                if (pivot == nullptr) pivot = dq;
+                // keep every quaternion in the same hemisphere as the first
+                const float dot = (dq[0] * pivot[0]) + (dq[1] * pivot[1]) + (dq[2] * pivot[2]) + (dq[3] * pivot[3]);
+                const float w = dot < 0.0f ? -weight[i] : weight[i];
+                for (size_t c = 0; c < 8; ++c) b[c] += dq[c] * w;
+            }
+            const float len = std::sqrt((b[0] * b[0]) + (b[1] * b[1]) + (b[2] * b[2]) + (b[3] * b[3]));
+            if (len > 0.0f) for (size_t c = 0; c < 8; ++c) b[c] /= len;
+            else { b[3] = 1.0f; }
+
+            // translation = 2 * dual * conjugate(real)
+            const float *r = b, *d = b + 4;
+            const float t[3] = {
+                2.0f * ((-d[3] * r[0]) + (d[0] * r[3]) - (d[1] * r[2]) + (d[2] * r[1])),
+                2.0f * ((-d[3] * r[1]) + (d[0] * r[2]) + (d[1] * r[3]) - (d[2] * r[0])),
+                2.0f * ((-d[3] * r[2]) - (d[0] * r[1]) + (d[1] * r[0]) + (d[2] * r[3]))
+            };
+
+            float *op = &job.positions[v * 3];
+            rotate(r, &prim.positions[v * 3], op);
+            op[0] += t[0]; op[1] += t[1]; op[2] += t[2];
+            if (doNormals)
+                rotate(r, &prim.normals[v * 3], &job.normals[v * 3]);
+        }
+    }
+
+    void skinPrimitives(workerPool_t &pool, const vector<skinJob_t> &jobs)
+    {
+        parallelFor(pool, jobs.size(), [&jobs](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (jobs[i].primitive == nullptr || jobs[i].positions == nullptr) continue;
+                if (jobs[i].dualQuat) skinDualQuat(jobs[i]);
+                else skinLinear(jobs[i]);
+            }
+        });
+    }
+}
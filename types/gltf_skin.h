@@ -0,0 +1,85 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+
+#include "types/gltf.h"
+#include "types/gltf_loader.h"
+#include "types/scene_graph.h"
+#include "types/worker_pool.h"
+
+#ifndef LAK_GLTF_SKIN_H
+#define LAK_GLTF_SKIN_H
+
+namespace lak
+{
+    using std::vector;
+
+    // computes the skinning matrix of every joint in gltf.skins[skin] for a
+    // mesh attached to graph node meshNode (a sceneGraph_t index)
+    // joint = inverse(world[meshNode]) * world[joint] * inverseBindMatrix
+    void computeJointMatrices(const gltf_t &gltf, const gltfData_t &data, size_t skin,
+        const sceneGraph_t &graph, size_t meshNode, vector<glm::mat4> *out);
+
+    // vertex data needed to skin a single primitive, as flat arrays
+    struct skinnedPrimitive_t
+    {
+        size_t vertexCount = 0;
+        vector<float> positions;    // 3 per vertex
+        vector<float> normals;      // 3 per vertex (empty if the primitive has no normals)
+        vector<uint16_t> joints;    // 4 per vertex (JOINTS_0)
+        vector<float> weights;      // 4 per vertex (WEIGHTS_0)
+
+        bool build(const gltf_t &gltf, const gltfData_t &data, size_t mesh, size_t primitive);
+    };
+
+    struct skinJob_t
+    {
+        const skinnedPrimitive_t *primitive = nullptr;
+        const glm::mat4 *joints = nullptr;
+        size_t jointCount = 0;
+        float *positions = nullptr; // output, 3 per vertex
+        float *normals = nullptr;   // output, 3 per vertex (can be nullptr)
+        bool dualQuat = false;      // dual quaternion skinning instead of linear blend
+    };
+
+    // linear blend skinning, uses AVX2 when compiled with it
+    void skinLinear(const skinJob_t &job);
+    // dual quaternion skinning, joints must be rigid (rotation + translation)
+    void skinDualQuat(const skinJob_t &job);
+    // runs every job in parallel, one job per primitive
+    void skinPrimitives(workerPool_t &pool, const vector<skinJob_t> &jobs);
+}
+
+#ifdef LAK_GLTF_SKIN_IMPLEM
+#   ifndef LAK_GLTF_SKIN_HAS_IMPLEM
+#       define LAK_GLTF_SKIN_HAS_IMPLEM
+#       include "types/gltf_skin.cpp"
+#   endif // LAK_GLTF_SKIN_HAS_IMPLEM
+#endif // LAK_GLTF_SKIN_IMPLEM
+
+#endif // LAK_GLTF_SKIN_H
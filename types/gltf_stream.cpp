@@ -0,0 +1,518 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <condition_variable>
+
+#include "utils/mapped_file.h"
+#include "types/gltf_stream.h"
+
+namespace lak
+{
+    using std::mutex;
+    using std::lock_guard;
+    using std::unique_lock;
+    using std::condition_variable;
+    using std::to_string;
+
+    struct _gltfStreamResult_t
+    {
+        size_t id;
+        bool ok = false;
+        string error;
+        size_t bytes = 0;
+        vector<shared_ptr<mesh_t>> primitives;
+        imageRGBA8_t image;
+    };
+
+    // state shared with the load tasks
+    struct _gltfStreamShared_t
+    {
+        const gltf_t &gltf;
+        string directory;
+        vector<std::unique_ptr<mappedFile_t>> files;    // index matches gltf_t::buffers
+        vector<vector<uint8_t>> decoded;                // data uri buffers
+        vector<gltfBuffer_t> buffers;
+        std::atomic<bool> closed{false};
+        mutex lock;
+        condition_variable idle;
+        size_t inFlight = 0;
+        vector<_gltfStreamResult_t> finished;
+        _gltfStreamShared_t(const gltf_t &g, const string &dir) : gltf(g), directory(dir) {}
+    };
+
+    // ids pack the resource index with whether it's a mesh or an image
+    static inline size_t meshId(size_t mesh) { return mesh * 2; }
+    static inline size_t imageId(size_t image) { return (image * 2) + 1; }
+    static inline bool isImage(size_t id) { return id & 1; }
+
+    static string joinPath(const string &directory, const string &uri)
+    {
+        if (directory.empty() || directory.back() == '/' || directory.back() == '\\')
+            return directory + uri;
+        return directory + "/" + uri;
+    }
+
+    static bool streamAccessor(const _gltfStreamShared_t &shared, size_t accessor, stride_vector *out, string *error)
+    {
+        const gltf_t &gltf = shared.gltf;
+        if (accessor >= gltf.accessors.size())
+        {
+            *error = "Accessor " + to_string(accessor) + " is out of range";
+            return false;
+        }
+        const auto &acc = gltf.accessors[accessor];
+        const size_t views[3] = {
+            acc.bufferView,
+            acc.sparse.count > 0 ? acc.sparse.indices.bufferView : (size_t)-1,
+            acc.sparse.count > 0 ? acc.sparse.values.bufferView : (size_t)-1,
+        };
+        for (size_t view : views)
+        {
+            if (view < gltf.bufferViews.size() && gltf.bufferViews[view].extensions.meshopt.buffer != (size_t)-1)
+            {
+                *error = "Accessor " + to_string(accessor) + " uses EXT_meshopt_compression, which can't be streamed";
+                return false;
+            }
+        }
+        if (!readAccessor(gltf, shared.buffers, accessor, out))
+        {
+            *error = "Failed to read accessor " + to_string(accessor);
+            return false;
+        }
+        return true;
+    }
+
+    static void streamMesh(const _gltfStreamShared_t &shared, size_t m, _gltfStreamResult_t *result)
+    {
+        const gltf_t &gltf = shared.gltf;
+        for (const auto &prim : gltf.meshes[m].primitives)
+        {
+            auto primitive = std::make_shared<mesh_t>();
+            primitive->drawMode = prim.mode;
+            primitive->vertArray.buffers.resize(1);
+            size_t vertices = 0;
+            for (const auto &attr : prim.attributes)
+            {
+                stride_vector data;
+                if (!streamAccessor(shared, attr.second, &data, &result->error)) return;
+                vertexElement_t element;
+                if (!gltfVertexElement(gltf, data, attr.second, &element))
+                {
+                    result->error = "Unsupported vertex attribute " + attr.first + " in mesh " + to_string(m);
+                    return;
+                }
+                element.setActive(true);
+                result->bytes += element.data.size();
+                vertices = std::max(vertices, gltf.accessors[attr.second].count);
+                primitive->vertArray.buffers[0].elements[attr.first] = element;
+            }
+
+            stride_vector indices;
+            size_t indexCount = vertices;
+            if (prim.indices != (size_t)-1)
+            {
+                if (!streamAccessor(shared, prim.indices, &indices, &result->error)) return;
+                indexCount = gltf.accessors[prim.indices].count;
+            }
+            primitive->index.resize(indexCount);
+            gltfIndices(gltf, prim.indices == (size_t)-1 ? nullptr : &indices, prim.indices, primitive->index.data(), indexCount);
+            primitive->indexCount = indexCount;
+            result->bytes += indexCount * sizeof(GLuint);
+
+            result->primitives.push_back(std::move(primitive));
+        }
+        result->ok = true;
+    }
+
+    static void streamImage(const _gltfStreamShared_t &shared, size_t i, _gltfStreamResult_t *result)
+    {
+        const gltf_t &gltf = shared.gltf;
+        const auto &image = gltf.images[i];
+        bool decoded = false;
+        if (image.uri.compare(0, 5, "data:") == 0)
+        {
+            vector<uint8_t> bytes;
+            const size_t start = image.uri.find(";base64,");
+            if (start != string::npos && decodeBase64(image.uri.c_str() + start + 8, image.uri.size() - (start + 8), &bytes))
+                decoded = gltfDecodeImage(bytes.data(), bytes.size(), &result->image);
+        }
+        else if (image.uri != "")
+        {
+            mappedFile_t file;
+            if (file.open(joinPath(shared.directory, image.uri)))
+                decoded = gltfDecodeImage(file.data, file.size, &result->image);
+        }
+        else if (const uint8_t *view = gltfBufferView(gltf, shared.buffers, image.bufferView); view)
+        {
+            decoded = gltfDecodeImage(view, gltf.bufferViews[image.bufferView].byteLength, &result->image);
+        }
+
+        if (!decoded)
+        {
+            result->error = "Failed to load image " + to_string(i);
+            return;
+        }
+        result->bytes = result->image.pixels.size() * 4;
+        result->ok = true;
+    }
+
+    gltfStream_t::~gltfStream_t()
+    {
+        close();
+    }
+
+    bool gltfStream_t::open(const gltf_t &gltf, const string &directory, workerPool_t &pool, const uint8_t *binChunk, size_t binSize)
+    {
+        close();
+        _gltf = &gltf;
+        _pool = &pool;
+        _shared = std::make_shared<_gltfStreamShared_t>(gltf, directory);
+        auto &shared = *_shared;
+
+        // mapping is cheap no matter how big the files are, pages are only
+        // read when a load touches them
+        bool ok = true;
+        const size_t count = gltf.buffers.size();
+        shared.files.resize(count);
+        shared.decoded.resize(count);
+        shared.buffers.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto &buffer = gltf.buffers[i];
+            auto &dst = shared.buffers[i];
+            if (buffer.uri == "")
+            {
+                if (binChunk == nullptr)
+                {
+                    errors.push_back("Missing binary chunk for buffer " + to_string(i));
+                    ok = false;
+                    continue;
+                }
+                dst.ptr = binChunk;
+                dst.bytes = binSize;
+            }
+            else if (buffer.uri.compare(0, 5, "data:") == 0)
+            {
+                auto &bytes = shared.decoded[i];
+                const size_t start = buffer.uri.find(";base64,");
+                if (start == string::npos || !decodeBase64(buffer.uri.c_str() + start + 8, buffer.uri.size() - (start + 8), &bytes))
+                {
+                    errors.push_back("Failed to decode buffer " + to_string(i));
+                    ok = false;
+                    continue;
+                }
+                dst.ptr = bytes.data();
+                dst.bytes = bytes.size();
+            }
+            else
+            {
+                shared.files[i] = std::make_unique<mappedFile_t>();
+                if (!shared.files[i]->open(joinPath(directory, buffer.uri)))
+                {
+                    errors.push_back("Failed to map buffer " + to_string(i) + " (" + buffer.uri + ")");
+                    ok = false;
+                    continue;
+                }
+                dst.ptr = shared.files[i]->data;
+                dst.bytes = shared.files[i]->size;
+            }
+            if (dst.bytes < buffer.byteLength)
+            {
+                errors.push_back("Buffer " + to_string(i) + " is smaller than byteLength");
+                ok = false;
+            }
+        }
+
+        // meshes can be sized up front, images aren't known until decoded
+        meshes.assign(gltf.meshes.size(), resource_t());
+        for (size_t m = 0; m < gltf.meshes.size(); ++m)
+        {
+            for (const auto &prim : gltf.meshes[m].primitives)
+            {
+                size_t vertices = 0;
+                for (const auto &attr : prim.attributes)
+                {
+                    if (attr.second >= gltf.accessors.size()) continue;
+                    const auto &acc = gltf.accessors[attr.second];
+                    const size_t elemSize = gltfComponentSize(acc.componentType) * gltfComponentCount(acc.type);
+                    meshes[m].bytes += acc.count * ((elemSize + 3) & ~(size_t)3);
+                    vertices = std::max(vertices, acc.count);
+                }
+                const size_t indices = prim.indices < gltf.accessors.size() ? gltf.accessors[prim.indices].count : vertices;
+                meshes[m].bytes += indices * sizeof(GLuint);
+            }
+        }
+        images.assign(gltf.images.size(), resource_t());
+
+        _primitives.assign(gltf.meshes.size(), {});
+        _textures.assign(gltf.textures.size(), nullptr);
+        _imageTextures.assign(gltf.images.size(), {});
+        for (size_t t = 0; t < gltf.textures.size(); ++t)
+            if (gltf.textures[t].source < gltf.images.size())
+                _imageTextures[gltf.textures[t].source].push_back(t);
+
+        return ok;
+    }
+
+    void gltfStream_t::close()
+    {
+        if (_shared)
+        {
+            unique_lock<mutex> lock(_shared->lock);
+            _shared->closed = true;
+            _shared->idle.wait(lock, [&]{ return _shared->inFlight == 0; });
+        }
+        _shared.reset();
+        _gltf = nullptr;
+        _pool = nullptr;
+        resident = 0;
+        meshes.clear();
+        images.clear();
+        _primitives.clear();
+        _textures.clear();
+        _imageTextures.clear();
+        _requests.clear();
+        _uploads.clear();
+        _loading = 0;
+        _loadingBytes = 0;
+    }
+
+    gltfStream_t::resource_t &gltfStream_t::_resource(size_t id)
+    {
+        return isImage(id) ? images[id / 2] : meshes[id / 2];
+    }
+
+    static void request(gltfStream_t::resource_t &res, size_t id, float priority, uint64_t frame, vector<size_t> *requests)
+    {
+        if (res.requested != frame)
+        {
+            res.requested = frame;
+            res.priority = priority;
+            requests->push_back(id);
+        }
+        else res.priority = std::min(res.priority, priority);
+    }
+
+    void gltfStream_t::requestMesh(size_t mesh, float priority)
+    {
+        if (mesh < meshes.size()) request(meshes[mesh], meshId(mesh), priority, _frame, &_requests);
+    }
+
+    void gltfStream_t::requestTexture(size_t texture, float priority)
+    {
+        if (_gltf == nullptr || texture >= _gltf->textures.size()) return;
+        const size_t image = _gltf->textures[texture].source;
+        if (image < images.size()) request(images[image], imageId(image), priority, _frame, &_requests);
+    }
+
+    void gltfStream_t::requestNodes(const sceneGraph_t &graph, const vector<size_t> &nodes, const glm::vec3 &camera)
+    {
+        if (_gltf == nullptr) return;
+        for (size_t i : nodes)
+        {
+            if (i >= graph.size()) continue;
+            const size_t mesh = _gltf->nodes[graph.node[i]].mesh;
+            const glm::mat4 &world = graph.world[i];
+            const float x = world[3][0] - camera.x;
+            const float y = world[3][1] - camera.y;
+            const float z = world[3][2] - camera.z;
+            requestMesh(mesh, std::sqrt((x * x) + (y * y) + (z * z)));
+        }
+    }
+
+    void gltfStream_t::_evict(size_t id)
+    {
+        auto &res = _resource(id);
+        if (res.state != RESIDENT) return;
+        res.state = UNLOADED;
+        resident -= res.bytes;
+        if (isImage(id))
+        {
+            for (size_t t : _imageTextures[id / 2])
+                _textures[t].reset();
+        }
+        else _primitives[id / 2].clear();
+    }
+
+    void gltfStream_t::_load(size_t id)
+    {
+        auto &res = _resource(id);
+        res.state = LOADING;
+        ++_loading;
+        _loadingBytes += res.bytes;
+        _gltfStreamShared_t *shared = _shared.get();
+        {
+            lock_guard<mutex> lock(shared->lock);
+            ++shared->inFlight;
+        }
+        _pool->push([shared, id]{
+            _gltfStreamResult_t result;
+            result.id = id;
+            if (!shared->closed)
+            {
+                if (isImage(id)) streamImage(*shared, id / 2, &result);
+                else streamMesh(*shared, id / 2, &result);
+            }
+            lock_guard<mutex> lock(shared->lock);
+            shared->finished.push_back(std::move(result));
+            --shared->inFlight;
+            // notify while locked, close() may destroy shared as soon as it wakes
+            shared->idle.notify_all();
+        });
+    }
+
+    size_t gltfStream_t::update(size_t maxUploads)
+    {
+        if (!_shared) return 0;
+        size_t became = 0;
+
+        if (!placeholder)
+        {
+            imageRGBA8_t white(1, 1);
+            memset((void*)white.pixels.data(), 0xFF, 4);
+            placeholder = std::make_shared<texture_t>();
+            placeholder->generate(GL_TEXTURE_2D, 0, GL_RGBA8, 0, white, {});
+        }
+
+        vector<_gltfStreamResult_t> finished;
+        {
+            lock_guard<mutex> lock(_shared->lock);
+            finished.swap(_shared->finished);
+        }
+        for (auto &result : finished)
+        {
+            auto &res = _resource(result.id);
+            --_loading;
+            _loadingBytes -= res.bytes;
+            if (!result.ok)
+            {
+                res.state = FAILED;
+                errors.push_back(result.error);
+                continue;
+            }
+            res.bytes = result.bytes;
+            if (isImage(result.id))
+            {
+                // still loading until it's on the GPU
+                _loadingBytes += res.bytes;
+                _uploads.emplace_back(result.id / 2, std::move(result.image));
+            }
+            else
+            {
+                _primitives[result.id / 2] = std::move(result.primitives);
+                res.state = RESIDENT;
+                resident += res.bytes;
+                ++became;
+            }
+        }
+
+        const size_t uploads = std::min(maxUploads, _uploads.size());
+        for (size_t u = 0; u < uploads; ++u)
+        {
+            const size_t image = _uploads[u].first;
+            for (size_t t : _imageTextures[image])
+                _textures[t] = gltfTexture(*_gltf, t, _uploads[u].second);
+            auto &res = images[image];
+            res.state = RESIDENT;
+            _loadingBytes -= res.bytes;
+            resident += res.bytes;
+            ++became;
+        }
+        _uploads.erase(_uploads.begin(), _uploads.begin() + uploads);
+
+        // least recently requested first, then furthest away first
+        auto lessImportant = [&](size_t a, size_t b) {
+            const auto &ra = _resource(a);
+            const auto &rb = _resource(b);
+            return ra.requested < rb.requested || (ra.requested == rb.requested && ra.priority > rb.priority);
+        };
+        vector<size_t> evictable;
+        bool sorted = false;
+        size_t next = 0;
+        auto evictOne = [&]() -> size_t {
+            if (!sorted)
+            {
+                for (size_t m = 0; m < meshes.size(); ++m)
+                    if (meshes[m].state == RESIDENT) evictable.push_back(meshId(m));
+                for (size_t i = 0; i < images.size(); ++i)
+                    if (images[i].state == RESIDENT) evictable.push_back(imageId(i));
+                std::sort(evictable.begin(), evictable.end(), lessImportant);
+                sorted = true;
+            }
+            return next < evictable.size() ? evictable[next] : (size_t)-1;
+        };
+
+        while (resident > budget)
+        {
+            const size_t id = evictOne();
+            if (id == (size_t)-1) break;
+            _evict(id);
+            ++next;
+        }
+
+        // closest requests first
+        vector<size_t> queue;
+        for (size_t id : _requests)
+            if (_resource(id).state == UNLOADED) queue.push_back(id);
+        auto further = [&](size_t a, size_t b) { return _resource(a).priority > _resource(b).priority; };
+        std::make_heap(queue.begin(), queue.end(), further);
+        while (!queue.empty() && _loading < maxLoads)
+        {
+            std::pop_heap(queue.begin(), queue.end(), further);
+            const size_t id = queue.back();
+            queue.pop_back();
+            const size_t bytes = _resource(id).bytes;
+            // only make room by evicting things that matter less than this
+            while (resident + _loadingBytes + bytes > budget)
+            {
+                const size_t victim = evictOne();
+                if (victim == (size_t)-1 || !lessImportant(victim, id)) break;
+                _evict(victim);
+                ++next;
+            }
+            // everything left in the queue is further away, so stop here
+            if (resident + _loadingBytes + bytes > budget) break;
+            _load(id);
+        }
+
+        _requests.clear();
+        ++_frame;
+        return became;
+    }
+
+    const vector<shared_ptr<mesh_t>> &gltfStream_t::mesh(size_t mesh) const
+    {
+        static const vector<shared_ptr<mesh_t>> none;
+        return mesh < _primitives.size() ? _primitives[mesh] : none;
+    }
+
+    shared_ptr<texture_t> gltfStream_t::texture(size_t texture) const
+    {
+        if (texture < _textures.size() && _textures[texture]) return _textures[texture];
+        return placeholder;
+    }
+}
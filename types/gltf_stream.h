@@ -0,0 +1,135 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <memory>
+
+#include <glm/vec3.hpp>
+
+#include "types/gltf.h"
+#include "types/gltf_loader.h"
+#include "types/scene_graph.h"
+#include "types/mesh.h"
+#include "types/texture.h"
+#include "types/worker_pool.h"
+
+#ifndef LAK_GLTF_STREAM_H
+#define LAK_GLTF_STREAM_H
+
+namespace lak
+{
+    using std::vector;
+    using std::string;
+    using std::shared_ptr;
+
+    struct _gltfStreamShared_t;
+
+    // loads the meshes and images of a gltf_t on demand instead of all at
+    // once. requests are loaded lowest priority value (closest) first, and
+    // the total size of resident data is kept under budget by evicting
+    // whatever was requested least recently, then whatever is furthest away
+    struct gltfStream_t
+    {
+        enum state_t : uint8_t { UNLOADED, LOADING, RESIDENT, FAILED };
+
+        struct resource_t
+        {
+            state_t state = UNLOADED;
+            float priority = 0.0f;      // lowest priority it was requested with in the last requested frame
+            uint64_t requested = 0;     // frame of the last request, 0 if never requested
+            size_t bytes = 0;           // an estimate until it has been loaded once
+        };
+
+        // params
+        size_t budget = (size_t)256 << 20;  // bytes
+        size_t maxLoads = 4;                // loads in flight at once
+        shared_ptr<texture_t> placeholder;  // returned for textures that aren't resident, 1x1 white if not set
+        // readonly
+        size_t resident = 0;                // bytes of resident meshes and images
+        vector<resource_t> meshes;          // index matches gltf_t::meshes
+        vector<resource_t> images;          // index matches gltf_t::images
+        vector<string> errors;
+
+        gltfStream_t() {}
+        gltfStream_t(const gltfStream_t &) = delete;
+        gltfStream_t &operator=(const gltfStream_t &) = delete;
+        ~gltfStream_t();
+
+        // memory maps the buffers of gltf (data uris are decoded), nothing
+        // else is loaded until it's requested. binChunk is used for a buffer
+        // without a uri (GLB). gltf, pool and binChunk must outlive the stream
+        // NOTE: EXT_meshopt_compression views can't be streamed, meshes that
+        // use them fail to load
+        bool open(const gltf_t &gltf, const string &directory, workerPool_t &pool, const uint8_t *binChunk = nullptr, size_t binSize = 0);
+        // waits for loads in flight, then releases everything
+        void close();
+
+        // call every frame for everything that should be resident, priority
+        // is usually the distance to the camera
+        void requestMesh(size_t mesh, float priority);
+        void requestTexture(size_t texture, float priority);
+        // requests the mesh of each graph node, prioritised by the distance
+        // from camera to the node's origin
+        void requestNodes(const sceneGraph_t &graph, const vector<size_t> &nodes, const glm::vec3 &camera);
+
+        // call once per frame (after the requests) from the thread that owns
+        // the GL context. collects finished loads, uploads up to maxUploads
+        // images, evicts to stay under budget and starts new loads.
+        // returns the number of meshes and images that became resident
+        size_t update(size_t maxUploads = -1);
+
+        // primitives of a mesh (index matches gltf_t::mesh_t::primitives),
+        // empty until it is resident. elements are named after the glTF
+        // attributes, no GL calls are made until the first draw
+        const vector<shared_ptr<mesh_t>> &mesh(size_t mesh) const;
+        // texture, or placeholder if its image isn't resident
+        shared_ptr<texture_t> texture(size_t texture) const;
+
+        const gltf_t *_gltf = nullptr;
+        workerPool_t *_pool = nullptr;
+        shared_ptr<_gltfStreamShared_t> _shared;
+        vector<vector<shared_ptr<mesh_t>>> _primitives;    // index matches gltf_t::meshes
+        vector<shared_ptr<texture_t>> _textures;            // index matches gltf_t::textures
+        vector<vector<size_t>> _imageTextures;              // textures that use each image
+        vector<size_t> _requests;                           // resource ids requested this frame
+        vector<std::pair<size_t, imageRGBA8_t>> _uploads;   // decoded images waiting for upload
+        size_t _loading = 0;
+        size_t _loadingBytes = 0;
+        uint64_t _frame = 1;
+        resource_t &_resource(size_t id);
+        void _evict(size_t id);
+        void _load(size_t id);
+    };
+}
+
+#ifdef LAK_GLTF_STREAM_IMPLEM
+#   ifndef LAK_GLTF_STREAM_HAS_IMPLEM
+#       define LAK_GLTF_STREAM_HAS_IMPLEM
+#       include "types/gltf_stream.cpp"
+#   endif // LAK_GLTF_STREAM_HAS_IMPLEM
+#endif // LAK_GLTF_STREAM_IMPLEM
+
+#endif // LAK_GLTF_STREAM_H
@@ -0,0 +1,326 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <algorithm>
+
+#include "utils/mapped_file.h"
+#include "types/gltf_writer.h"
+
+namespace lak
+{
+    using std::ofstream;
+    using std::ostringstream;
+    using std::unordered_multimap;
+
+    // a bufferView in the output, elements are padded out to stride
+    struct _glbPiece_t
+    {
+        const uint8_t *src;
+        size_t elemSize;
+        size_t count;
+        size_t stride;
+        size_t offset;
+        GLenum target;
+    };
+
+    struct _glbLayout_t
+    {
+        vector<_glbPiece_t> pieces;         // sorted by offset
+        vector<size_t> accessorView;        // index matches gltf_t::accessors, -1 if all zeros
+        vector<size_t> imageView;           // index matches gltf_t::images, -1 to keep the uri
+        vector<string> imageMimeType;       // index matches gltf_t::images
+        vector<vector<uint8_t>> decoded;    // data uri images
+        unordered_multimap<uint64_t, size_t> dedup;
+        size_t size = 0;
+    };
+
+    static bool fail(string *error, const string &message)
+    {
+        if (error) *error = message;
+        return false;
+    }
+
+    static inline size_t align4(size_t v) { return (v + 3) & ~(size_t)3; }
+
+    // returns the index of a new bufferView, or an existing one with identical contents
+    static size_t addView(_glbLayout_t *layout, const uint8_t *src, size_t elemSize, size_t count, size_t stride, GLenum target)
+    {
+        const size_t bytes = elemSize * count;
+        const uint64_t hash = hashBytes(src, bytes, ((uint64_t)elemSize << 32) ^ ((uint64_t)target << 16) ^ stride);
+        const auto range = layout->dedup.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            const _glbPiece_t &piece = layout->pieces[it->second];
+            if (piece.elemSize == elemSize && piece.count == count && piece.stride == stride &&
+                piece.target == target && memcmp(piece.src, src, bytes) == 0)
+                return it->second;
+        }
+        const size_t index = layout->pieces.size();
+        const size_t offset = align4(layout->size);
+        layout->pieces.push_back({src, elemSize, count, stride, offset, target});
+        layout->size = offset + (count * stride);
+        layout->dedup.emplace(hash, index);
+        return index;
+    }
+
+    static bool layoutGLB(const gltf_t &gltf, const gltfData_t &data, _glbLayout_t *layout, string *error)
+    {
+        enum : uint8_t { VERTEX = 1, INDEX = 2 };
+        vector<uint8_t> usage(gltf.accessors.size(), 0);
+        for (const auto &mesh : gltf.meshes)
+        {
+            for (const auto &prim : mesh.primitives)
+            {
+                for (const auto &attr : prim.attributes)
+                    if (attr.second < usage.size()) usage[attr.second] |= VERTEX;
+                for (const auto &target : prim.targets)
+                    for (const auto &attr : target)
+                        if (attr.second < usage.size()) usage[attr.second] |= VERTEX;
+                if (prim.indices < usage.size()) usage[prim.indices] |= INDEX;
+            }
+        }
+
+        layout->accessorView.assign(gltf.accessors.size(), -1);
+        for (size_t i = 0; i < gltf.accessors.size(); ++i)
+        {
+            const auto &acc = gltf.accessors[i];
+            if ((acc.bufferView == (size_t)-1 && acc.sparse.count == 0) || acc.count == 0) continue;
+            const size_t elemSize = gltfComponentSize(acc.componentType) * gltfComponentCount(acc.type);
+            if (elemSize == 0)
+                return fail(error, "Accessor " + std::to_string(i) + " has an invalid type");
+            if (i >= data.accessors.size() || data.accessors[i].size() != acc.count * elemSize)
+                return fail(error, "Accessor " + std::to_string(i) + " hasn't been loaded");
+            // vertex attribute elements must be 4 byte aligned
+            const bool vertex = usage[i] & VERTEX;
+            const GLenum target = vertex ? GL_ARRAY_BUFFER : (usage[i] & INDEX) ? GL_ELEMENT_ARRAY_BUFFER : 0;
+            layout->accessorView[i] = addView(layout, data.accessors[i].data.data(), elemSize, acc.count, vertex ? align4(elemSize) : elemSize, target);
+        }
+
+        layout->imageView.assign(gltf.images.size(), -1);
+        layout->imageMimeType.resize(gltf.images.size());
+        for (size_t i = 0; i < gltf.images.size(); ++i)
+        {
+            const auto &image = gltf.images[i];
+            layout->imageMimeType[i] = image.mimeType;
+            const uint8_t *src = nullptr;
+            size_t size = 0;
+            if (image.uri.compare(0, 5, "data:") == 0)
+            {
+                const size_t start = image.uri.find(";base64,");
+                vector<uint8_t> bytes;
+                if (start == string::npos || !decodeBase64(image.uri.c_str() + start + 8, image.uri.size() - (start + 8), &bytes))
+                    return fail(error, "Failed to decode image " + std::to_string(i));
+                if (layout->imageMimeType[i] == "")
+                    layout->imageMimeType[i] = image.uri.substr(5, start - 5);
+                layout->decoded.push_back(std::move(bytes));
+                src = layout->decoded.back().data();
+                size = layout->decoded.back().size();
+            }
+            else if (image.uri == "")
+            {
+                src = gltfBufferView(gltf, data.buffers, image.bufferView);
+                if (src == nullptr)
+                    return fail(error, "Image " + std::to_string(i) + " references a missing bufferView");
+                size = gltf.bufferViews[image.bufferView].byteLength;
+            }
+            if (src != nullptr && size > 0)
+                layout->imageView[i] = addView(layout, src, size, 1, size, 0);
+        }
+
+        layout->size = align4(layout->size);
+        return true;
+    }
+
+    // the JSON for gltf with its bufferViews and buffers replaced by layout
+    static string layoutJSON(const gltf_t &gltf, const _glbLayout_t &layout, const string &binUri)
+    {
+        using object_t = JSON::object_t;
+        using array_t = JSON::array_t;
+
+        JSON json;
+        json = gltf;
+        object_t &root = json.as<object_t>();
+
+        if (auto it = root.find("accessors"s); it != root.end())
+        {
+            array_t &accessors = it->second.as<array_t>();
+            for (size_t i = 0; i < accessors.size(); ++i)
+            {
+                object_t &acc = accessors[i].as<object_t>();
+                acc.erase("sparse"s);
+                if (layout.accessorView[i] != (size_t)-1)
+                {
+                    acc["bufferView"s] = layout.accessorView[i];
+                    acc["byteOffset"s] = (size_t)0;
+                }
+                else
+                {
+                    acc.erase("bufferView"s);
+                    acc.erase("byteOffset"s);
+                }
+            }
+        }
+
+        if (auto it = root.find("images"s); it != root.end())
+        {
+            array_t &images = it->second.as<array_t>();
+            for (size_t i = 0; i < images.size(); ++i)
+            {
+                if (layout.imageView[i] == (size_t)-1) continue;
+                object_t &image = images[i].as<object_t>();
+                image.erase("uri"s);
+                image["bufferView"s] = layout.imageView[i];
+                image["mimeType"s] = layout.imageMimeType[i];
+            }
+        }
+
+        root.erase("bufferViews"s);
+        root.erase("buffers"s);
+        if (!layout.pieces.empty())
+        {
+            vector<gltf_t::bufferView_t> views(layout.pieces.size());
+            for (size_t i = 0; i < views.size(); ++i)
+            {
+                const _glbPiece_t &piece = layout.pieces[i];
+                views[i].buffer = 0;
+                views[i].byteOffset = piece.offset;
+                views[i].byteLength = piece.count * piece.stride;
+                views[i].byteStride = piece.target == GL_ARRAY_BUFFER ? piece.stride : 0;
+                views[i].target = piece.target;
+            }
+            root["bufferViews"s] = views;
+            gltf_t::buffer_t buffer;
+            buffer.byteLength = layout.size;
+            buffer.uri = binUri;
+            root["buffers"s] = vector<gltf_t::buffer_t>{buffer};
+        }
+
+        // everything is written uncompressed
+        for (const char *key : {"extensionsUsed", "extensionsRequired"})
+        {
+            vector<string> extensions;
+            if (!json(string(key), extensions)) continue;
+            extensions.erase(std::remove(extensions.begin(), extensions.end(), "EXT_meshopt_compression"), extensions.end());
+            if (extensions.empty()) root.erase(key);
+            else root[key] = extensions;
+        }
+
+        ostringstream strm;
+        strm << json;
+        return strm.str();
+    }
+
+    static bool writeBinary(ostream &out, const _glbLayout_t &layout)
+    {
+        static const char zeros[4] = {};
+        vector<uint8_t> staging;
+        size_t pos = 0;
+        for (const _glbPiece_t &piece : layout.pieces)
+        {
+            if (piece.offset < pos) continue; // only happens if the layout is broken
+            out.write(zeros, piece.offset - pos);
+            if (piece.stride == piece.elemSize)
+            {
+                out.write((const char*)piece.src, piece.count * piece.elemSize);
+            }
+            else
+            {
+                // pad elements in batches rather than writing them one at a time
+                const size_t batch = std::max<size_t>(1, (64 << 10) / piece.stride);
+                staging.assign(std::min(batch, piece.count) * piece.stride, 0);
+                for (size_t first = 0; first < piece.count; first += batch)
+                {
+                    const size_t count = std::min(batch, piece.count - first);
+                    for (size_t i = 0; i < count; ++i)
+                        memcpy(staging.data() + (i * piece.stride), piece.src + ((first + i) * piece.elemSize), piece.elemSize);
+                    out.write((const char*)staging.data(), count * piece.stride);
+                }
+            }
+            pos = piece.offset + (piece.count * piece.stride);
+        }
+        out.write(zeros, layout.size - pos);
+        return (bool)out;
+    }
+
+    static void writeU32(ostream &out, uint32_t v)
+    {
+        const char bytes[4] = {(char)(v & 0xFF), (char)((v >> 8) & 0xFF), (char)((v >> 16) & 0xFF), (char)((v >> 24) & 0xFF)};
+        out.write(bytes, 4);
+    }
+
+    bool writeGLB(const gltf_t &gltf, const gltfData_t &data, ostream &out, string *error)
+    {
+        _glbLayout_t layout;
+        if (!layoutGLB(gltf, data, &layout, error)) return false;
+        string json = layoutJSON(gltf, layout, "");
+        json.resize(align4(json.size()), ' ');
+
+        const uint64_t total = 12 + 8 + json.size() + (layout.size > 0 ? 8 + layout.size : 0);
+        if (total > UINT32_MAX) return fail(error, "GLB files can't be larger than 4GB");
+
+        writeU32(out, 0x46546C67); // "glTF"
+        writeU32(out, 2);
+        writeU32(out, (uint32_t)total);
+        writeU32(out, (uint32_t)json.size());
+        writeU32(out, 0x4E4F534A); // "JSON"
+        out.write(json.data(), json.size());
+        if (layout.size > 0)
+        {
+            writeU32(out, (uint32_t)layout.size);
+            writeU32(out, 0x004E4942); // "BIN\0"
+            if (!writeBinary(out, layout)) return fail(error, "Failed to write binary chunk");
+        }
+        return (bool)out || fail(error, "Failed to write GLB");
+    }
+
+    bool writeGLB(const gltf_t &gltf, const gltfData_t &data, const string &path, string *error)
+    {
+        ofstream strm(path, std::ios::binary | std::ios::trunc);
+        if (!strm.is_open()) return fail(error, "Failed to open " + path);
+        return writeGLB(gltf, data, strm, error);
+    }
+
+    bool writeGLTF(const gltf_t &gltf, const gltfData_t &data, const string &path, const string &binName, string *error)
+    {
+        _glbLayout_t layout;
+        if (!layoutGLB(gltf, data, &layout, error)) return false;
+        {
+            ofstream strm(path, std::ios::binary | std::ios::trunc);
+            if (!strm.is_open()) return fail(error, "Failed to open " + path);
+            const string json = layoutJSON(gltf, layout, binName);
+            if (!strm.write(json.data(), json.size())) return fail(error, "Failed to write " + path);
+        }
+        if (layout.size == 0) return true;
+
+        const size_t slash = path.find_last_of("/\\");
+        const string binPath = slash == string::npos ? binName : path.substr(0, slash + 1) + binName;
+        ofstream strm(binPath, std::ios::binary | std::ios::trunc);
+        if (!strm.is_open()) return fail(error, "Failed to open " + binPath);
+        return writeBinary(strm, layout) || fail(error, "Failed to write " + binPath);
+    }
+}
@@ -0,0 +1,64 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <iostream>
+
+#include "types/gltf.h"
+#include "types/gltf_loader.h"
+
+#ifndef LAK_GLTF_WRITER_H
+#define LAK_GLTF_WRITER_H
+
+namespace lak
+{
+    using std::vector;
+    using std::string;
+    using std::ostream;
+
+    // writes a loaded glTF with all of its accessor data repacked into a
+    // single binary buffer. every accessor gets its own bufferView (4 byte
+    // aligned, vertex attributes padded to 4 byte elements), sparse and
+    // EXT_meshopt_compression accessors are written dense and identical data
+    // shares a bufferView. images stored in bufferViews or data uris are
+    // moved into the buffer, images with file uris are left as is.
+    // binary data is streamed from data straight into the output
+    bool writeGLB(const gltf_t &gltf, const gltfData_t &data, ostream &out, string *error = nullptr);
+    bool writeGLB(const gltf_t &gltf, const gltfData_t &data, const string &path, string *error = nullptr);
+
+    // same as writeGLB, but as a .gltf file and a .bin file. binName is the
+    // uri of the .bin, relative to path
+    bool writeGLTF(const gltf_t &gltf, const gltfData_t &data, const string &path, const string &binName, string *error = nullptr);
+}
+
+#ifdef LAK_GLTF_WRITER_IMPLEM
+#   ifndef LAK_GLTF_WRITER_HAS_IMPLEM
+#       define LAK_GLTF_WRITER_HAS_IMPLEM
+#       include "types/gltf_writer.cpp"
+#   endif // LAK_GLTF_WRITER_HAS_IMPLEM
+#endif // LAK_GLTF_WRITER_IMPLEM
+
+#endif // LAK_GLTF_WRITER_H
@@ -32,6 +32,7 @@ SOFTWARE.
 #include <memory>
 #include <cassert>
 #include <type_traits>
+#include <limits>
 
 #include "utils/type.h"
 #include "utils/stream.h"
@@ -220,80 +221,78 @@ namespace lak
             return key < arr.size() ? &(arr[key]) : nullptr;
         }
 
-        // type-safe copy from index into val, val not touched if incorrect type or non-existent index
-        template<typename K, typename T>
-        inline enable_if_t<is_same_v<K, objkey_t> || is_same_v<K, arrkey_t>,
-        bool> operator()(const K &key, T &val) const
+        // type-safe copy from this into val, val not touched if incorrect type
+        // (containers are always cleared)
+        template<typename T>
+        inline bool get_value(T &val) const
         {
-            bool rtn = false;
-            if (const json_t *obj = (*this)(key); obj)
+            // we use `if constexpr` here to avoid compiler errors from
+            // bad syntax and/or function calls by checking if T is one
+            // of the *possible* types for this. the inner `holds` then
+            // checks the actual type at runtime
+            if constexpr (std::is_arithmetic_v<T> && !is_same_v<T, boolean_t>)
             {
-                // we use `if constexpr` here to avoid compiler errors from
-                // bad syntax and/or function calls by checking if T is one
-                // of the *possible* types for obj. the inner `obj->holds` then
-                // checks the actual type at runtime
-                if constexpr (is_template_v<vector, T>)
-                {
-                    val.clear(); // always clear
-                    if (obj->holds<array_t>())
-                    {
-                        rtn = true; // only return true if key exists and type is correct
-                        // val is an array type
-                        const array_t &array = (const array_t&)*obj;
-                        for (const json_t &a : array)
-                        {
-                            if (a.holds<typename T::value_type>())
-                            {
-                                if constexpr (might_hold<typename T::value_type>)
-                                {
-                                    val.push_back((const typename T::value_type&)a);
-                                }
-                                else
-                                {
-                                    val.emplace_back();
-                                    val.back() = a;
-                                }
-                            }
-                        }
-                    }
-                }
-                else if constexpr (is_template_v<map, T> || is_template_v<unordered_map, T>)
-                {
-                    val.clear(); // always clear
-                    if (obj->holds<object_t>())
-                    {
-                        rtn = true; // only return true if key exists and type is correct
-                        // val is an object type
-                        const object_t &object = (const object_t&)*obj;
-                        for (const auto &[k, o] : object)
-                        {
-                            if (((const json_t&)o).holds<typename T::mapped_type>())
-                            {
-                                if constexpr (might_hold<typename T::mapped_type>)
-                                {
-                                    val[k] = (const typename T::mapped_type&)o;
-                                }
-                                else
-                                {
-                                    val[k] = o;
-                                }
-                            }
-                        }
-                    }
-                }
-                else if constexpr (might_hold<T>)
+                // numbers are parsed as double, so convert from whatever
+                // number type we actually hold
+                if (value.index() != get_index_v<number_t, value_t>)
+                    return false;
+                std::visit([&val](const auto &n) { val = static_cast<T>(n); }, get<number_t>(value));
+                return true;
+            }
+            else if constexpr (is_template_v<vector, T>)
+            {
+                val.clear(); // always clear
+                if (!holds<array_t>())
+                    return false;
+                // val is an array type
+                const array_t &array = get<array_t>(value);
+                val.reserve(array.size());
+                for (const json_t &a : array)
                 {
-                    if (obj->holds<T>())
-                        val = (const T&)*obj; rtn = true;
+                    typename T::value_type v{};
+                    if (a.get_value(v))
+                        val.push_back(std::move(v));
                 }
-                else
+                return true; // only return true if key exists and type is correct
+            }
+            else if constexpr (is_template_v<map, T> || is_template_v<unordered_map, T>)
+            {
+                val.clear(); // always clear
+                if (!holds<object_t>())
+                    return false;
+                // val is an object type
+                const object_t &object = get<object_t>(value);
+                for (const auto &[k, o] : object)
                 {
-                    // T might have a `bool operator=(json)` function
-                    // if not, this will probably throw a compiler error
-                    rtn = (val = *obj); // if you can see this your type is missing an (type=json_t)->bool operator
+                    typename T::mapped_type v{};
+                    if (o.get_value(v))
+                        val[k] = std::move(v);
                 }
+                return true; // only return true if key exists and type is correct
             }
-            return rtn;
+            else if constexpr (might_hold<T>)
+            {
+                if (!holds<T>())
+                    return false;
+                val = (const T&)*this;
+                return true;
+            }
+            else
+            {
+                // T might have a `bool operator=(json)` function
+                // if not, this will probably throw a compiler error
+                return (val = *this); // if you can see this your type is missing an (type=json_t)->bool operator
+            }
+        }
+
+        // type-safe copy from index into val, val not touched if incorrect type or non-existent index
+        template<typename K, typename T>
+        inline enable_if_t<is_same_v<K, objkey_t> || is_same_v<K, arrkey_t>,
+        bool> operator()(const K &key, T &val) const
+        {
+            if (const json_t *obj = (*this)(key); obj)
+                return obj->get_value(val);
+            return false;
         }
 
         template<typename T>
@@ -315,7 +314,7 @@ namespace lak
             >)
                 value = rhs;
             else
-                *this << rhs; // if you can see this your type is missing an json_t << type operator
+                *this = rhs; // containers use the operator= overloads below, anything else ends up at json_t << type
         }
 
         template<typename T>
@@ -457,96 +456,89 @@ namespace lak
     template<typename ...T> using json_null_t       = typename json_t<T...>::null_t;
     template<typename ...T> using json_value_t      = typename json_t<T...>::value_t;
 
+    // writes str as a quoted JSON string, escaping as needed
+    inline void writeJSONString(ostream &os, const string &str)
+    {
+        static const char hex[] = "0123456789abcdef";
+        os.put('"');
+        size_t run = 0; // start of the current run of characters that don't need escaping
+        for (size_t i = 0; i < str.size(); ++i)
+        {
+            const unsigned char c = (unsigned char)str[i];
+            if (c >= 0x20 && c != '"' && c != '\\') continue;
+            os.write(str.data() + run, i - run);
+            run = i + 1;
+            switch (c)
+            {
+                case '"': os << "\\\""; break;
+                case '\\': os << "\\\\"; break;
+                case '\n': os << "\\n"; break;
+                case '\r': os << "\\r"; break;
+                case '\t': os << "\\t"; break;
+                default: os << "\\u00" << hex[c >> 4] << hex[c & 0xF]; break;
+            }
+        }
+        os.write(str.data() + run, str.size() - run);
+        os.put('"');
+    }
+
+    // compact (no whitespace) JSON output
     template<typename ...T>
     ostream& operator<<(ostream& os, const json_t<T...> &json)
     {
-        using this_t    = json_t<T...>;
         using object_t  = json_object_t<T...>;
         using array_t   = json_array_t<T...>;
         using string_t  = json_string_t<T...>;
         using number_t  = json_number_t<T...>;
         using boolean_t = json_boolean_t<T...>;
-        using null_t    = json_null_t<T...>;
         using value_t   = json_value_t<T...>;
 
         switch(json.value.index())
         {
             case get_index_v<boolean_t, value_t>: {
-                if ((boolean_t&)json)
-                    os << "true";
-                else
-                    os << "false";
+                os << (get<boolean_t>(json.value) ? "true" : "false");
             } break;
             case get_index_v<string_t, value_t>: {
-                // TODO: variadic switch
-                string_t &strs = (string_t&)json;
-                switch(strs.index())
-                {
-                    case get_index_v<string, string_t>: {
-                        os << (string&)json;
-                    }
-                }
+                std::visit([&os](const auto &str) { writeJSONString(os, str); }, get<string_t>(json.value));
             } break;
             case get_index_v<number_t, value_t>: {
-                // TODO: variadic switch
-                number_t &nums = (number_t&)json;
-                switch(nums.index())
-                {
-                    case get_index_v<double, number_t>: {
-                        os << (double&)json;
-                    } break;
-                    case get_index_v<float, number_t>: {
-                        os << (float&)json;
-                    } break;
-                    case get_index_v<uint64_t, number_t>: {
-                        os << (uint64_t&)json;
-                    } break;
-                    case get_index_v<int64_t, number_t>: {
-                        os << (int64_t&)json;
-                    } break;
-                    case get_index_v<uint32_t, number_t>: {
-                        os << (uint32_t&)json;
-                    } break;
-                    case get_index_v<int32_t, number_t>: {
-                        os << (int32_t&)json;
-                    } break;
-                    case get_index_v<uint16_t, number_t>: {
-                        os << (uint16_t&)json;
-                    } break;
-                    case get_index_v<int16_t, number_t>: {
-                        os << (int16_t&)json;
-                    } break;
-                    case get_index_v<uint8_t, number_t>: {
-                        os << (uint8_t&)json;
-                    } break;
-                    case get_index_v<int8_t, number_t>: {
-                        os << (int8_t&)json;
-                    } break;
-                }
+                std::visit([&os](const auto &num) {
+                    using num_t = remove_reference_t<decltype(num)>;
+                    if constexpr (std::is_floating_point_v<num_t>)
+                    {
+                        // JSON has no inf or nan
+                        if (num != num || num - num != 0) { os << "null"; return; }
+                        const std::streamsize precision = os.precision(std::numeric_limits<num_t>::max_digits10);
+                        os << num;
+                        os.precision(precision);
+                    }
+                    else if constexpr (sizeof(num_t) == 1)
+                        os << (int)num; // don't print as a char
+                    else
+                        os << num;
+                }, get<number_t>(json.value));
             } break;
             case get_index_v<object_t, value_t>: {
                 os << "{";
-                object_t &obj = (object_t&)json;
-                for (auto &it = obj.keys.begin(); it != obj.keys.end();)
+                const object_t &obj = get<object_t>(json.value);
+                for (auto it = obj.begin(); it != obj.end(); ++it)
                 {
-                    os << "\"" << it->first << "\" : " << obj.values[it->second];
-                    if ((++it) != obj.keys.end())
-                        os << ", ";
+                    if (it != obj.begin()) os << ",";
+                    writeJSONString(os, it->first);
+                    os << ":" << it->second;
                 }
                 os << "}";
             } break;
             case get_index_v<array_t, value_t>: {
                 os << "[";
-                array_t &arr = (array_t&)json.value;
-                for (auto &it = arr.begin(); it != arr.end();)
+                const array_t &arr = get<array_t>(json.value);
+                for (auto it = arr.begin(); it != arr.end(); ++it)
                 {
+                    if (it != arr.begin()) os << ",";
                     os << *it;
-                    if ((++it) != arr.end())
-                        os << ", ";
                 }
                 os << "]";
             } break;
-            case get_index_v<null_t, value_t>:
             default: {
                 os << "null";
             } break;
@@ -110,9 +110,36 @@ namespace lak
             #endif // LTEST
         }
 
+        if (_rebind)
+        {
+            _rebind = false;
+            return true;
+        }
+
         return dirty;
     }
 
+    void vertexBuffer_t::setInterlaced(const void *data, size_t bytes)
+    {
+        bind();
+        size = bytes;
+        glBufferData(GL_ARRAY_BUFFER, size, data, usage);
+        for (auto &elem : elements)
+            elem.second.dirty = false;
+        _rebind = true;
+    }
+
+    void vertexBuffer_t::write(const void *data, size_t bytes, size_t offset)
+    {
+        #ifdef LTEST
+        LASSERT(offset + bytes <= size, "Write out of range");
+        #endif // LTEST
+
+        if (offset + bytes > size) return;
+        bind();
+        glBufferSubData(GL_ARRAY_BUFFER, offset, bytes, data);
+    }
+
     //
     // vertexArray_t
     //
@@ -151,6 +178,20 @@ namespace lak
     // mesh_t
     //
 
+    static size_t glTypeSize(GLenum type)
+    {
+        switch (type)
+        {
+            case GL_BYTE:
+            case GL_UNSIGNED_BYTE: return 1;
+            case GL_SHORT:
+            case GL_UNSIGNED_SHORT:
+            case GL_HALF_FLOAT: return 2;
+            case GL_DOUBLE: return 8;
+            default: return 4;
+        }
+    }
+
     void mesh_t::update()
     {
         if (!vertArray.vertArray)
@@ -171,21 +212,31 @@ namespace lak
                 const auto &attribute = shader->attributes.find(element.first);
                 if (attribute != shader->attributes.end())
                 {
+                    // matrices take up one attribute location per column
+                    const GLint columns = element.second.size == 16 ? 4 : element.second.size == 9 ? 3 : 1;
+                    const GLint rows = element.second.size / columns;
                     if (element.second.active)
                     {
-                        glEnableVertexAttribArray(attribute->second.position);
-                        glVertexAttribDivisor(attribute->second.position, element.second.divisor);
-                        glVertexAttribPointer(attribute->second.position, element.second.size, element.second.type, element.second.normalised, element.second.interlacedStride, (GLvoid*)element.second.offset);
+                        for (GLint c = 0; c < columns; ++c)
+                        {
+                            const GLuint location = attribute->second.position + c;
+                            const GLintptr offset = element.second.offset + (c * rows * glTypeSize(element.second.type));
+                            glEnableVertexAttribArray(location);
+                            glVertexAttribDivisor(location, element.second.divisor);
+                            glVertexAttribPointer(location, rows, element.second.type, element.second.normalised, element.second.interlacedStride, (GLvoid*)offset);
+                        }
                         attribute->second.active = true;
 
                         #ifdef LTEST
                         LASSERT(attribute->second.size == element.second.size, "Shader and buffer type size don't match");
-                        LASSERT(attribute->second.type == element.second.type, "Shader and buffer type don't match");
+                        // integer data is converted (or normalised) when the shader takes floats
+                        LASSERT(attribute->second.type == GL_FLOAT || attribute->second.type == element.second.type, "Shader and buffer type don't match");
                         #endif // LTEST
                     }
                     else
                     {
-                        glDisableVertexAttribArray(attribute->second.position);
+                        for (GLint c = 0; c < columns; ++c)
+                            glDisableVertexAttribArray(attribute->second.position + c);
                         attribute->second.active = false;
                     }
                 }
@@ -239,4 +290,42 @@ namespace lak
         else
             glDrawArraysInstanced(drawMode, 0, indexCount, count);
     }
-}
\ No newline at end of file
+
+    void mesh_t::draw(const drawRange_t *ranges, size_t rangeCount)
+    {
+        if (!rangeCount) return;
+
+        if (dirty)
+            update();
+        else
+            vertArray.bind();
+
+        #ifdef LTEST
+        LASSERT(shader.use_count(), "No shader");
+        LASSERT(index.size() > 0, "Range draws need indices");
+        #endif // LTEST
+
+        if (index.size() == 0) return;
+
+        if (shader.use_count() > 0)
+            shader->enable();
+        for (auto &texture : textures)
+            if (texture.second.use_count() > 0)
+                texture.second->bind();
+
+        thread_local vector<GLsizei> counts;
+        thread_local vector<const void*> offsets;
+        thread_local vector<GLint> baseVertices;
+        counts.resize(rangeCount);
+        offsets.resize(rangeCount);
+        baseVertices.resize(rangeCount);
+        for (size_t i = 0; i < rangeCount; ++i)
+        {
+            counts[i] = ranges[i].count;
+            offsets[i] = (const void*)(ranges[i].firstIndex * sizeof(GLuint));
+            baseVertices[i] = ranges[i].baseVertex;
+        }
+
+        glMultiDrawElementsBaseVertex(drawMode, counts.data(), GL_UNSIGNED_INT, offsets.data(), (GLsizei)rangeCount, baseVertices.data());
+    }
+}
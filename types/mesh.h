@@ -79,10 +79,18 @@ namespace lak
         // params
         unordered_map<string, vertexElement_t> elements{};
         GLenum usage = GL_STATIC_DRAW;
+        bool _rebind = false;
         vertexBuffer_t();
         ~vertexBuffer_t();
         void bind();
         bool update();
+        // replaces the whole buffer with data that is already interlaced, the
+        // elements' offset and interlacedStride must already be set (their
+        // data is ignored). attributes are rebound on the next mesh_t::update
+        void setInterlaced(const void *data, size_t bytes);
+        // overwrite part of the buffer with data that is already interlaced
+        // (see vertexElement_t::offset and interlacedStride), only valid after update()
+        void write(const void *data, size_t bytes, size_t offset = 0);
     };
 
     struct vertexArray_t
@@ -97,6 +105,14 @@ namespace lak
         ~vertexArray_t();
     };
 
+    // a sub range of a mesh_t's index buffer
+    struct drawRange_t
+    {
+        GLsizei count = 0;          // number of indices
+        size_t firstIndex = 0;      // offset into mesh_t::index
+        GLint baseVertex = 0;       // added to each index
+    };
+
     struct mesh_t
     {
         // readonly
@@ -110,6 +126,9 @@ namespace lak
         bool dirty = true;          // set true to force an update during the next draw call
         void update();
         void draw(GLsizei count = 1, const void *indexOffset = NULL);
+        // draws several ranges of the index buffer with a single call
+        // (glMultiDrawElementsBaseVertex), requires index mode
+        void draw(const drawRange_t *ranges, size_t rangeCount);
     };
 }
 
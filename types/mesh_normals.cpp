@@ -0,0 +1,341 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include "types/mesh_normals.h"
+
+namespace lak
+{
+    using std::vector;
+
+    // triangles per binning range and vertices per accumulation bucket
+    static const size_t _normalTriangles = 1 << 15;
+    static const size_t _normalVertices = 1 << 15;
+
+    template <size_t N>
+    struct _normalBin_t
+    {
+        uint32_t vertex;
+        float value[N];
+    };
+
+    static inline const float *_normalAt(const float *data, size_t stride, size_t v)
+    {
+        return (const float*)((const uint8_t*)data + (v * stride));
+    }
+
+    static inline float *_normalAt(float *data, size_t stride, size_t v)
+    {
+        return (float*)((uint8_t*)data + (v * stride));
+    }
+
+    static inline void _normalSub(float *out, const float *a, const float *b)
+    {
+        out[0] = a[0] - b[0]; out[1] = a[1] - b[1]; out[2] = a[2] - b[2];
+    }
+
+    static inline void _normalCross(float *out, const float *a, const float *b)
+    {
+        out[0] = (a[1] * b[2]) - (a[2] * b[1]);
+        out[1] = (a[2] * b[0]) - (a[0] * b[2]);
+        out[2] = (a[0] * b[1]) - (a[1] * b[0]);
+    }
+
+    static inline float _normalDot(const float *a, const float *b)
+    {
+        return (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]);
+    }
+
+    // normalizes v, returns false (leaving it alone) if it's too short
+    static inline bool _normalize(float *v)
+    {
+        const float length = std::sqrt(_normalDot(v, v));
+        if (!(length > 1e-20f)) return false;
+        v[0] /= length; v[1] /= length; v[2] /= length;
+        return true;
+    }
+
+    // the angles at each corner of the triangle p0 p1 p2
+    static void _cornerAngles(float *angles, const float *p0, const float *p1, const float *p2)
+    {
+        const float *p[3] = {p0, p1, p2};
+        for (size_t c = 0; c < 3; ++c)
+        {
+            float a[3], b[3];
+            _normalSub(a, p[(c + 1) % 3], p[c]);
+            _normalSub(b, p[(c + 2) % 3], p[c]);
+            const float lengths = std::sqrt(_normalDot(a, a) * _normalDot(b, b));
+            float cosine = lengths > 0.0f ? _normalDot(a, b) / lengths : 1.0f;
+            cosine = cosine < -1.0f ? -1.0f : cosine > 1.0f ? 1.0f : cosine;
+            angles[c] = std::acos(cosine);
+        }
+    }
+
+    static void _normalRun(workerPool_t *pool, size_t count, const std::function<void(size_t, size_t)> &func, size_t minRange)
+    {
+        if (pool != nullptr && pool->size() > 1) parallelFor(*pool, count, func, minRange);
+        else func(0, count);
+    }
+
+    // sums N floats per triangle corner into sums[remap[vertex]].
+    // contribute(t, values) fills values for the 3 corners of triangle t
+    // or returns false to skip it. with a pool every range of triangles
+    // bins its values by vertex bucket and then every bucket adds up its
+    // bins in range order, which is the serial order, so no atomics or
+    // per thread copies of the whole vertex array are needed
+    template <size_t N, typename contribute_t>
+    static void _accumulate(vector<float> *sums, size_t vertexCount, const uint32_t *indices,
+        size_t triangleCount, const uint32_t *remap, const contribute_t &contribute, workerPool_t *pool)
+    {
+        sums->assign(vertexCount * N, 0.0f);
+        auto target = [&](size_t i) -> size_t { return remap != nullptr ? remap[indices[i]] : indices[i]; };
+        const size_t ranges = (triangleCount + _normalTriangles - 1) / _normalTriangles;
+        if (pool == nullptr || pool->size() <= 1 || ranges <= 1)
+        {
+            float values[3][N];
+            for (size_t t = 0; t < triangleCount; ++t)
+            {
+                if (!contribute(t, values)) continue;
+                for (size_t c = 0; c < 3; ++c)
+                {
+                    float *sum = &(*sums)[target((t * 3) + c) * N];
+                    for (size_t n = 0; n < N; ++n) sum[n] += values[c][n];
+                }
+            }
+            return;
+        }
+
+        const size_t buckets = (vertexCount + _normalVertices - 1) / _normalVertices;
+        vector<vector<_normalBin_t<N>>> bins(ranges * buckets);
+        parallelFor(*pool, ranges, [&](size_t begin, size_t end) {
+            float values[3][N];
+            for (size_t r = begin; r < end; ++r)
+            {
+                vector<_normalBin_t<N>> *row = &bins[r * buckets];
+                const size_t last = std::min(triangleCount, (r + 1) * _normalTriangles);
+                for (size_t t = r * _normalTriangles; t < last; ++t)
+                {
+                    if (!contribute(t, values)) continue;
+                    for (size_t c = 0; c < 3; ++c)
+                    {
+                        _normalBin_t<N> bin;
+                        bin.vertex = (uint32_t)target((t * 3) + c);
+                        memcpy(bin.value, values[c], sizeof(bin.value));
+                        row[bin.vertex / _normalVertices].push_back(bin);
+                    }
+                }
+            }
+        });
+        parallelFor(*pool, buckets, [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; ++b)
+            {
+                for (size_t r = 0; r < ranges; ++r)
+                {
+                    for (const auto &bin : bins[(r * buckets) + b])
+                    {
+                        float *sum = &(*sums)[bin.vertex * N];
+                        for (size_t n = 0; n < N; ++n) sum[n] += bin.value[n];
+                    }
+                    vector<_normalBin_t<N>>().swap(bins[(r * buckets) + b]);
+                }
+            }
+        });
+    }
+
+    // true if all three indices of triangle t are below vertexCount
+    static inline bool _validTriangle(const uint32_t *indices, size_t t, size_t vertexCount, const uint32_t *remap)
+    {
+        for (size_t c = 0; c < 3; ++c)
+        {
+            const uint32_t i = indices[(t * 3) + c];
+            if (i >= vertexCount || (remap != nullptr && remap[i] >= vertexCount)) return false;
+        }
+        return true;
+    }
+
+    void generateNormals(float *normals, size_t normalStride,
+        const float *positions, size_t positionStride, size_t vertexCount,
+        const uint32_t *indices, size_t indexCount, const uint32_t *remap,
+        normalWeight_t weight, workerPool_t *pool)
+    {
+        vector<float> sums;
+        _accumulate<3>(&sums, vertexCount, indices, indexCount / 3, remap, [&](size_t t, float (*values)[3]) {
+            if (!_validTriangle(indices, t, vertexCount, remap)) return false;
+            const float *p0 = _normalAt(positions, positionStride, indices[(t * 3) + 0]);
+            const float *p1 = _normalAt(positions, positionStride, indices[(t * 3) + 1]);
+            const float *p2 = _normalAt(positions, positionStride, indices[(t * 3) + 2]);
+            float e1[3], e2[3], n[3];
+            _normalSub(e1, p1, p0);
+            _normalSub(e2, p2, p0);
+            _normalCross(n, e1, e2);    // length is twice the area
+            const float length = std::sqrt(_normalDot(n, n));
+            if (!(length > 0.0f)) return false;
+            float angles[3] = {1.0f, 1.0f, 1.0f};
+            if (weight != NORMAL_WEIGHT_AREA) _cornerAngles(angles, p0, p1, p2);
+            for (size_t c = 0; c < 3; ++c)
+            {
+                const float scale = weight == NORMAL_WEIGHT_ANGLE ? angles[c] / length : angles[c];
+                for (size_t i = 0; i < 3; ++i) values[c][i] = n[i] * scale;
+            }
+            return true;
+        }, pool);
+
+        _normalRun(pool, vertexCount, [&](size_t begin, size_t end) {
+            for (size_t v = begin; v < end; ++v)
+            {
+                const size_t source = remap != nullptr && remap[v] < vertexCount ? remap[v] : v;
+                float n[3] = {sums[source * 3], sums[(source * 3) + 1], sums[(source * 3) + 2]};
+                if (!_normalize(n)) { n[0] = 0.0f; n[1] = 0.0f; n[2] = 1.0f; }
+                memcpy(_normalAt(normals, normalStride, v), n, sizeof(n));
+            }
+        }, 4096);
+    }
+
+    void generateTangents(float *tangents, size_t tangentStride,
+        const float *positions, size_t positionStride,
+        const float *normals, size_t normalStride,
+        const float *texcoords, size_t texcoordStride, size_t vertexCount,
+        const uint32_t *indices, size_t indexCount, const uint32_t *remap,
+        workerPool_t *pool)
+    {
+        // 3 floats of tangent followed by 3 of bitangent
+        vector<float> sums;
+        _accumulate<6>(&sums, vertexCount, indices, indexCount / 3, remap, [&](size_t t, float (*values)[6]) {
+            if (!_validTriangle(indices, t, vertexCount, remap)) return false;
+            uint32_t i[3];
+            const float *p[3], *uv[3];
+            for (size_t c = 0; c < 3; ++c)
+            {
+                i[c] = indices[(t * 3) + c];
+                p[c] = _normalAt(positions, positionStride, i[c]);
+                uv[c] = _normalAt(texcoords, texcoordStride, i[c]);
+            }
+            float e1[3], e2[3];
+            _normalSub(e1, p[1], p[0]);
+            _normalSub(e2, p[2], p[0]);
+            const float s1 = uv[1][0] - uv[0][0], t1 = uv[1][1] - uv[0][1];
+            const float s2 = uv[2][0] - uv[0][0], t2 = uv[2][1] - uv[0][1];
+            const float area = (s1 * t2) - (s2 * t1);   // signed, twice the uv area
+            if (!(std::fabs(area) > 0.0f)) return false;
+            // dp/du and dp/dv, only the direction matters (flipped with the
+            // uv winding) since MikkTSpace weights by angle rather than area
+            const float sign = area < 0.0f ? -1.0f : 1.0f;
+            float tangent[3], bitangent[3];
+            for (size_t a = 0; a < 3; ++a)
+            {
+                tangent[a] = ((e1[a] * t2) - (e2[a] * t1)) * sign;
+                bitangent[a] = ((e2[a] * s1) - (e1[a] * s2)) * sign;
+            }
+            float angles[3];
+            _cornerAngles(angles, p[0], p[1], p[2]);
+            for (size_t c = 0; c < 3; ++c)
+            {
+                const float *n = _normalAt(normals, normalStride, i[c]);
+                float ct[3], cb[3];
+                const float dt = _normalDot(n, tangent), db = _normalDot(n, bitangent);
+                for (size_t a = 0; a < 3; ++a)
+                {
+                    ct[a] = tangent[a] - (n[a] * dt);
+                    cb[a] = bitangent[a] - (n[a] * db);
+                }
+                if (!_normalize(ct)) ct[0] = ct[1] = ct[2] = 0.0f;
+                if (!_normalize(cb)) cb[0] = cb[1] = cb[2] = 0.0f;
+                for (size_t a = 0; a < 3; ++a)
+                {
+                    values[c][a] = ct[a] * angles[c];
+                    values[c][a + 3] = cb[a] * angles[c];
+                }
+            }
+            return true;
+        }, pool);
+
+        _normalRun(pool, vertexCount, [&](size_t begin, size_t end) {
+            for (size_t v = begin; v < end; ++v)
+            {
+                const size_t source = remap != nullptr && remap[v] < vertexCount ? remap[v] : v;
+                const float *sum = &sums[source * 6];
+                const float *n = _normalAt(normals, normalStride, v);
+                float tangent[4];
+                const float d = _normalDot(n, sum);
+                for (size_t a = 0; a < 3; ++a) tangent[a] = sum[a] - (n[a] * d);
+                if (!_normalize(tangent))
+                {
+                    // no uvs to go by, any direction on the tangent plane will do
+                    const float axis[3] = {std::fabs(n[0]) < 0.9f ? 1.0f : 0.0f, std::fabs(n[0]) < 0.9f ? 0.0f : 1.0f, 0.0f};
+                    const float da = _normalDot(n, axis);
+                    for (size_t a = 0; a < 3; ++a) tangent[a] = axis[a] - (n[a] * da);
+                    if (!_normalize(tangent)) { tangent[0] = 1.0f; tangent[1] = 0.0f; tangent[2] = 0.0f; }
+                }
+                float cross[3];
+                _normalCross(cross, n, tangent);
+                tangent[3] = _normalDot(cross, sum + 3) < 0.0f ? -1.0f : 1.0f;
+                memcpy(_normalAt(tangents, tangentStride, v), tangent, sizeof(tangent));
+            }
+        }, 4096);
+    }
+
+    void positionRemap(uint32_t *remap, const float *positions, size_t positionStride, size_t vertexCount)
+    {
+        static const uint32_t empty = 0xFFFFFFFF;
+        // -0 and 0 are the same position, anything else is compared bitwise
+        auto key = [&](size_t v, uint32_t *bits) {
+            const float *p = _normalAt(positions, positionStride, v);
+            for (size_t a = 0; a < 3; ++a)
+            {
+                const float value = p[a] + 0.0f;
+                memcpy(&bits[a], &value, sizeof(float));
+            }
+        };
+        size_t capacity = 16;
+        while (capacity < vertexCount * 2) capacity <<= 1;
+        vector<uint32_t> table(capacity, empty);
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            uint32_t bits[3];
+            key(v, bits);
+            uint64_t h = (bits[0] * 0x9E3779B97F4A7C15ull) ^ (bits[1] * 0xC2B2AE3D27D4EB4Full) ^ (bits[2] * 0x165667B19E3779F9ull);
+            size_t slot = (h ^ (h >> 29)) & (capacity - 1);
+            for (;; slot = (slot + 1) & (capacity - 1))
+            {
+                if (table[slot] == empty)
+                {
+                    table[slot] = (uint32_t)v;
+                    remap[v] = (uint32_t)v;
+                    break;
+                }
+                uint32_t other[3];
+                key(table[slot], other);
+                if (memcmp(bits, other, sizeof(bits)) == 0)
+                {
+                    remap[v] = table[slot];
+                    break;
+                }
+            }
+        }
+    }
+}
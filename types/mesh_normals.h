@@ -0,0 +1,84 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <cstddef>
+
+#include "types/worker_pool.h"
+
+#ifndef LAK_MESH_NORMALS_H
+#define LAK_MESH_NORMALS_H
+
+namespace lak
+{
+    // how much each triangle contributes to the normal of its corners
+    enum normalWeight_t
+    {
+        NORMAL_WEIGHT_AREA,         // by triangle area, big faces dominate
+        NORMAL_WEIGHT_ANGLE,        // by the angle at the corner, independent of tessellation
+        NORMAL_WEIGHT_AREA_ANGLE,   // both, the usual choice for scanned and CAD meshes
+    };
+
+    // smooth per vertex normals for an indexed triangle list. triangles are
+    // summed into remap[vertex] (identity if null, see positionRemap), so
+    // vertices split for uv seams but mapped to the same entry still get
+    // the same normal while ones mapped apart (hard edges, smoothing groups)
+    // don't. strides are in bytes, triangles with an out of range index are
+    // ignored and vertices no triangle touches get (0, 0, 1). with a pool the
+    // triangles are binned per thread instead of summed with atomics, the
+    // sums are added in the same order either way so the result doesn't
+    // depend on the pool
+    void generateNormals(float *normals, size_t normalStride,
+        const float *positions, size_t positionStride, size_t vertexCount,
+        const uint32_t *indices, size_t indexCount, const uint32_t *remap = nullptr,
+        normalWeight_t weight = NORMAL_WEIGHT_AREA_ANGLE, workerPool_t *pool = nullptr);
+
+    // per vertex tangents (xyzw, w is the bitangent sign) for normal mapping
+    // following the MikkTSpace conventions: the uv derivatives of each
+    // triangle are projected onto the tangent plane of each corner, weighted
+    // by the corner angle, summed per remap[vertex] and orthogonalized
+    // against the vertex normal, with bitangent = w * cross(normal, tangent).
+    // MikkTSpace also splits vertices whose tangent spaces disagree, that
+    // isn't done here so mirrored uvs must already be separate vertices
+    // (as they are after indexing unique position/uv/normal corners)
+    void generateTangents(float *tangents, size_t tangentStride,
+        const float *positions, size_t positionStride,
+        const float *normals, size_t normalStride,
+        const float *texcoords, size_t texcoordStride, size_t vertexCount,
+        const uint32_t *indices, size_t indexCount, const uint32_t *remap = nullptr,
+        workerPool_t *pool = nullptr);
+
+    // remap[v] = the first vertex with bitwise the same position as v, for
+    // smoothing across seams with generateNormals
+    void positionRemap(uint32_t *remap, const float *positions, size_t positionStride, size_t vertexCount);
+}
+
+#ifdef LAK_MESH_NORMALS_IMPLEM
+#   ifndef LAK_MESH_NORMALS_HAS_IMPLEM
+#       define LAK_MESH_NORMALS_HAS_IMPLEM
+#       include "types/mesh_normals.cpp"
+#   endif // LAK_MESH_NORMALS_HAS_IMPLEM
+#endif // LAK_MESH_NORMALS_IMPLEM
+
+#endif // LAK_MESH_NORMALS_H
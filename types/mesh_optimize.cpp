@@ -0,0 +1,435 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include "types/mesh_optimize.h"
+
+namespace lak
+{
+    using std::vector;
+
+    // FIFO post transform cache, a vertex is cached if it was one of the
+    // last size vertices inserted
+    struct _vertexCache_t
+    {
+        vector<size_t> stamp;
+        size_t time;
+        size_t size;
+
+        _vertexCache_t(size_t vertexCount, size_t cacheSize) : stamp(vertexCount, 0), time(cacheSize), size(cacheSize) {}
+
+        // returns true (and inserts it) if v wasn't cached
+        inline bool miss(uint32_t v)
+        {
+            if (v >= stamp.size()) return true;
+            if (time - stamp[v] < size) return false;
+            stamp[v] = time++;
+            return true;
+        }
+
+        inline void flush() { time += size; }
+    };
+
+    vertexCacheStats_t analyzeVertexCache(const uint32_t *indices, size_t indexCount, size_t vertexCount, size_t cacheSize)
+    {
+        vertexCacheStats_t stats;
+        if (cacheSize == 0) cacheSize = 1;
+        _vertexCache_t cache(vertexCount, cacheSize);
+        vector<bool> used(vertexCount, false);
+        size_t unique = 0;
+        for (size_t i = 0; i < indexCount; ++i)
+        {
+            if (cache.miss(indices[i])) ++stats.misses;
+            if (indices[i] < vertexCount && !used[indices[i]])
+            {
+                used[indices[i]] = true;
+                ++unique;
+            }
+        }
+        if (indexCount >= 3) stats.acmr = (float)stats.misses / (float)(indexCount / 3);
+        if (unique > 0) stats.atvr = (float)stats.misses / (float)unique;
+        return stats;
+    }
+
+    void optimizeVertexCache(uint32_t *out, const uint32_t *indices, size_t indexCount, size_t vertexCount, size_t cacheSize)
+    {
+        const size_t triangleCount = indexCount / 3;
+        if (cacheSize < 3) cacheSize = 3;
+
+        // triangles using each vertex, triangles with a bad index are
+        // left out and appended at the end
+        vector<uint32_t> live(vertexCount, 0);
+        vector<bool> emitted(triangleCount, false);
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            const uint32_t *tri = &indices[t * 3];
+            if (tri[0] >= vertexCount || tri[1] >= vertexCount || tri[2] >= vertexCount) { emitted[t] = true; continue; }
+            for (size_t c = 0; c < 3; ++c) ++live[tri[c]];
+        }
+        vector<size_t> offset(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; ++v) offset[v + 1] = offset[v] + live[v];
+        vector<uint32_t> adjacency(offset[vertexCount]);
+        {
+            vector<size_t> fill(offset.begin(), offset.end() - 1);
+            for (size_t t = 0; t < triangleCount; ++t)
+                if (!emitted[t])
+                    for (size_t c = 0; c < 3; ++c) adjacency[fill[indices[(t * 3) + c]]++] = (uint32_t)t;
+        }
+
+        // cached if time - stamp < cacheSize
+        vector<size_t> stamp(vertexCount, 0);
+        size_t time = cacheSize + 1;
+        vector<uint32_t> deadEnd;
+        vector<uint32_t> candidates;
+        size_t written = 0;
+        size_t cursor = 0;
+
+        auto nextLive = [&]() -> size_t {
+            // most recently used vertices that still have triangles first,
+            // then the lowest vertex that has any
+            while (!deadEnd.empty())
+            {
+                const uint32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0) return v;
+            }
+            for (; cursor < vertexCount; ++cursor)
+                if (live[cursor] > 0) return cursor;
+            return (size_t)-1;
+        };
+
+        for (size_t fan = nextLive(); fan != (size_t)-1;)
+        {
+            candidates.clear();
+            for (size_t a = offset[fan]; a < offset[fan + 1]; ++a)
+            {
+                const uint32_t t = adjacency[a];
+                if (emitted[t]) continue;
+                emitted[t] = true;
+                for (size_t c = 0; c < 3; ++c)
+                {
+                    const uint32_t v = indices[(t * 3) + c];
+                    out[written++] = v;
+                    deadEnd.push_back(v);
+                    candidates.push_back(v);
+                    --live[v];
+                    if (time - stamp[v] > cacheSize) stamp[v] = time++;
+                }
+            }
+
+            // the candidate that will still be in the cache after its
+            // remaining triangles are emitted, preferring the oldest one
+            size_t best = (size_t)-1;
+            size_t bestPriority = 0;
+            for (const uint32_t v : candidates)
+            {
+                if (live[v] == 0) continue;
+                size_t priority = 0;
+                if (time - stamp[v] + (2 * live[v]) <= cacheSize) priority = time - stamp[v];
+                if (best == (size_t)-1 || priority > bestPriority)
+                {
+                    best = v;
+                    bestPriority = priority;
+                }
+            }
+            fan = best != (size_t)-1 ? best : nextLive();
+        }
+
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            const uint32_t *tri = &indices[t * 3];
+            if (tri[0] >= vertexCount || tri[1] >= vertexCount || tri[2] >= vertexCount)
+                for (size_t c = 0; c < 3; ++c) out[written++] = tri[c];
+        }
+    }
+
+    void optimizeOverdraw(uint32_t *out, const uint32_t *indices, size_t indexCount,
+        const float *positions, size_t vertexCount, size_t positionStride,
+        size_t cacheSize, float threshold)
+    {
+        const size_t triangleCount = indexCount / 3;
+        if (cacheSize == 0) cacheSize = 1;
+        auto position = [&](uint32_t v) { return (const float*)((const uint8_t*)positions + (v * positionStride)); };
+
+        // hard boundaries where a triangle misses on all three vertices,
+        // the cache was cold there anyway so reordering costs nothing
+        vector<size_t> hard;
+        {
+            _vertexCache_t cache(vertexCount, cacheSize);
+            for (size_t t = 0; t < triangleCount; ++t)
+            {
+                size_t misses = 0;
+                for (size_t c = 0; c < 3; ++c) misses += cache.miss(indices[(t * 3) + c]);
+                if (misses == 3 || t == 0) hard.push_back(t);
+            }
+        }
+        hard.push_back(triangleCount);
+
+        // soft boundaries wherever the part of a cluster so far has a miss
+        // ratio within threshold of the whole cluster's, the cache is then
+        // flushed to account for the cluster being drawn somewhere else
+        vector<size_t> clusters;
+        _vertexCache_t cache(vertexCount, cacheSize);
+        for (size_t h = 0; h + 1 < hard.size(); ++h)
+        {
+            const size_t begin = hard[h], end = hard[h + 1];
+            cache.flush();
+            size_t clusterMisses = 0;
+            for (size_t i = begin * 3; i < end * 3; ++i) clusterMisses += cache.miss(indices[i]);
+            const float limit = threshold * (float)clusterMisses / (float)(end - begin);
+
+            cache.flush();
+            clusters.push_back(begin);
+            size_t misses = 0, triangles = 0;
+            for (size_t t = begin; t < end; ++t)
+            {
+                for (size_t c = 0; c < 3; ++c) misses += cache.miss(indices[(t * 3) + c]);
+                ++triangles;
+                if (t + 1 < end && (float)misses <= limit * (float)triangles)
+                {
+                    clusters.push_back(t + 1);
+                    cache.flush();
+                    misses = triangles = 0;
+                }
+            }
+        }
+        clusters.push_back(triangleCount);
+
+        // area weighted centroid and normal of each cluster and the mesh
+        const size_t clusterCount = clusters.size() - 1;
+        vector<float> centroids(clusterCount * 3, 0.0f);
+        vector<float> normals(clusterCount * 3, 0.0f);
+        float meshCentroid[3] = {0.0f, 0.0f, 0.0f};
+        float meshArea = 0.0f;
+        for (size_t k = 0; k < clusterCount; ++k)
+        {
+            float *centroid = &centroids[k * 3], *normal = &normals[k * 3];
+            float area = 0.0f;
+            for (size_t t = clusters[k]; t < clusters[k + 1]; ++t)
+            {
+                const uint32_t *tri = &indices[t * 3];
+                if (tri[0] >= vertexCount || tri[1] >= vertexCount || tri[2] >= vertexCount) continue;
+                const float *p0 = position(tri[0]), *p1 = position(tri[1]), *p2 = position(tri[2]);
+                const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+                const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+                const float n[3] = {(e1[1] * e2[2]) - (e1[2] * e2[1]), (e1[2] * e2[0]) - (e1[0] * e2[2]), (e1[0] * e2[1]) - (e1[1] * e2[0])};
+                const float a = std::sqrt((n[0] * n[0]) + (n[1] * n[1]) + (n[2] * n[2]));
+                for (size_t i = 0; i < 3; ++i)
+                {
+                    centroid[i] += (p0[i] + p1[i] + p2[i]) * (a / 3.0f);
+                    normal[i] += n[i];
+                }
+                area += a;
+            }
+            for (size_t i = 0; i < 3; ++i) meshCentroid[i] += centroid[i];
+            meshArea += area;
+            if (area > 0.0f)
+                for (size_t i = 0; i < 3; ++i) centroid[i] /= area;
+        }
+        if (meshArea > 0.0f)
+            for (size_t i = 0; i < 3; ++i) meshCentroid[i] /= meshArea;
+
+        // clusters facing away from the middle are more likely to occlude
+        // the rest, so draw them first
+        vector<float> sortKey(clusterCount);
+        for (size_t k = 0; k < clusterCount; ++k)
+        {
+            const float *centroid = &centroids[k * 3], *normal = &normals[k * 3];
+            const float length = std::sqrt((normal[0] * normal[0]) + (normal[1] * normal[1]) + (normal[2] * normal[2]));
+            float key = 0.0f;
+            for (size_t i = 0; i < 3; ++i) key += (centroid[i] - meshCentroid[i]) * normal[i];
+            sortKey[k] = length > 0.0f ? key / length : 0.0f;
+        }
+        vector<uint32_t> order(clusterCount);
+        for (size_t k = 0; k < clusterCount; ++k) order[k] = (uint32_t)k;
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+        size_t written = 0;
+        for (const uint32_t k : order)
+        {
+            const size_t count = (clusters[k + 1] - clusters[k]) * 3;
+            memcpy(out + written, indices + (clusters[k] * 3), count * sizeof(uint32_t));
+            written += count;
+        }
+        // a trailing partial triangle is left where it was
+        for (size_t i = triangleCount * 3; i < indexCount; ++i) out[i] = indices[i];
+    }
+
+    size_t optimizeVertexFetch(uint32_t *remap, uint32_t *indices, size_t indexCount, size_t vertexCount)
+    {
+        static const uint32_t unused = 0xFFFFFFFF;
+        std::fill(remap, remap + vertexCount, unused);
+        uint32_t next = 0;
+        for (size_t i = 0; i < indexCount; ++i)
+        {
+            const uint32_t v = indices[i];
+            if (v >= vertexCount) continue;
+            if (remap[v] == unused) remap[v] = next++;
+            indices[i] = remap[v];
+        }
+        const size_t used = next;
+        for (size_t v = 0; v < vertexCount; ++v)
+            if (remap[v] == unused) remap[v] = next++;
+        return used;
+    }
+
+    void remapVertices(void *dst, const void *src, size_t vertexCount, size_t stride, const uint32_t *remap)
+    {
+        for (size_t v = 0; v < vertexCount; ++v)
+            memcpy((uint8_t*)dst + (remap[v] * stride), (const uint8_t*)src + (v * stride), stride);
+    }
+
+    meshOptimizeStats_t optimizeMesh(mesh_t *mesh, const drawRange_t *ranges, size_t rangeCount,
+        const char *position, size_t cacheSize, float threshold)
+    {
+        meshOptimizeStats_t stats;
+        if (mesh->drawMode != GL_TRIANGLES) return stats;
+        auto &index = mesh->index;
+        auto valid = [&](const drawRange_t &range) {
+            return range.count >= 3 && range.baseVertex >= 0 && range.firstIndex + range.count <= index.size();
+        };
+
+        // the indices of every range with its baseVertex applied
+        auto analyze = [&]() {
+            vector<uint32_t> all;
+            uint32_t vertexCount = 0;
+            for (size_t r = 0; r < rangeCount; ++r)
+            {
+                if (!valid(ranges[r])) continue;
+                for (size_t i = 0; i < (size_t)ranges[r].count; ++i)
+                {
+                    all.push_back(index[ranges[r].firstIndex + i] + (uint32_t)ranges[r].baseVertex);
+                    vertexCount = std::max(vertexCount, all.back() + 1);
+                }
+            }
+            return analyzeVertexCache(all.data(), all.size(), vertexCount, cacheSize);
+        };
+        stats.before = analyze();
+
+        vertexBuffer_t *buffer = mesh->vertArray.buffers.empty() ? nullptr : &mesh->vertArray.buffers[0];
+        const vertexElement_t *positions = nullptr;
+        if (buffer != nullptr)
+        {
+            const auto it = buffer->elements.find(position);
+            if (it != buffer->elements.end() && it->second.type == GL_FLOAT && it->second.size >= 3 &&
+                it->second.data.stride >= sizeof(float) * 3 && it->second.data.size() > 0)
+                positions = &it->second;
+        }
+
+        // each range is optimized in its own compact vertex space (first use
+        // order) so many small ranges over a big vertex buffer stay linear
+        uint32_t largest = 0;
+        for (size_t r = 0; r < rangeCount; ++r)
+            if (valid(ranges[r]))
+                for (size_t i = 0; i < (size_t)ranges[r].count; ++i)
+                    largest = std::max(largest, index[ranges[r].firstIndex + i]);
+        static const uint32_t none = 0xFFFFFFFF;
+        vector<uint32_t> localOf(rangeCount > 0 ? (size_t)largest + 1 : 0, none);
+        vector<uint32_t> globalOf, local, scratch, original;
+        vector<float> localPositions;
+
+        bool baseVertex = false;
+        for (size_t r = 0; r < rangeCount; ++r)
+        {
+            const drawRange_t &range = ranges[r];
+            if (!valid(range)) continue;
+            baseVertex |= range.baseVertex != 0;
+            uint32_t *indices = &index[range.firstIndex];
+            const size_t count = ((size_t)range.count / 3) * 3;
+
+            globalOf.clear();
+            local.resize(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                uint32_t &l = localOf[indices[i]];
+                if (l == none)
+                {
+                    l = (uint32_t)globalOf.size();
+                    globalOf.push_back(indices[i]);
+                }
+                local[i] = l;
+            }
+            const size_t vertexCount = globalOf.size();
+            for (const uint32_t v : globalOf) localOf[v] = none;
+
+            original = local;
+            scratch.resize(count);
+            optimizeVertexCache(scratch.data(), local.data(), count, vertexCount, cacheSize);
+            const size_t stride = positions != nullptr ? positions->data.stride : 0;
+            bool hasPositions = positions != nullptr;
+            for (size_t v = 0; hasPositions && v < vertexCount; ++v)
+                hasPositions = (range.baseVertex + globalOf[v] + 1) * stride <= positions->data.size();
+            if (hasPositions)
+            {
+                localPositions.resize(vertexCount * 3);
+                for (size_t v = 0; v < vertexCount; ++v)
+                    memcpy(&localPositions[v * 3], &positions->data.data[(range.baseVertex + globalOf[v]) * stride], sizeof(float) * 3);
+                optimizeOverdraw(local.data(), scratch.data(), count, localPositions.data(), vertexCount, sizeof(float) * 3, cacheSize, threshold);
+            }
+            else local = scratch;
+            // ranges that were already in a good order (strips, grids) can
+            // come out slightly worse after the overdraw pass, keep those
+            if (analyzeVertexCache(local.data(), count, vertexCount, cacheSize).misses > analyzeVertexCache(original.data(), count, vertexCount, cacheSize).misses)
+                continue;
+            for (size_t i = 0; i < count; ++i) indices[i] = globalOf[local[i]];
+        }
+
+        // vertex fetch, every element needs its data and the same vertex count
+        size_t vertexCount = (size_t)-1;
+        if (buffer != nullptr && !baseVertex)
+        {
+            for (const auto &elem : buffer->elements)
+            {
+                const size_t count = elem.second.data.stride ? elem.second.data.size() / elem.second.data.stride : 0;
+                if (count == 0 && !elem.second.active) continue;
+                if (count == 0 || (vertexCount != (size_t)-1 && count != vertexCount)) { vertexCount = 0; break; }
+                vertexCount = count;
+            }
+            for (size_t i = 0; vertexCount != (size_t)-1 && i < index.size(); ++i)
+                if (index[i] >= vertexCount) vertexCount = 0;
+        }
+        if (buffer != nullptr && !baseVertex && vertexCount != (size_t)-1 && vertexCount > 0)
+        {
+            vector<uint32_t> remap(vertexCount);
+            optimizeVertexFetch(remap.data(), index.data(), index.size(), vertexCount);
+            stride_vector reordered;
+            for (auto &elem : buffer->elements)
+            {
+                if (elem.second.data.size() == 0) continue;
+                reordered.init(elem.second.data.size(), elem.second.data.stride);
+                remapVertices(reordered.data.data(), elem.second.data.data.data(), vertexCount, elem.second.data.stride, remap.data());
+                std::swap(elem.second.data.data, reordered.data);
+                elem.second.dirty = true;
+            }
+        }
+        mesh->dirty = true;
+
+        stats.after = analyze();
+        return stats;
+    }
+}
@@ -0,0 +1,93 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <cstddef>
+
+#include "types/mesh.h"
+
+#ifndef LAK_MESH_OPTIMIZE_H
+#define LAK_MESH_OPTIMIZE_H
+
+namespace lak
+{
+    // post transform cache behaviour of an index buffer, simulated as a
+    // FIFO cache of cacheSize vertices
+    struct vertexCacheStats_t
+    {
+        size_t misses = 0;      // vertices transformed
+        float acmr = 0.0f;      // average cache miss ratio, misses per triangle (0.5 - 3)
+        float atvr = 0.0f;      // average transformed vertex ratio, misses per unique vertex (1 is ideal)
+    };
+
+    vertexCacheStats_t analyzeVertexCache(const uint32_t *indices, size_t indexCount, size_t vertexCount, size_t cacheSize = 16);
+
+    // reorders the triangles of an indexed triangle list for the post
+    // transform cache with Tipsify (Sander et al. 2007), linear time.
+    // out must have room for indexCount indices and can't alias indices
+    void optimizeVertexCache(uint32_t *out, const uint32_t *indices, size_t indexCount, size_t vertexCount, size_t cacheSize = 16);
+
+    // reorders the triangles of a cache optimized index buffer to reduce
+    // overdraw: the buffer is split into clusters where the cache is cold
+    // anyway (and further while their miss ratio stays within threshold of
+    // the cluster's) and the clusters facing away from the middle of the
+    // mesh are drawn first. out can't alias indices
+    void optimizeOverdraw(uint32_t *out, const uint32_t *indices, size_t indexCount,
+        const float *positions, size_t vertexCount, size_t positionStride,
+        size_t cacheSize = 16, float threshold = 1.05f);
+
+    // renumbers the vertices in the order indices first uses them, in place.
+    // remap[old] is set to the new index, unused vertices are moved to the
+    // end. returns the number of used vertices
+    size_t optimizeVertexFetch(uint32_t *remap, uint32_t *indices, size_t indexCount, size_t vertexCount);
+
+    // dst[remap[v]] = src[v] for vertexCount vertices of stride bytes,
+    // dst can't alias src
+    void remapVertices(void *dst, const void *src, size_t vertexCount, size_t stride, const uint32_t *remap);
+
+    struct meshOptimizeStats_t
+    {
+        vertexCacheStats_t before;
+        vertexCacheStats_t after;
+    };
+
+    // runs all three passes over mesh: the triangles of each range are
+    // reordered for the vertex cache and overdraw (using the element named
+    // position, skipped if it isn't a float vec3, ranges that come out
+    // with more cache misses are left as they were), then every element's data
+    // is reordered into first use order. the vertex pass needs the element
+    // data (before it's only in the vertex buffer) and is skipped if any
+    // range has a baseVertex. the stats cover the ranges only
+    meshOptimizeStats_t optimizeMesh(mesh_t *mesh, const drawRange_t *ranges, size_t rangeCount,
+        const char *position = "POSITION", size_t cacheSize = 16, float threshold = 1.05f);
+}
+
+#ifdef LAK_MESH_OPTIMIZE_IMPLEM
+#   ifndef LAK_MESH_OPTIMIZE_HAS_IMPLEM
+#       define LAK_MESH_OPTIMIZE_HAS_IMPLEM
+#       include "types/mesh_optimize.cpp"
+#   endif // LAK_MESH_OPTIMIZE_HAS_IMPLEM
+#endif // LAK_MESH_OPTIMIZE_IMPLEM
+
+#endif // LAK_MESH_OPTIMIZE_H
@@ -0,0 +1,360 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+#include "types/mesh_simplify.h"
+
+namespace lak
+{
+    using std::vector;
+    using std::unordered_map;
+
+    struct _quadric_t
+    {
+        // symmetric 3x3 A, vector b and constant c of (p.A.p + 2b.p + c)
+        double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+        double b0 = 0, b1 = 0, b2 = 0, c = 0, w = 0;
+
+        void addPlane(double nx, double ny, double nz, double d, double weight)
+        {
+            a00 += weight * nx * nx; a11 += weight * ny * ny; a22 += weight * nz * nz;
+            a01 += weight * nx * ny; a02 += weight * nx * nz; a12 += weight * ny * nz;
+            b0 += weight * nx * d; b1 += weight * ny * d; b2 += weight * nz * d;
+            c += weight * d * d;
+            w += weight;
+        }
+
+        void add(const _quadric_t &q)
+        {
+            a00 += q.a00; a11 += q.a11; a22 += q.a22; a01 += q.a01; a02 += q.a02; a12 += q.a12;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2; c += q.c; w += q.w;
+        }
+
+        // mean squared distance from p to the planes
+        double error(const float *p) const
+        {
+            const double x = p[0], y = p[1], z = p[2];
+            const double e =
+                (a00 * x * x) + (a11 * y * y) + (a22 * z * z) +
+                2.0 * ((a01 * x * y) + (a02 * x * z) + (a12 * y * z)) +
+                2.0 * ((b0 * x) + (b1 * y) + (b2 * z)) + c;
+            return w > 0 ? std::fabs(e) / w : 0.0;
+        }
+    };
+
+    enum : uint8_t { MANIFOLD, BORDER, LOCKED };
+
+    struct _collapse_t
+    {
+        uint32_t from;  // vertex index (not remapped)
+        uint32_t to;
+        float cost;     // position and attribute error
+        float distance; // position error alone
+    };
+
+    static inline const float *vertexAt(const float *data, size_t stride, size_t v)
+    {
+        return (const float*)((const uint8_t*)data + (v * stride));
+    }
+
+    static inline void cross(const float *a, const float *b, const float *c, float *n)
+    {
+        const float e0[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        const float e1[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        n[0] = (e0[1] * e1[2]) - (e0[2] * e1[1]);
+        n[1] = (e0[2] * e1[0]) - (e0[0] * e1[2]);
+        n[2] = (e0[0] * e1[1]) - (e0[1] * e1[0]);
+    }
+
+    static inline uint64_t edgeKey(uint32_t a, uint32_t b) { return ((uint64_t)a << 32) | b; }
+
+    float simplifyScale(const float *positions, size_t vertexCount, size_t positionStride)
+    {
+        float lo[3] = {INFINITY, INFINITY, INFINITY};
+        float hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            const float *p = vertexAt(positions, positionStride, v);
+            for (int c = 0; c < 3; ++c)
+            {
+                lo[c] = std::min(lo[c], p[c]);
+                hi[c] = std::max(hi[c], p[c]);
+            }
+        }
+        const float extent = std::max(hi[0] - lo[0], std::max(hi[1] - lo[1], hi[2] - lo[2]));
+        return extent > 0.0f ? extent : 0.0f;
+    }
+
+    size_t simplifyMesh(uint32_t *out, const uint32_t *indices, size_t indexCount,
+        const float *positions, size_t vertexCount, size_t positionStride,
+        const simplifyAttribute_t *attributes, size_t attributeCount,
+        size_t targetIndexCount, float targetError, float *error)
+    {
+        if (error) *error = 0.0f;
+        indexCount -= indexCount % 3;
+        if (out != indices) memmove(out, indices, indexCount * sizeof(uint32_t));
+        for (size_t i = 0; i < indexCount; ++i)
+            if (indices[i] >= vertexCount) return indexCount; // leave bad input alone
+        if (indexCount <= targetIndexCount || vertexCount == 0) return indexCount;
+
+        // positions normalized to the unit cube so errors are relative
+        const float scale = simplifyScale(positions, vertexCount, positionStride);
+        if (scale <= 0.0f) return indexCount;
+        vector<float> pos(vertexCount * 3);
+        {
+            float lo[3] = {INFINITY, INFINITY, INFINITY};
+            for (size_t v = 0; v < vertexCount; ++v)
+                for (int c = 0; c < 3; ++c)
+                    lo[c] = std::min(lo[c], vertexAt(positions, positionStride, v)[c]);
+            for (size_t v = 0; v < vertexCount; ++v)
+                for (int c = 0; c < 3; ++c)
+                    pos[(v * 3) + c] = (vertexAt(positions, positionStride, v)[c] - lo[c]) / scale;
+        }
+
+        // vertices with identical positions are collapsed as one (remap is
+        // the first vertex with that position)
+        vector<uint32_t> remap(vertexCount);
+        {
+            unordered_map<uint64_t, vector<uint32_t>> buckets;
+            buckets.reserve(vertexCount);
+            for (uint32_t v = 0; v < vertexCount; ++v)
+            {
+                uint32_t bits[3];
+                memcpy(bits, &pos[v * 3], sizeof(bits));
+                const uint64_t hash = (((uint64_t)bits[0] * 73856093u) ^ ((uint64_t)bits[1] * 19349663u) ^ ((uint64_t)bits[2] * 83492791u));
+                auto &bucket = buckets[hash];
+                remap[v] = v;
+                for (uint32_t other : bucket)
+                {
+                    if (memcmp(&pos[other * 3], &pos[v * 3], sizeof(float) * 3) == 0)
+                    {
+                        remap[v] = other;
+                        break;
+                    }
+                }
+                if (remap[v] == v) bucket.push_back(v);
+            }
+        }
+
+        // position error of every (remapped) vertex
+        vector<_quadric_t> quadrics(vertexCount);
+        for (size_t i = 0; i < indexCount; i += 3)
+        {
+            const float *a = &pos[remap[out[i]] * 3], *b = &pos[remap[out[i + 1]] * 3], *c = &pos[remap[out[i + 2]] * 3];
+            float n[3];
+            cross(a, b, c, n);
+            const double length = std::sqrt(((double)n[0] * n[0]) + ((double)n[1] * n[1]) + ((double)n[2] * n[2]));
+            if (length <= 0) continue;
+            const double nx = n[0] / length, ny = n[1] / length, nz = n[2] / length;
+            const double d = -((nx * a[0]) + (ny * a[1]) + (nz * a[2]));
+            const double area = length * 0.5;
+            for (int k = 0; k < 3; ++k)
+                quadrics[remap[out[i + k]]].addPlane(nx, ny, nz, d, area);
+        }
+
+        vector<uint8_t> kind(vertexCount);
+        vector<uint32_t> borderNext(vertexCount), borderPrev(vertexCount);
+        vector<uint32_t> wedges(vertexCount);
+        vector<uint32_t> adjacencyOffset(vertexCount + 1), adjacency;
+        vector<uint32_t> collapseTo(vertexCount);
+        vector<uint8_t> touched(vertexCount);
+        vector<_collapse_t> candidates;
+        unordered_map<uint64_t, uint32_t> edges;
+        float worst = 0.0f;
+        const double limit = (double)targetError * targetError;
+        bool bordersWeighted = false;
+
+        while (indexCount > targetIndexCount)
+        {
+            // classify vertices by the current topology
+            edges.clear();
+            for (size_t i = 0; i < indexCount; i += 3)
+                for (int k = 0; k < 3; ++k)
+                    ++edges[edgeKey(remap[out[i + k]], remap[out[i + ((k + 1) % 3)]])];
+
+            std::fill(kind.begin(), kind.end(), MANIFOLD);
+            std::fill(wedges.begin(), wedges.end(), 0);
+            std::fill(borderNext.begin(), borderNext.end(), (uint32_t)-1);
+            std::fill(borderPrev.begin(), borderPrev.end(), (uint32_t)-1);
+            {
+                // count the distinct vertices that share each position
+                vector<uint8_t> seen(vertexCount, 0);
+                for (size_t i = 0; i < indexCount; ++i)
+                {
+                    if (seen[out[i]]) continue;
+                    seen[out[i]] = 1;
+                    ++wedges[remap[out[i]]];
+                }
+            }
+            for (const auto &[key, count] : edges)
+            {
+                const uint32_t a = (uint32_t)(key >> 32), b = (uint32_t)key;
+                if (count > 1) { kind[a] = kind[b] = LOCKED; continue; }    // non-manifold
+                if (edges.count(edgeKey(b, a))) continue;
+                // open border edge a -> b
+                if (borderNext[a] != (uint32_t)-1 || borderPrev[b] != (uint32_t)-1) kind[a] = kind[b] = LOCKED;
+                borderNext[a] = b;
+                borderPrev[b] = a;
+                if (kind[a] != LOCKED) kind[a] = BORDER;
+                if (kind[b] != LOCKED) kind[b] = BORDER;
+            }
+            for (size_t v = 0; v < vertexCount; ++v)
+                if (wedges[v] > 1 || (kind[v] == BORDER && (borderNext[v] == (uint32_t)-1 || borderPrev[v] == (uint32_t)-1)))
+                    kind[v] = LOCKED;
+
+            // keep open borders in place by adding planes perpendicular to them
+            if (!bordersWeighted)
+            {
+                bordersWeighted = true;
+                for (size_t i = 0; i < indexCount; i += 3)
+                {
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        const uint32_t a = remap[out[i + k]], b = remap[out[i + ((k + 1) % 3)]], c = remap[out[i + ((k + 2) % 3)]];
+                        if (borderNext[a] != b) continue;
+                        const float *pa = &pos[a * 3], *pb = &pos[b * 3], *pc = &pos[c * 3];
+                        float n[3];
+                        cross(pa, pb, pc, n);
+                        const double e[3] = {(double)pb[0] - pa[0], (double)pb[1] - pa[1], (double)pb[2] - pa[2]};
+                        // plane through the edge, perpendicular to the triangle
+                        double p[3] = {(e[1] * n[2]) - (e[2] * n[1]), (e[2] * n[0]) - (e[0] * n[2]), (e[0] * n[1]) - (e[1] * n[0])};
+                        const double length = std::sqrt((p[0] * p[0]) + (p[1] * p[1]) + (p[2] * p[2]));
+                        if (length <= 0) continue;
+                        p[0] /= length; p[1] /= length; p[2] /= length;
+                        const double d = -((p[0] * pa[0]) + (p[1] * pa[1]) + (p[2] * pa[2]));
+                        const double weight = std::sqrt((e[0] * e[0]) + (e[1] * e[1]) + (e[2] * e[2])) * 10.0;
+                        quadrics[a].addPlane(p[0], p[1], p[2], d, weight);
+                        quadrics[b].addPlane(p[0], p[1], p[2], d, weight);
+                    }
+                }
+            }
+
+            // triangles around each remapped vertex
+            std::fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+            for (size_t i = 0; i < indexCount; ++i)
+                ++adjacencyOffset[remap[out[i]] + 1];
+            for (size_t v = 0; v < vertexCount; ++v)
+                adjacencyOffset[v + 1] += adjacencyOffset[v];
+            adjacency.resize(indexCount);
+            {
+                vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+                for (size_t i = 0; i < indexCount; ++i)
+                    adjacency[fill[remap[out[i]]]++] = (uint32_t)(i / 3);
+            }
+
+            // every allowed collapse along a triangle edge, cheapest first
+            candidates.clear();
+            for (size_t i = 0; i < indexCount; i += 3)
+            {
+                for (int k = 0; k < 6; ++k)
+                {
+                    const uint32_t from = out[i + (k % 3)];
+                    const uint32_t to = out[i + ((k / 3) == 0 ? ((k + 1) % 3) : ((k + 2) % 3))];
+                    const uint32_t rf = remap[from], rt = remap[to];
+                    if (rf == rt || kind[rf] == LOCKED) continue;
+                    if (kind[rf] == BORDER && borderNext[rf] != rt && borderPrev[rf] != rt) continue;
+                    const double distance = quadrics[rf].error(&pos[rt * 3]);
+                    double cost = distance;
+                    for (size_t a = 0; a < attributeCount; ++a)
+                    {
+                        const float *x = vertexAt(attributes[a].data, attributes[a].stride, from);
+                        const float *y = vertexAt(attributes[a].data, attributes[a].stride, to);
+                        double d = 0;
+                        for (size_t c = 0; c < attributes[a].components; ++c)
+                            d += ((double)x[c] - y[c]) * ((double)x[c] - y[c]);
+                        cost += d * attributes[a].weight;
+                    }
+                    candidates.push_back({from, to, (float)cost, (float)distance});
+                }
+            }
+            std::sort(candidates.begin(), candidates.end(), [](const _collapse_t &a, const _collapse_t &b) { return a.cost < b.cost; });
+
+            // collapse as many independent edges as needed this pass
+            std::fill(touched.begin(), touched.end(), 0);
+            for (size_t v = 0; v < vertexCount; ++v) collapseTo[v] = (uint32_t)v;
+            const size_t trianglesNeeded = (indexCount - targetIndexCount + 2) / 3;
+            size_t removed = 0;
+            size_t collapses = 0;
+            for (const _collapse_t &collapse : candidates)
+            {
+                if (removed >= trianglesNeeded || collapse.cost > limit) break;
+                const uint32_t rf = remap[collapse.from], rt = remap[collapse.to];
+                if (touched[rf] || touched[rt]) continue;
+
+                // reject collapses that would flip a triangle
+                bool flips = false;
+                size_t dropped = 0;
+                for (uint32_t a = adjacencyOffset[rf]; a < adjacencyOffset[rf + 1] && !flips; ++a)
+                {
+                    const uint32_t *tri = &out[adjacency[a] * 3];
+                    const uint32_t r[3] = {remap[tri[0]], remap[tri[1]], remap[tri[2]]};
+                    if (r[0] == rt || r[1] == rt || r[2] == rt) { ++dropped; continue; }
+                    const float *p[3], *q[3];
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        p[k] = &pos[r[k] * 3];
+                        q[k] = r[k] == rf ? &pos[rt * 3] : p[k];
+                    }
+                    float before[3], after[3];
+                    cross(p[0], p[1], p[2], before);
+                    cross(q[0], q[1], q[2], after);
+                    const float dot = (before[0] * after[0]) + (before[1] * after[1]) + (before[2] * after[2]);
+                    if (dot <= 0.0f) flips = true;
+                }
+                if (flips) continue;
+
+                collapseTo[collapse.from] = collapse.to;
+                quadrics[rt].add(quadrics[rf]);
+                worst = std::max(worst, collapse.distance);
+                removed += dropped;
+                ++collapses;
+                // the neighbourhood changed, leave it alone until the next pass
+                for (uint32_t a = adjacencyOffset[rf]; a < adjacencyOffset[rf + 1]; ++a)
+                    for (int k = 0; k < 3; ++k)
+                        touched[remap[out[(adjacency[a] * 3) + k]]] = 1;
+            }
+            if (collapses == 0) break;
+
+            // apply and drop the triangles that became degenerate
+            size_t write = 0;
+            for (size_t i = 0; i < indexCount; i += 3)
+            {
+                const uint32_t a = collapseTo[out[i]], b = collapseTo[out[i + 1]], c = collapseTo[out[i + 2]];
+                if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c]) continue;
+                out[write++] = a;
+                out[write++] = b;
+                out[write++] = c;
+            }
+            indexCount = write;
+        }
+
+        if (error) *error = std::sqrt(worst);
+        return indexCount;
+    }
+}
@@ -0,0 +1,70 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <cstddef>
+
+#ifndef LAK_MESH_SIMPLIFY_H
+#define LAK_MESH_SIMPLIFY_H
+
+namespace lak
+{
+    // extra per vertex floats the simplifier tries to preserve (normals, uvs)
+    struct simplifyAttribute_t
+    {
+        const float *data = nullptr;
+        size_t stride = 0;      // bytes between vertices
+        size_t components = 0;  // up to 4
+        float weight = 1.0f;    // relative to the (normalized) position error
+    };
+
+    // simplifies an indexed triangle list with quadric error metrics by
+    // collapsing edges onto existing vertices, so the result still indexes
+    // the original vertex buffer. stops once at most targetIndexCount
+    // indices remain or when the next collapse would cost more than
+    // targetError (relative to the bounding box of the vertexCount vertices
+    // passed, so don't pass more than the indices use, 0.01 = 1%, attribute
+    // differences are added to it scaled by their weight). vertices on open
+    // borders only slide along the border and vertices shared by several
+    // positions-equal vertices (uv/normal seams) are kept.
+    // out must have room for indexCount indices (it may alias indices).
+    // returns the number of indices written, error (if not null) is set to
+    // the largest relative distance any collapse moved the surface by
+    size_t simplifyMesh(uint32_t *out, const uint32_t *indices, size_t indexCount,
+        const float *positions, size_t vertexCount, size_t positionStride,
+        const simplifyAttribute_t *attributes, size_t attributeCount,
+        size_t targetIndexCount, float targetError, float *error = nullptr);
+
+    // the size relative errors are measured against (largest bounding box axis)
+    float simplifyScale(const float *positions, size_t vertexCount, size_t positionStride);
+}
+
+#ifdef LAK_MESH_SIMPLIFY_IMPLEM
+#   ifndef LAK_MESH_SIMPLIFY_HAS_IMPLEM
+#       define LAK_MESH_SIMPLIFY_HAS_IMPLEM
+#       include "types/mesh_simplify.cpp"
+#   endif // LAK_MESH_SIMPLIFY_HAS_IMPLEM
+#endif // LAK_MESH_SIMPLIFY_IMPLEM
+
+#endif // LAK_MESH_SIMPLIFY_H
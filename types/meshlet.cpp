@@ -0,0 +1,346 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include "types/meshlet.h"
+
+namespace lak
+{
+    using std::vector;
+
+    static inline const float *meshletPosition(const float *positions, size_t stride, uint32_t v)
+    {
+        return (const float*)((const uint8_t*)positions + (v * stride));
+    }
+
+    // bounding sphere and normal cone of triangles [begin, end) of indices
+    static void meshletBounds(meshlet_t *meshlet, const uint32_t *indices, size_t begin, size_t end,
+        const float *positions, size_t stride, const vector<float> &normals)
+    {
+        float lo[3] = {1e30f, 1e30f, 1e30f}, hi[3] = {-1e30f, -1e30f, -1e30f};
+        for (size_t i = begin * 3; i < end * 3; ++i)
+        {
+            const float *p = meshletPosition(positions, stride, indices[i]);
+            for (size_t a = 0; a < 3; ++a)
+            {
+                lo[a] = std::min(lo[a], p[a]);
+                hi[a] = std::max(hi[a], p[a]);
+            }
+        }
+        for (size_t a = 0; a < 3; ++a) meshlet->center[a] = (lo[a] + hi[a]) * 0.5f;
+        float radius = 0.0f;
+        for (size_t i = begin * 3; i < end * 3; ++i)
+        {
+            const float *p = meshletPosition(positions, stride, indices[i]);
+            const float d[3] = {p[0] - meshlet->center[0], p[1] - meshlet->center[1], p[2] - meshlet->center[2]};
+            radius = std::max(radius, (d[0] * d[0]) + (d[1] * d[1]) + (d[2] * d[2]));
+        }
+        meshlet->radius = std::sqrt(radius);
+
+        float axis[3] = {0.0f, 0.0f, 0.0f};
+        for (size_t t = begin; t < end; ++t)
+            for (size_t a = 0; a < 3; ++a) axis[a] += normals[(t * 3) + a];
+        const float length = std::sqrt((axis[0] * axis[0]) + (axis[1] * axis[1]) + (axis[2] * axis[2]));
+        meshlet->coneCutoff = 1.0f;
+        memcpy(meshlet->coneApex, meshlet->center, sizeof(meshlet->coneApex));
+        if (!(length > 0.0f)) return;
+        for (size_t a = 0; a < 3; ++a) meshlet->coneAxis[a] = axis[a] / length;
+
+        float minDot = 1.0f;
+        for (size_t t = begin; t < end; ++t)
+        {
+            const float *n = &normals[t * 3];
+            if (n[0] == 0.0f && n[1] == 0.0f && n[2] == 0.0f) continue;
+            minDot = std::min(minDot, (n[0] * meshlet->coneAxis[0]) + (n[1] * meshlet->coneAxis[1]) + (n[2] * meshlet->coneAxis[2]));
+        }
+        // wider than ~84 degrees either way, culling would almost never hit
+        if (minDot <= 0.1f) return;
+
+        // move the apex back far enough that every triangle's plane is in
+        // front of it, so the cone test holds for eyes close to the meshlet
+        float maxT = 0.0f;
+        for (size_t t = begin; t < end; ++t)
+        {
+            const float *n = &normals[t * 3];
+            if (n[0] == 0.0f && n[1] == 0.0f && n[2] == 0.0f) continue;
+            const float *p = meshletPosition(positions, stride, indices[t * 3]);
+            const float dc = ((meshlet->center[0] - p[0]) * n[0]) + ((meshlet->center[1] - p[1]) * n[1]) + ((meshlet->center[2] - p[2]) * n[2]);
+            const float dn = (meshlet->coneAxis[0] * n[0]) + (meshlet->coneAxis[1] * n[1]) + (meshlet->coneAxis[2] * n[2]);
+            maxT = std::max(maxT, dc / dn);
+        }
+        for (size_t a = 0; a < 3; ++a) meshlet->coneApex[a] = meshlet->center[a] - (meshlet->coneAxis[a] * maxT);
+        meshlet->coneCutoff = std::sqrt(1.0f - (minDot * minDot));
+    }
+
+    size_t buildMeshlets(vector<meshlet_t> *out, uint32_t *indices, size_t indexCount,
+        const float *positions, size_t vertexCount, size_t positionStride,
+        size_t maxVertices, size_t maxTriangles, float coneWeight)
+    {
+        const size_t triangleCount = indexCount / 3;
+        const size_t first = out->size();
+        if (maxVertices < 3) maxVertices = 3;
+        if (maxTriangles < 1) maxTriangles = 1;
+
+        // unit normal per triangle (zero if degenerate), triangles with a
+        // bad index are marked done up front
+        vector<float> normals(triangleCount * 3, 0.0f);
+        vector<bool> done(triangleCount, false);
+        vector<uint32_t> live(vertexCount, 0);
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            const uint32_t *tri = &indices[t * 3];
+            if (tri[0] >= vertexCount || tri[1] >= vertexCount || tri[2] >= vertexCount) { done[t] = true; continue; }
+            for (size_t c = 0; c < 3; ++c) ++live[tri[c]];
+            const float *p0 = meshletPosition(positions, positionStride, tri[0]);
+            const float *p1 = meshletPosition(positions, positionStride, tri[1]);
+            const float *p2 = meshletPosition(positions, positionStride, tri[2]);
+            const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            float *n = &normals[t * 3];
+            n[0] = (e1[1] * e2[2]) - (e1[2] * e2[1]);
+            n[1] = (e1[2] * e2[0]) - (e1[0] * e2[2]);
+            n[2] = (e1[0] * e2[1]) - (e1[1] * e2[0]);
+            const float length = std::sqrt((n[0] * n[0]) + (n[1] * n[1]) + (n[2] * n[2]));
+            if (length > 0.0f) { n[0] /= length; n[1] /= length; n[2] /= length; }
+            else n[0] = n[1] = n[2] = 0.0f;
+        }
+        vector<size_t> offset(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; ++v) offset[v + 1] = offset[v] + live[v];
+        vector<uint32_t> adjacency(offset[vertexCount]);
+        {
+            vector<size_t> fill(offset.begin(), offset.end() - 1);
+            for (size_t t = 0; t < triangleCount; ++t)
+                if (!done[t])
+                    for (size_t c = 0; c < 3; ++c) adjacency[fill[indices[(t * 3) + c]]++] = (uint32_t)t;
+        }
+
+        vector<uint32_t> order;         // triangles in meshlet order
+        order.reserve(triangleCount);
+        vector<size_t> starts;          // first position in order of each meshlet
+        vector<uint32_t> owner(vertexCount, 0xFFFFFFFF);   // meshlet a vertex was last added to
+        vector<uint32_t> vertices;      // of the current meshlet
+        vector<size_t> vertexCounts;
+        float axis[3] = {0.0f, 0.0f, 0.0f};
+        size_t cursor = 0;
+        uint32_t id = 0;
+
+        auto finish = [&]() {
+            if (starts.empty() || starts.back() == order.size()) return;
+            vertexCounts.push_back(vertices.size());
+            vertices.clear();
+            axis[0] = axis[1] = axis[2] = 0.0f;
+            ++id;
+        };
+        for (;;)
+        {
+            size_t next = (size_t)-1;
+            if (!vertices.empty())
+            {
+                // neighbour needing the fewest new vertices, then the one
+                // closest to the meshlet's average normal
+                const float length = std::sqrt((axis[0] * axis[0]) + (axis[1] * axis[1]) + (axis[2] * axis[2]));
+                float bestScore = 0.0f;
+                size_t bestExtra = 0;
+                for (const uint32_t v : vertices)
+                {
+                    if (live[v] == 0) continue;
+                    for (size_t a = offset[v]; a < offset[v + 1]; ++a)
+                    {
+                        const uint32_t t = adjacency[a];
+                        if (done[t]) continue;
+                        size_t extra = 0;
+                        for (size_t c = 0; c < 3; ++c) extra += owner[indices[(t * 3) + c]] != id;
+                        const float *n = &normals[t * 3];
+                        const float spread = length > 0.0f ? 1.0f - (((n[0] * axis[0]) + (n[1] * axis[1]) + (n[2] * axis[2])) / length) : 0.0f;
+                        const float score = (float)extra + (coneWeight * spread);
+                        if (next == (size_t)-1 || score < bestScore)
+                        {
+                            next = t;
+                            bestScore = score;
+                            bestExtra = extra;
+                        }
+                    }
+                }
+                if (next != (size_t)-1 && vertices.size() + bestExtra > maxVertices) next = (size_t)-1;
+                if (next == (size_t)-1) finish();
+            }
+            if (next == (size_t)-1)
+            {
+                // start a new meshlet from the first triangle left
+                while (cursor < triangleCount && done[cursor]) ++cursor;
+                if (cursor == triangleCount) break;
+                next = cursor;
+                starts.push_back(order.size());
+            }
+
+            done[next] = true;
+            order.push_back((uint32_t)next);
+            for (size_t c = 0; c < 3; ++c)
+            {
+                const uint32_t v = indices[(next * 3) + c];
+                --live[v];
+                if (owner[v] != id)
+                {
+                    owner[v] = id;
+                    vertices.push_back(v);
+                }
+            }
+            for (size_t a = 0; a < 3; ++a) axis[a] += normals[(next * 3) + a];
+            if (order.size() - starts.back() == maxTriangles) finish();
+        }
+        finish();
+        const size_t meshletCount = starts.size();
+        starts.push_back(order.size());
+
+        // anything left over had a bad index
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            const uint32_t *tri = &indices[t * 3];
+            if (tri[0] >= vertexCount || tri[1] >= vertexCount || tri[2] >= vertexCount) order.push_back((uint32_t)t);
+        }
+        vector<uint32_t> reordered(order.size() * 3);
+        vector<float> orderedNormals(order.size() * 3);
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            memcpy(&reordered[i * 3], &indices[order[i] * 3], sizeof(uint32_t) * 3);
+            memcpy(&orderedNormals[i * 3], &normals[order[i] * 3], sizeof(float) * 3);
+        }
+        memcpy(indices, reordered.data(), reordered.size() * sizeof(uint32_t));
+
+        out->resize(first + meshletCount);
+        for (size_t m = 0; m < meshletCount; ++m)
+        {
+            meshlet_t &meshlet = (*out)[first + m];
+            meshlet = meshlet_t();
+            meshlet.range.firstIndex = starts[m] * 3;
+            meshlet.range.count = (GLsizei)((starts[m + 1] - starts[m]) * 3);
+            meshlet.vertexCount = vertexCounts[m];
+            meshletBounds(&meshlet, indices, starts[m], starts[m + 1], positions, positionStride, orderedNormals);
+        }
+        return meshletCount;
+    }
+
+    void buildMeshMeshlets(mesh_t *mesh, const drawRange_t *ranges, size_t rangeCount,
+        vector<vector<meshlet_t>> *out, const char *position,
+        size_t maxVertices, size_t maxTriangles, float coneWeight)
+    {
+        out->clear();
+        out->resize(rangeCount);
+        if (mesh->drawMode != GL_TRIANGLES || mesh->vertArray.buffers.empty()) return;
+        const auto &elements = mesh->vertArray.buffers[0].elements;
+        const auto it = elements.find(position);
+        if (it == elements.end() || it->second.type != GL_FLOAT || it->second.size < 3) return;
+        const stride_vector &data = it->second.data;
+        if (data.stride < sizeof(float) * 3 || data.size() == 0) return;
+        const size_t vertexTotal = data.size() / data.stride;
+
+        // each range is built in its own compact vertex space (first use
+        // order) so many small ranges over a big vertex buffer stay linear.
+        // out of range indices are numbered past the used vertices so
+        // buildMeshlets still sets them aside
+        static const uint32_t none = 0xFFFFFFFF;
+        vector<uint32_t> localOf(vertexTotal, none);
+        vector<uint32_t> globalOf, bad, local;
+        vector<float> localPositions;
+        for (size_t r = 0; r < rangeCount; ++r)
+        {
+            const drawRange_t &range = ranges[r];
+            if (range.baseVertex < 0 || (size_t)range.baseVertex >= vertexTotal) continue;
+            if (range.firstIndex + range.count > mesh->index.size()) continue;
+            uint32_t *indices = &mesh->index[range.firstIndex];
+            const size_t available = vertexTotal - range.baseVertex;
+
+            globalOf.clear();
+            bad.clear();
+            local.resize(range.count);
+            for (size_t i = 0; i < (size_t)range.count; ++i)
+            {
+                if (indices[i] >= available) continue;
+                uint32_t &l = localOf[indices[i]];
+                if (l == none)
+                {
+                    l = (uint32_t)globalOf.size();
+                    globalOf.push_back(indices[i]);
+                }
+                local[i] = l;
+            }
+            for (size_t i = 0; i < (size_t)range.count; ++i)
+            {
+                if (indices[i] < available) continue;
+                local[i] = (uint32_t)(globalOf.size() + bad.size());
+                bad.push_back(indices[i]);
+            }
+            for (const uint32_t v : globalOf) localOf[v] = none;
+
+            localPositions.resize(globalOf.size() * 3);
+            for (size_t v = 0; v < globalOf.size(); ++v)
+                memcpy(&localPositions[v * 3], &data.data[(range.baseVertex + globalOf[v]) * data.stride], sizeof(float) * 3);
+            buildMeshlets(&(*out)[r], local.data(), local.size(), localPositions.data(), globalOf.size(), sizeof(float) * 3,
+                maxVertices, maxTriangles, coneWeight);
+            for (size_t i = 0; i < (size_t)range.count; ++i)
+                indices[i] = local[i] < globalOf.size() ? globalOf[local[i]] : bad[local[i] - globalOf.size()];
+            for (auto &meshlet : (*out)[r])
+            {
+                meshlet.range.firstIndex += range.firstIndex;
+                meshlet.range.baseVertex = range.baseVertex;
+            }
+        }
+        mesh->dirty = true;
+    }
+
+    bool cullMeshlet(const meshlet_t &meshlet, const frustum_t &frustum, const float *eye)
+    {
+        // the planes aren't normalized, scale the radius instead
+        for (size_t p = 0; p < 6; ++p)
+        {
+            const float distance = (frustum.a[p] * meshlet.center[0]) + (frustum.b[p] * meshlet.center[1]) + (frustum.c[p] * meshlet.center[2]) + frustum.d[p];
+            const float length = std::sqrt((frustum.a[p] * frustum.a[p]) + (frustum.b[p] * frustum.b[p]) + (frustum.c[p] * frustum.c[p]));
+            if (distance < -meshlet.radius * length) return true;
+        }
+        if (meshlet.coneCutoff >= 1.0f) return false;
+        const float d[3] = {meshlet.coneApex[0] - eye[0], meshlet.coneApex[1] - eye[1], meshlet.coneApex[2] - eye[2]};
+        const float length = std::sqrt((d[0] * d[0]) + (d[1] * d[1]) + (d[2] * d[2]));
+        const float facing = (d[0] * meshlet.coneAxis[0]) + (d[1] * meshlet.coneAxis[1]) + (d[2] * meshlet.coneAxis[2]);
+        return facing >= meshlet.coneCutoff * length;
+    }
+
+    void cullMeshlets(const meshlet_t *meshlets, size_t count, const frustum_t &frustum, const float *eye, vector<drawRange_t> *visible)
+    {
+        bool extend = false;
+        for (size_t m = 0; m < count; ++m)
+        {
+            const meshlet_t &meshlet = meshlets[m];
+            if (cullMeshlet(meshlet, frustum, eye)) { extend = false; continue; }
+            if (extend && visible->back().baseVertex == meshlet.range.baseVertex &&
+                visible->back().firstIndex + visible->back().count == meshlet.range.firstIndex)
+                visible->back().count += meshlet.range.count;
+            else visible->push_back(meshlet.range);
+            extend = true;
+        }
+    }
+}
@@ -0,0 +1,94 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+#include "types/mesh.h"
+#include "types/scene_bounds.h"
+
+#ifndef LAK_MESHLET_H
+#define LAK_MESHLET_H
+
+namespace lak
+{
+    using std::vector;
+
+    // a small cluster of triangles that is culled as a whole. bounds are in
+    // the space of the vertex positions it was built from
+    struct meshlet_t
+    {
+        drawRange_t range;          // its triangles, contiguous in the index buffer
+        size_t vertexCount = 0;     // unique vertices used
+        float center[3] = {0.0f, 0.0f, 0.0f};
+        float radius = 0.0f;
+        // normal cone, every triangle faces away from eye if
+        // dot(normalize(coneApex - eye), coneAxis) >= coneCutoff.
+        // coneCutoff is 1 when the normals are spread too far to ever cull
+        float coneApex[3] = {0.0f, 0.0f, 0.0f};
+        float coneAxis[3] = {0.0f, 0.0f, 0.0f};
+        float coneCutoff = 1.0f;
+    };
+
+    // splits an indexed triangle list into meshlets of at most maxVertices
+    // unique vertices and maxTriangles triangles, reordering the triangles
+    // of indices in place so each meshlet is one range (firstIndex is
+    // relative to indices). meshlets are grown greedily from the input
+    // order (run optimizeVertexCache first for tighter seeds) by adding the
+    // neighbouring triangle that needs the fewest new vertices, with
+    // coneWeight favouring triangles that keep the normal cone narrow.
+    // triangles with an out of range index end up after the last meshlet
+    // and aren't part of any. returns the number of meshlets appended to out
+    size_t buildMeshlets(vector<meshlet_t> *out, uint32_t *indices, size_t indexCount,
+        const float *positions, size_t vertexCount, size_t positionStride,
+        size_t maxVertices = 64, size_t maxTriangles = 124, float coneWeight = 0.25f);
+
+    // buildMeshlets for every range of mesh using the element named position
+    // (which must still have its data). out[r] holds the meshlets of
+    // ranges[r] with firstIndex and baseVertex matching mesh->index, so they
+    // can be drawn with mesh_t::draw (either with ranges or, after setting
+    // mesh->indexCount, with an index offset of firstIndex * sizeof(GLuint))
+    void buildMeshMeshlets(mesh_t *mesh, const drawRange_t *ranges, size_t rangeCount,
+        vector<vector<meshlet_t>> *out, const char *position = "POSITION",
+        size_t maxVertices = 64, size_t maxTriangles = 124, float coneWeight = 0.25f);
+
+    // true if the meshlet can't be seen: outside frustum or facing away from
+    // eye. both must be in the meshlet's space (a frustum made from
+    // projection * view * model and the camera position in model space)
+    bool cullMeshlet(const meshlet_t &meshlet, const frustum_t &frustum, const float *eye);
+
+    // appends the ranges of the meshlets that survive cullMeshlet to
+    // visible, merging meshlets that follow each other in the index buffer
+    void cullMeshlets(const meshlet_t *meshlets, size_t count, const frustum_t &frustum, const float *eye, vector<drawRange_t> *visible);
+}
+
+#ifdef LAK_MESHLET_IMPLEM
+#   ifndef LAK_MESHLET_HAS_IMPLEM
+#       define LAK_MESHLET_HAS_IMPLEM
+#       include "types/meshlet.cpp"
+#   endif // LAK_MESHLET_HAS_IMPLEM
+#endif // LAK_MESHLET_IMPLEM
+
+#endif // LAK_MESHLET_H
@@ -0,0 +1,444 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cmath>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
+#include "types/meshopt.h"
+
+namespace lak
+{
+    using std::memcpy;
+    using std::memset;
+
+    //
+    // vertex codec
+    //
+
+    // each group of 16 bytes is stored with 0, 2, 4 or 8 bits per byte, values
+    // that don't fit in 2/4 bits are stored as whole bytes after the group
+    static const uint8_t *decodeBytesGroup(const uint8_t *data, uint8_t *buffer, int bitslog2)
+    {
+        switch (bitslog2)
+        {
+            case 0:
+                memset(buffer, 0, 16);
+                return data;
+            case 1:
+            case 2:
+            {
+                const unsigned bits = bitslog2 == 1 ? 2 : 4;
+                const unsigned sentinel = (1u << bits) - 1;
+                const uint8_t *extra = data + (bits * 2);
+                for (unsigned i = 0; i < 16; ++i)
+                {
+                    const unsigned enc = (data[(i * bits) / 8] >> (8 - bits - ((i * bits) % 8))) & sentinel;
+                    buffer[i] = enc == sentinel ? *extra++ : (uint8_t)enc;
+                }
+                return extra;
+            }
+            default:
+                memcpy(buffer, data, 16);
+                return data + 16;
+        }
+    }
+
+    static const uint8_t *decodeBytes(const uint8_t *data, const uint8_t *end, uint8_t *buffer, size_t size)
+    {
+        // 2 bits of header per group
+        const size_t headerSize = ((size / 16) + 3) / 4;
+        if ((size_t)(end - data) < headerSize) return nullptr;
+        const uint8_t *header = data;
+        data += headerSize;
+        for (size_t i = 0; i < size; i += 16)
+        {
+            // the largest group is 24 bytes (4 bit header + 16 bytes)
+            if ((size_t)(end - data) < 24) return nullptr;
+            const size_t group = i / 16;
+            data = decodeBytesGroup(data, buffer + i, (header[group / 4] >> ((group % 4) * 2)) & 3);
+        }
+        return data;
+    }
+
+    static inline uint8_t unzigzag8(uint8_t v)
+    {
+        return (uint8_t)(-(v & 1) ^ (v >> 1));
+    }
+
+    static const uint8_t *decodeVertexBlock(const uint8_t *data, const uint8_t *end, uint8_t *dst, size_t count, size_t stride, uint8_t *last)
+    {
+        uint8_t buffer[256];
+        const size_t aligned = (count + 15) & ~(size_t)15;
+        // every byte of the vertex is stored as its own stream of zigzag deltas
+        for (size_t k = 0; k < stride; ++k)
+        {
+            data = decodeBytes(data, end, buffer, aligned);
+            if (data == nullptr) return nullptr;
+
+            uint8_t p = last[k];
+            size_t i = 0;
+            #ifdef __SSE2__
+            const __m128i one = _mm_set1_epi8(1);
+            const __m128i low7 = _mm_set1_epi8(0x7F);
+            for (; i + 16 <= count; i += 16)
+            {
+                __m128i x = _mm_loadu_si128((const __m128i*)(buffer + i));
+                const __m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(x, one));
+                x = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(x, 1), low7), sign);
+                // prefix sum of the deltas
+                x = _mm_add_epi8(x, _mm_slli_si128(x, 1));
+                x = _mm_add_epi8(x, _mm_slli_si128(x, 2));
+                x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+                x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+                x = _mm_add_epi8(x, _mm_set1_epi8((char)p));
+                alignas(16) uint8_t v[16];
+                _mm_store_si128((__m128i*)v, x);
+                uint8_t *out = dst + (i * stride) + k;
+                for (size_t j = 0; j < 16; ++j, out += stride)
+                    *out = v[j];
+                p = v[15];
+            }
+            #endif // __SSE2__
+            for (; i < count; ++i)
+            {
+                p += unzigzag8(buffer[i]);
+                dst[(i * stride) + k] = p;
+            }
+        }
+        memcpy(last, dst + ((count - 1) * stride), stride);
+        return data;
+    }
+
+    bool decodeMeshoptVertices(uint8_t *dst, size_t count, size_t stride, const uint8_t *src, size_t size)
+    {
+        if (stride == 0 || stride > 256 || stride % 4 != 0) return false;
+        if (size < 1 + stride) return false;
+        const uint8_t *data = src;
+        const uint8_t *end = src + size;
+
+        // 0xA0 | version, only version 0 is used by glTF
+        if (*data++ != 0xA0) return false;
+
+        // the first vertex of the stream is delta'd against the tail
+        uint8_t last[256];
+        memcpy(last, end - stride, stride);
+
+        size_t blockSize = (8192 / stride) & ~(size_t)15;
+        if (blockSize > 256) blockSize = 256;
+        for (size_t offset = 0; offset < count; offset += blockSize)
+        {
+            const size_t n = count - offset < blockSize ? count - offset : blockSize;
+            data = decodeVertexBlock(data, end, dst + (offset * stride), n, stride, last);
+            if (data == nullptr) return false;
+        }
+
+        const size_t tail = stride < 32 ? 32 : stride;
+        return (size_t)(end - data) == tail;
+    }
+
+    //
+    // index codecs
+    //
+
+    static inline uint32_t decodeVByte(const uint8_t *&data)
+    {
+        const uint8_t lead = *data++;
+        if (lead < 128) return lead;
+        uint32_t result = lead & 127;
+        unsigned shift = 7;
+        for (size_t i = 0; i < 4; ++i)
+        {
+            const uint8_t group = *data++;
+            result |= (uint32_t)(group & 127) << shift;
+            shift += 7;
+            if (group < 128) break;
+        }
+        return result;
+    }
+
+    static inline uint32_t decodeIndex(const uint8_t *&data, uint32_t last)
+    {
+        const uint32_t v = decodeVByte(data);
+        return last + ((v >> 1) ^ (0u - (v & 1)));
+    }
+
+    static inline void writeIndex(uint8_t *dst, size_t i, size_t indexSize, uint32_t index)
+    {
+        if (indexSize == 2)
+        {
+            const uint16_t v = (uint16_t)index;
+            memcpy(dst + (i * 2), &v, 2);
+        }
+        else memcpy(dst + (i * 4), &index, 4);
+    }
+
+    bool decodeMeshoptTriangles(uint8_t *dst, size_t count, size_t indexSize, const uint8_t *src, size_t size)
+    {
+        if (count % 3 != 0 || (indexSize != 2 && indexSize != 4)) return false;
+        // header, one code per triangle and the 16 byte aux table
+        if (size < 1 + (count / 3) + 16) return false;
+        if ((src[0] & 0xF0) != 0xE0) return false;
+        const unsigned version = src[0] & 0x0F;
+        if (version > 1) return false;
+
+        uint32_t edges[16][2];
+        uint32_t verts[16];
+        memset(edges, -1, sizeof(edges));
+        memset(verts, -1, sizeof(verts));
+        size_t edgeOffset = 0;
+        size_t vertOffset = 0;
+        auto pushEdge = [&](uint32_t a, uint32_t b) {
+            edges[edgeOffset][0] = a;
+            edges[edgeOffset][1] = b;
+            edgeOffset = (edgeOffset + 1) & 15;
+        };
+        auto pushVert = [&](uint32_t v, bool cond = true) {
+            verts[vertOffset] = v;
+            vertOffset = (vertOffset + cond) & 15;
+        };
+
+        uint32_t next = 0;
+        uint32_t last = 0;
+        const unsigned fecmax = version >= 1 ? 13 : 15;
+
+        const uint8_t *code = src + 1;
+        const uint8_t *data = code + (count / 3);
+        // the aux table lives in the last 16 bytes
+        const uint8_t *dataEnd = src + size - 16;
+        const uint8_t *codeaux = dataEnd;
+
+        for (size_t i = 0; i < count; i += 3)
+        {
+            // a triangle reads at most 16 bytes, which the aux table covers
+            if (data > dataEnd) return false;
+            const uint8_t codetri = *code++;
+            uint32_t a, b, c;
+
+            if (codetri < 0xF0)
+            {
+                // edge from the fifo plus a vertex
+                const unsigned fe = codetri >> 4;
+                a = edges[(edgeOffset - 1 - fe) & 15][0];
+                b = edges[(edgeOffset - 1 - fe) & 15][1];
+                const unsigned fec = codetri & 15;
+                if (fec < fecmax)
+                {
+                    c = fec == 0 ? next++ : verts[(vertOffset - 1 - fec) & 15];
+                    pushVert(c, fec == 0);
+                }
+                else
+                {
+                    // 13 and 14 are -1 and +1 from the last free index (version 1)
+                    c = last = fec != 15 ? last + (fec - (fec ^ 3)) : decodeIndex(data, last);
+                    pushVert(c);
+                }
+                pushEdge(c, b);
+                pushEdge(a, c);
+            }
+            else if (codetri < 0xFE)
+            {
+                // three new/fifo vertices, codes from the aux table
+                const uint8_t aux = codeaux[codetri & 15];
+                const unsigned feb = aux >> 4;
+                const unsigned fec = aux & 15;
+                a = next++;
+                b = feb == 0 ? next++ : verts[(vertOffset - feb) & 15];
+                c = fec == 0 ? next++ : verts[(vertOffset - fec) & 15];
+                pushVert(a);
+                pushVert(b, feb == 0);
+                pushVert(c, fec == 0);
+                pushEdge(b, a);
+                pushEdge(c, b);
+                pushEdge(a, c);
+            }
+            else
+            {
+                // same as above but with a full aux byte and free indices
+                const uint8_t aux = *data++;
+                const unsigned fea = codetri == 0xFE ? 0 : 15;
+                const unsigned feb = aux >> 4;
+                const unsigned fec = aux & 15;
+                if (aux == 0) next = 0;
+                a = fea == 0 ? next++ : 0;
+                b = feb == 0 ? next++ : verts[(vertOffset - feb) & 15];
+                c = fec == 0 ? next++ : verts[(vertOffset - fec) & 15];
+                if (fea == 15) last = a = decodeIndex(data, last);
+                if (feb == 15) last = b = decodeIndex(data, last);
+                if (fec == 15) last = c = decodeIndex(data, last);
+                pushVert(a);
+                pushVert(b, feb == 0 || feb == 15);
+                pushVert(c, fec == 0 || fec == 15);
+                pushEdge(b, a);
+                pushEdge(c, b);
+                pushEdge(a, c);
+            }
+
+            writeIndex(dst, i + 0, indexSize, a);
+            writeIndex(dst, i + 1, indexSize, b);
+            writeIndex(dst, i + 2, indexSize, c);
+        }
+
+        return data == dataEnd;
+    }
+
+    bool decodeMeshoptIndices(uint8_t *dst, size_t count, size_t indexSize, const uint8_t *src, size_t size)
+    {
+        if (indexSize != 2 && indexSize != 4) return false;
+        // header, at least 1 byte per index and a 4 byte tail
+        if (size < 1 + count + 4) return false;
+        if ((src[0] & 0xF0) != 0xD0) return false;
+        if ((src[0] & 0x0F) > 1) return false;
+
+        const uint8_t *data = src + 1;
+        const uint8_t *dataEnd = src + size - 4;
+        // two baselines, the low bit of each value picks one
+        uint32_t last[2] = {0, 0};
+        for (size_t i = 0; i < count; ++i)
+        {
+            // an index reads at most 5 bytes, the tail covers the overrun
+            if (data >= dataEnd) return false;
+            uint32_t v = decodeVByte(data);
+            const uint32_t current = v & 1;
+            v >>= 1;
+            last[current] += (v >> 1) ^ (0u - (v & 1));
+            writeIndex(dst, i, indexSize, last[current]);
+        }
+        return data == dataEnd;
+    }
+
+    //
+    // filters
+    //
+
+    template<typename T>
+    static void filterOctahedral(uint8_t *data, size_t count)
+    {
+        const float maximum = (float)((1 << ((sizeof(T) * 8) - 1)) - 1);
+        for (size_t i = 0; i < count; ++i)
+        {
+            T n[4];
+            memcpy(n, data + (i * sizeof(n)), sizeof(n));
+            // z is encoded with the same bit count as 1.0
+            float x = (float)n[0];
+            float y = (float)n[1];
+            const float z = (float)n[2] - std::fabs(x) - std::fabs(y);
+            // unfold the lower hemisphere
+            const float t = z < 0.0f ? z : 0.0f;
+            x += x >= 0.0f ? t : -t;
+            y += y >= 0.0f ? t : -t;
+            const float s = maximum / std::sqrt((x * x) + (y * y) + (z * z));
+            n[0] = (T)(int)((x * s) + (x >= 0.0f ? 0.5f : -0.5f));
+            n[1] = (T)(int)((y * s) + (y >= 0.0f ? 0.5f : -0.5f));
+            n[2] = (T)(int)((z * s) + (z >= 0.0f ? 0.5f : -0.5f));
+            memcpy(data + (i * sizeof(n)), n, sizeof(n));
+        }
+    }
+
+    void meshoptFilterOctahedral(uint8_t *data, size_t count, size_t stride)
+    {
+        if (stride == 4) filterOctahedral<int8_t>(data, count);
+        else if (stride == 8) filterOctahedral<int16_t>(data, count);
+    }
+
+    void meshoptFilterQuaternion(uint8_t *data, size_t count, size_t stride)
+    {
+        if (stride != 8) return;
+        const float scale = 1.0f / std::sqrt(2.0f);
+        for (size_t i = 0; i < count; ++i)
+        {
+            int16_t q[4];
+            memcpy(q, data + (i * 8), 8);
+            // the last component holds the scale in the high bits and the
+            // index of the largest (dropped) component in the low 2
+            const float ss = scale / (float)(q[3] | 3);
+            const float x = (float)q[0] * ss;
+            const float y = (float)q[1] * ss;
+            const float z = (float)q[2] * ss;
+            const float ww = 1.0f - (x * x) - (y * y) - (z * z);
+            const float w = std::sqrt(ww >= 0.0f ? ww : 0.0f);
+            const int qc = q[3] & 3;
+            int16_t out[4];
+            out[(qc + 1) & 3] = (int16_t)(int)((x * 32767.0f) + (x >= 0.0f ? 0.5f : -0.5f));
+            out[(qc + 2) & 3] = (int16_t)(int)((y * 32767.0f) + (y >= 0.0f ? 0.5f : -0.5f));
+            out[(qc + 3) & 3] = (int16_t)(int)((z * 32767.0f) + (z >= 0.0f ? 0.5f : -0.5f));
+            out[qc] = (int16_t)(int)((w * 32767.0f) + 0.5f);
+            memcpy(data + (i * 8), out, 8);
+        }
+    }
+
+    void meshoptFilterExponential(uint8_t *data, size_t count, size_t stride)
+    {
+        if (stride % 4 != 0) return;
+        const size_t n = (count * stride) / 4;
+        size_t i = 0;
+        #ifdef __SSE2__
+        for (; i + 4 <= n; i += 4)
+        {
+            const __m128i v = _mm_loadu_si128((const __m128i*)(data + (i * 4)));
+            // 24 bit signed mantissa, 8 bit signed exponent
+            const __m128i m = _mm_srai_epi32(_mm_slli_epi32(v, 8), 8);
+            const __m128i e = _mm_srai_epi32(v, 24);
+            const __m128 p = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(e, _mm_set1_epi32(127)), 23));
+            _mm_storeu_ps((float*)(data + (i * 4)), _mm_mul_ps(p, _mm_cvtepi32_ps(m)));
+        }
+        #endif // __SSE2__
+        for (; i < n; ++i)
+        {
+            uint32_t v;
+            memcpy(&v, data + (i * 4), 4);
+            const int32_t m = (int32_t)(v << 8) >> 8;
+            const int32_t e = (int32_t)v >> 24;
+            // ldexp(m, e) without the function call
+            const uint32_t bits = (uint32_t)(e + 127) << 23;
+            float f;
+            memcpy(&f, &bits, 4);
+            f *= (float)m;
+            memcpy(data + (i * 4), &f, 4);
+        }
+    }
+
+    bool decodeMeshopt(const gltf_t::bufferView_t::extensions_t::meshopt_t &meshopt, const uint8_t *src, uint8_t *dst)
+    {
+        const size_t count = meshopt.count;
+        const size_t stride = meshopt.byteStride;
+        if (meshopt.mode == "ATTRIBUTES")
+        {
+            if (!decodeMeshoptVertices(dst, count, stride, src, meshopt.byteLength)) return false;
+            if (meshopt.filter == "OCTAHEDRAL") meshoptFilterOctahedral(dst, count, stride);
+            else if (meshopt.filter == "QUATERNION") meshoptFilterQuaternion(dst, count, stride);
+            else if (meshopt.filter == "EXPONENTIAL") meshoptFilterExponential(dst, count, stride);
+            else if (meshopt.filter != "NONE") return false;
+            return true;
+        }
+        if (meshopt.mode == "TRIANGLES")
+            return decodeMeshoptTriangles(dst, count, stride, src, meshopt.byteLength);
+        if (meshopt.mode == "INDICES")
+            return decodeMeshoptIndices(dst, count, stride, src, meshopt.byteLength);
+        return false;
+    }
+}
@@ -0,0 +1,61 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <cstddef>
+
+#include "types/gltf.h"
+
+#ifndef LAK_MESHOPT_H
+#define LAK_MESHOPT_H
+
+namespace lak
+{
+    // decoders for the meshoptimizer codecs (as used by EXT_meshopt_compression)
+    // all of them return false if src is malformed or too small
+
+    // vertex codec ("ATTRIBUTES"), stride must be a multiple of 4 and <= 256
+    bool decodeMeshoptVertices(uint8_t *dst, size_t count, size_t stride, const uint8_t *src, size_t size);
+    // triangle index codec ("TRIANGLES"), indexSize is 2 or 4 and count a multiple of 3
+    bool decodeMeshoptTriangles(uint8_t *dst, size_t count, size_t indexSize, const uint8_t *src, size_t size);
+    // index sequence codec ("INDICES"), indexSize is 2 or 4
+    bool decodeMeshoptIndices(uint8_t *dst, size_t count, size_t indexSize, const uint8_t *src, size_t size);
+
+    // in place filters, applied after decoding "ATTRIBUTES" data
+    void meshoptFilterOctahedral(uint8_t *data, size_t count, size_t stride);   // stride 4 (int8) or 8 (int16)
+    void meshoptFilterQuaternion(uint8_t *data, size_t count, size_t stride);   // stride 8 (int16)
+    void meshoptFilterExponential(uint8_t *data, size_t count, size_t stride);  // stride multiple of 4 (int32)
+
+    // decodes a compressed bufferView into dst (must hold meshopt.count * meshopt.byteStride bytes)
+    bool decodeMeshopt(const gltf_t::bufferView_t::extensions_t::meshopt_t &meshopt, const uint8_t *src, uint8_t *dst);
+}
+
+#ifdef LAK_MESHOPT_IMPLEM
+#   ifndef LAK_MESHOPT_HAS_IMPLEM
+#       define LAK_MESHOPT_HAS_IMPLEM
+#       include "types/meshopt.cpp"
+#   endif // LAK_MESHOPT_HAS_IMPLEM
+#endif // LAK_MESHOPT_IMPLEM
+
+#endif // LAK_MESHOPT_H
@@ -0,0 +1,410 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+#include "utils/ldebug.h"
+#include "types/obj_cache.h"
+
+namespace lak
+{
+    using std::ofstream;
+
+    //
+    // file layout, same conventions as the glTF cache: little endian, 16
+    // byte aligned sections and offsets from the start of the file. the
+    // vertex blob is laid out exactly as it goes into the vertex buffer
+    //
+
+    static const uint32_t objCacheMagic = 0x4F43414C; // "LACO"
+    static const uint32_t objCacheByteOrder = 0x01020304;
+
+    struct _objCacheHeader_t
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t sourceCount;
+        uint64_t fileSize;
+        uint64_t sources;       // _objCacheSource_t[sourceCount]
+        uint32_t stride;
+        uint32_t elementCount;
+        uint32_t materialCount;
+        uint32_t rangeCount;
+        uint64_t elements;      // _objCacheElement_t[elementCount]
+        uint64_t materials;     // _objCacheMaterial_t[materialCount]
+        uint64_t ranges;        // _objCacheRange_t[rangeCount]
+        uint64_t vertices;      // uint8_t[vertexBytes]
+        uint64_t vertexBytes;
+        uint64_t indices;       // GLuint[indexCount]
+        uint64_t indexCount;
+    };
+
+    struct _objCacheString_t
+    {
+        uint64_t offset;        // char[length]
+        uint64_t length;
+    };
+
+    struct _objCacheSource_t
+    {
+        _objCacheString_t path;
+        uint64_t size;
+        uint64_t modified;
+    };
+
+    struct _objCacheElement_t
+    {
+        char name[48];          // null terminated
+        uint32_t type;
+        int32_t size;
+        uint32_t offset;
+        uint32_t normalised;
+    };
+
+    struct _objCacheMaterial_t
+    {
+        // name, directory, then the ambient, diffuse, specular, emissive,
+        // alpha and bump maps
+        _objCacheString_t strings[8];
+        float ambient[3];
+        float diffuse[3];
+        float specular[3];
+        float emissive[3];
+        float shininess;
+        float opacity;
+        float ior;
+        float bumpScale;
+        int32_t illum;
+        uint32_t _pad[3];
+    };
+
+    struct _objCacheRange_t
+    {
+        uint32_t material;
+        uint32_t count;
+        uint64_t firstIndex;
+    };
+
+    // the strings of a material in _objCacheMaterial_t::strings order
+    template<typename material_t, typename string_t>
+    static void objCacheStrings(material_t &material, string_t &directory, string_t *(&out)[8])
+    {
+        string_t *strings[8] = {&material.name, &directory, &material.ambientMap, &material.diffuseMap,
+            &material.specularMap, &material.emissiveMap, &material.alphaMap, &material.bumpMap};
+        std::copy(strings, strings + 8, out);
+    }
+
+    //
+    // writing
+    //
+
+    bool writeOBJCache(const string &path, const objModel_t &model)
+    {
+        if (!model.mesh || model.mesh->vertArray.buffers.empty()) return false;
+
+        vector<uint8_t> out;
+        // appends size bytes (16 byte aligned) and returns their offset
+        auto append = [&](const void *data, size_t size) -> uint64_t {
+            out.resize((out.size() + 15) & ~(size_t)15);
+            const uint64_t offset = out.size();
+            out.resize(out.size() + size);
+            if (size > 0 && data != nullptr) memcpy(out.data() + offset, data, size);
+            return offset;
+        };
+        auto appendString = [&](const string &str) {
+            _objCacheString_t record;
+            record.offset = append(str.data(), str.size());
+            record.length = str.size();
+            return record;
+        };
+
+        const uint64_t headerOffset = append(nullptr, sizeof(_objCacheHeader_t));
+        _objCacheHeader_t header = {};
+        header.magic = objCacheMagic;
+        header.version = objCacheVersion;
+        header.byteOrder = objCacheByteOrder;
+
+        vector<_objCacheSource_t> sources(model.sources.size());
+        for (size_t s = 0; s < sources.size(); ++s)
+        {
+            if (!fileStamp(model.sources[s], &sources[s].size, &sources[s].modified)) return false;
+            sources[s].path = appendString(model.sources[s]);
+        }
+        header.sourceCount = (uint32_t)sources.size();
+        header.sources = append(sources.data(), sources.size() * sizeof(sources[0]));
+
+        // interlaced with the elements sorted by name so the layout is stable
+        const auto &elementMap = model.mesh->vertArray.buffers[0].elements;
+        vector<string> names;
+        for (const auto &elem : elementMap)
+            if (elem.second.active && elem.second.data.stride) names.push_back(elem.first);
+        std::sort(names.begin(), names.end());
+        vector<_objCacheElement_t> elements(names.size());
+        vector<stride_vector*> interleave;
+        size_t stride = 0;
+        for (size_t e = 0; e < names.size(); ++e)
+        {
+            const auto &elem = elementMap.at(names[e]);
+            if (names[e].size() >= sizeof(elements[e].name)) return false;
+            memset(&elements[e], 0, sizeof(elements[e]));
+            memcpy(elements[e].name, names[e].data(), names[e].size());
+            elements[e].type = elem.type;
+            elements[e].size = elem.size;
+            elements[e].offset = (uint32_t)stride;
+            elements[e].normalised = elem.normalised;
+            interleave.push_back(const_cast<stride_vector*>(&elem.data));
+            stride += elem.data.stride;
+        }
+        const stride_vector vertices = stride_vector::interleave(interleave);
+        header.stride = (uint32_t)stride;
+        header.elementCount = (uint32_t)elements.size();
+        header.elements = append(elements.data(), elements.size() * sizeof(elements[0]));
+        header.vertices = append(vertices.data.data(), vertices.size());
+        header.vertexBytes = vertices.size();
+        header.indices = append(model.mesh->index.data(), model.mesh->index.size() * sizeof(GLuint));
+        header.indexCount = model.mesh->index.size();
+
+        vector<_objCacheMaterial_t> materials(model.materials.size());
+        for (size_t m = 0; m < materials.size(); ++m)
+        {
+            const auto &material = model.materials[m];
+            auto &record = materials[m];
+            record = {};
+            const string directory = m < model.directories.size() ? model.directories[m] : string();
+            const string *strings[8];
+            objCacheStrings(material, directory, strings);
+            for (size_t s = 0; s < 8; ++s) record.strings[s] = appendString(*strings[s]);
+            memcpy(record.ambient, material.ambient, sizeof(record.ambient));
+            memcpy(record.diffuse, material.diffuse, sizeof(record.diffuse));
+            memcpy(record.specular, material.specular, sizeof(record.specular));
+            memcpy(record.emissive, material.emissive, sizeof(record.emissive));
+            record.shininess = material.shininess;
+            record.opacity = material.opacity;
+            record.ior = material.ior;
+            record.bumpScale = material.bumpScale;
+            record.illum = material.illum;
+        }
+        header.materialCount = (uint32_t)materials.size();
+        header.materials = append(materials.data(), materials.size() * sizeof(materials[0]));
+
+        vector<_objCacheRange_t> ranges(model.ranges.size());
+        for (size_t r = 0; r < ranges.size(); ++r)
+        {
+            ranges[r] = {};
+            ranges[r].material = (uint32_t)model.ranges[r].material;
+            ranges[r].count = (uint32_t)model.ranges[r].range.count;
+            ranges[r].firstIndex = model.ranges[r].range.firstIndex;
+        }
+        header.rangeCount = (uint32_t)ranges.size();
+        header.ranges = append(ranges.data(), ranges.size() * sizeof(ranges[0]));
+
+        header.fileSize = out.size();
+        memcpy(out.data() + headerOffset, &header, sizeof(header));
+
+        // write to a temporary file first so a failed write never looks like a valid cache
+        const string temp = path + ".tmp";
+        {
+            ofstream strm(temp, std::ios::binary | std::ios::trunc);
+            if (!strm.is_open()) return false;
+            if (!strm.write((const char*)out.data(), out.size())) return false;
+        }
+        std::remove(path.c_str());
+        return std::rename(temp.c_str(), path.c_str()) == 0;
+    }
+
+    //
+    // reading
+    //
+
+    // bounds checked pointer into the cache
+    template<typename T>
+    static const T *objCachePtr(const mappedFile_t &file, uint64_t offset, uint64_t count)
+    {
+        if (offset % alignof(T) != 0 || offset > file.size) return nullptr;
+        if (count > (file.size - offset) / sizeof(T)) return nullptr;
+        return (const T*)(file.data + offset);
+    }
+
+    static bool objCacheString(const mappedFile_t &file, const _objCacheString_t &record, string *out)
+    {
+        const char *str = objCachePtr<char>(file, record.offset, record.length);
+        if (str == nullptr && record.length > 0) return false;
+        out->assign(str, str + record.length);
+        return true;
+    }
+
+    void objCache_t::close()
+    {
+        stride = 0;
+        elements.clear();
+        vertices = nullptr;
+        vertexBytes = 0;
+        indices = nullptr;
+        indexCount = 0;
+        materials.clear();
+        directories.clear();
+        ranges.clear();
+        sources.clear();
+        file.close();
+    }
+
+    bool objCache_t::open(const string &path)
+    {
+        close();
+        if (!file.open(path)) return false;
+        auto fail = [this](const char *reason) {
+            LDEBUG("Cache miss: " << reason);
+            close();
+            return false;
+        };
+
+        const _objCacheHeader_t *header = objCachePtr<_objCacheHeader_t>(file, 0, 1);
+        if (header == nullptr || header->magic != objCacheMagic || header->byteOrder != objCacheByteOrder)
+            return fail("not a cache file");
+        if (header->version != objCacheVersion) return fail("version mismatch");
+        if (header->fileSize != file.size) return fail("truncated");
+
+        const _objCacheSource_t *sourceRecords = objCachePtr<_objCacheSource_t>(file, header->sources, header->sourceCount);
+        if (sourceRecords == nullptr) return fail("bad sources");
+        sources.resize(header->sourceCount);
+        for (size_t s = 0; s < sources.size(); ++s)
+        {
+            if (!objCacheString(file, sourceRecords[s].path, &sources[s])) return fail("bad sources");
+            uint64_t size, modified;
+            if (!fileStamp(sources[s], &size, &modified) || size != sourceRecords[s].size || modified != sourceRecords[s].modified)
+                return fail("source changed");
+        }
+
+        const _objCacheElement_t *elementRecords = objCachePtr<_objCacheElement_t>(file, header->elements, header->elementCount);
+        vertices = objCachePtr<uint8_t>(file, header->vertices, header->vertexBytes);
+        indices = objCachePtr<GLuint>(file, header->indices, header->indexCount);
+        if (elementRecords == nullptr || (vertices == nullptr && header->vertexBytes > 0) || (indices == nullptr && header->indexCount > 0))
+            return fail("bad mesh");
+        stride = header->stride;
+        vertexBytes = header->vertexBytes;
+        indexCount = header->indexCount;
+        elements.resize(header->elementCount);
+        for (size_t e = 0; e < elements.size(); ++e)
+        {
+            auto &element = elements[e];
+            element.name.assign(elementRecords[e].name, strnlen(elementRecords[e].name, sizeof(elementRecords[e].name)));
+            element.type = elementRecords[e].type;
+            element.size = elementRecords[e].size;
+            element.normalised = elementRecords[e].normalised != 0;
+            element.offset = elementRecords[e].offset;
+            if (element.offset >= stride) return fail("bad element");
+        }
+
+        const _objCacheMaterial_t *materialRecords = objCachePtr<_objCacheMaterial_t>(file, header->materials, header->materialCount);
+        if (materialRecords == nullptr) return fail("bad materials");
+        materials.resize(header->materialCount);
+        directories.resize(header->materialCount);
+        for (size_t m = 0; m < materials.size(); ++m)
+        {
+            const auto &record = materialRecords[m];
+            auto &material = materials[m];
+            string *strings[8];
+            objCacheStrings(material, directories[m], strings);
+            for (size_t s = 0; s < 8; ++s)
+                if (!objCacheString(file, record.strings[s], strings[s])) return fail("bad materials");
+            memcpy(material.ambient, record.ambient, sizeof(material.ambient));
+            memcpy(material.diffuse, record.diffuse, sizeof(material.diffuse));
+            memcpy(material.specular, record.specular, sizeof(material.specular));
+            memcpy(material.emissive, record.emissive, sizeof(material.emissive));
+            material.shininess = record.shininess;
+            material.opacity = record.opacity;
+            material.ior = record.ior;
+            material.bumpScale = record.bumpScale;
+            material.illum = record.illum;
+        }
+
+        const _objCacheRange_t *rangeRecords = objCachePtr<_objCacheRange_t>(file, header->ranges, header->rangeCount);
+        if (rangeRecords == nullptr) return fail("bad ranges");
+        ranges.resize(header->rangeCount);
+        for (size_t r = 0; r < ranges.size(); ++r)
+        {
+            const auto &record = rangeRecords[r];
+            if (record.firstIndex + record.count > indexCount || record.material >= materials.size())
+                return fail("bad range");
+            ranges[r].material = record.material;
+            ranges[r].range.count = (GLsizei)record.count;
+            ranges[r].range.firstIndex = record.firstIndex;
+        }
+
+        return true;
+    }
+
+    void objCache_t::upload(objModel_t *out, textureCache_t *cache, workerPool_t *pool) const
+    {
+        *out = {};
+        out->mesh = std::make_shared<mesh_t>();
+        out->mesh->drawMode = GL_TRIANGLES;
+        out->mesh->vertArray.buffers.resize(1);
+        auto &buffer = out->mesh->vertArray.buffers[0];
+        for (const auto &elem : elements)
+        {
+            auto &element = buffer.elements[elem.name];
+            element.type = elem.type;
+            element.size = elem.size;
+            element.normalised = elem.normalised;
+            element.offset = (GLintptr)elem.offset;
+            element.interlacedStride = stride;
+            element.active = true;
+        }
+        buffer.setInterlaced(vertices, vertexBytes);
+        out->mesh->index.assign(indices, indices + indexCount);
+        out->mesh->indexCount = indexCount;
+        out->materials = materials;
+        out->directories = directories;
+        out->ranges = ranges;
+        out->sources = sources;
+        out->textures.resize(materials.size());
+        if (cache != nullptr) loadOBJTextures(out, cache, pool);
+    }
+
+    bool loadOBJModelCached(const string &path, const string &cachePath, objModel_t *out, textureCache_t *cache, workerPool_t *pool, size_t threads)
+    {
+        {
+            objCache_t cached;
+            if (cached.open(cachePath))
+            {
+                // the first source is always the .obj itself
+                if (!cached.sources.empty() && cached.sources[0] == path)
+                {
+                    cached.upload(out, cache, pool);
+                    return true;
+                }
+                LDEBUG("Cache miss: built from another file");
+            }
+        }
+        if (!loadOBJModel(path, out, cache, pool, threads)) return false;
+        if (!writeOBJCache(cachePath, *out))
+            LERRLOG("Failed to write " << cachePath);
+        return true;
+    }
+}
@@ -0,0 +1,108 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+#ifndef LAK_GL_INCLUDE
+#define LAK_GL_INCLUDE <GL/gl3w.h>
+#endif
+#include LAK_GL_INCLUDE
+
+#include "utils/mapped_file.h"
+#include "utils/mtl.h"
+#include "types/obj_model.h"
+#include "types/texture_cache.h"
+#include "types/worker_pool.h"
+
+#ifndef LAK_OBJ_CACHE_H
+#define LAK_OBJ_CACHE_H
+
+namespace lak
+{
+    using std::vector;
+    using std::string;
+
+    // bump whenever the cache layout changes, old caches are then ignored
+    static const uint32_t objCacheVersion = 1;
+
+    struct objCacheElement_t
+    {
+        string name;
+        GLenum type = GL_FLOAT;
+        GLint size = 0;
+        bool normalised = false;
+        size_t offset = 0;          // byte offset within a vertex
+    };
+
+    // an objModel_t's mesh, materials and ranges loaded straight out of a
+    // memory mapped file. pointers are into the mapping
+    struct objCache_t
+    {
+        // readonly
+        mappedFile_t file;
+        size_t stride = 0;
+        vector<objCacheElement_t> elements;
+        const uint8_t *vertices = nullptr;  // already interlaced
+        size_t vertexBytes = 0;
+        const GLuint *indices = nullptr;
+        size_t indexCount = 0;
+        vector<objMaterial_t> materials;
+        vector<string> directories;
+        vector<objModelRange_t> ranges;
+        vector<string> sources;
+
+        // maps the cache, returns false if it's missing, corrupt, from
+        // another version, or if the size or modification time of any of the
+        // files it was built from changed (they aren't hashed, that alone
+        // would take longer than parsing a small .obj)
+        bool open(const string &path);
+        void close();
+
+        // creates out's mesh from the mapped vertices (handed to GL as they
+        // are) and loads its textures through cache (if not null), must be
+        // called from the thread that owns the GL context
+        void upload(objModel_t *out, textureCache_t *cache = nullptr, workerPool_t *pool = nullptr) const;
+    };
+
+    // writes model (as returned by loadOBJModel, before its elements are
+    // changed) to path with model.sources stamped so the cache can be
+    // invalidated when they change
+    bool writeOBJCache(const string &path, const objModel_t &model);
+
+    // opens cachePath if it's still valid for path, otherwise loads path
+    // with loadOBJModel and (re)writes cachePath. makes GL calls on a cache
+    // hit, so call it from the thread that owns the GL context
+    bool loadOBJModelCached(const string &path, const string &cachePath, objModel_t *out, textureCache_t *cache = nullptr, workerPool_t *pool = nullptr, size_t threads = 1);
+}
+
+#ifdef LAK_OBJ_CACHE_IMPLEM
+#   ifndef LAK_OBJ_CACHE_HAS_IMPLEM
+#       define LAK_OBJ_CACHE_HAS_IMPLEM
+#       include "types/obj_cache.cpp"
+#   endif // LAK_OBJ_CACHE_HAS_IMPLEM
+#endif // LAK_OBJ_CACHE_IMPLEM
+
+#endif // LAK_OBJ_CACHE_H
@@ -0,0 +1,270 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <unordered_map>
+
+#include "utils/ldebug.h"
+#include "types/obj_model.h"
+#include "types/mesh_normals.h"
+#include "types/mesh_optimize.h"
+
+namespace lak
+{
+    using std::array;
+    using std::unordered_map;
+
+    typedef objVertex_t<array<float, 3>, array<float, 2>, array<float, 3>> _objModelVertex_t;
+
+    // directory part of path including the trailing separator
+    static string directoryOf(const string &path)
+    {
+        const size_t slash = path.find_last_of("/\\");
+        return slash == string::npos ? string() : path.substr(0, slash + 1);
+    }
+
+    void objModel_t::draw()
+    {
+        if (!mesh || ranges.empty()) return;
+        vector<drawRange_t> draws(ranges.size());
+        for (size_t r = 0; r < ranges.size(); ++r) draws[r] = ranges[r].range;
+        mesh->draw(draws.data(), draws.size());
+    }
+
+    bool loadOBJModel(const string &path, objModel_t *out, textureCache_t *cache, workerPool_t *pool, size_t threads)
+    {
+        *out = {};
+        vector<array<float, 3>> positions;
+        vector<array<float, 2>> texcoords;
+        vector<array<float, 3>> normals;
+        objFaces_t faces;
+        faces.ids = true;
+        if (!readOBJ(path, &positions, &texcoords, &normals, &faces, nullptr, threads))
+        {
+            LERRLOG("Failed to open " << path);
+            return false;
+        }
+
+        // materials from every library, the first definition of a name wins
+        const string directory = directoryOf(path);
+        out->sources.push_back(path);
+        for (const auto &library : faces.libraries)
+        {
+            const string libraryPath = directory + textureCachePath(library);
+            if (readMTL(libraryPath, &out->materials)) out->sources.push_back(libraryPath);
+            else LERRLOG("Failed to open " << libraryPath);
+            // maps are relative to their .mtl
+            out->directories.resize(out->materials.size(), directoryOf(libraryPath));
+        }
+        unordered_map<string, size_t> byName;
+        for (size_t m = 0; m < out->materials.size(); ++m)
+            byName.emplace(out->materials[m].name, m);
+        const size_t fallback = out->materials.size();
+        out->materials.emplace_back();
+        out->materials.back().name = "default";
+        out->directories.push_back(directory);
+
+        vector<size_t> materialOf(faces.materials.size());
+        for (size_t m = 0; m < faces.materials.size(); ++m)
+        {
+            const auto it = byName.find(faces.materials[m]);
+            materialOf[m] = it == byName.end() ? fallback : it->second;
+        }
+
+        // counting sort the triangles by material so each one is a single range
+        const size_t triangles = faces.size();
+        auto materialOfFace = [&](size_t t) {
+            const uint32_t m = faces.material[t];
+            return m < materialOf.size() ? materialOf[m] : fallback;
+        };
+        vector<size_t> offset(out->materials.size() + 1, 0);
+        for (size_t t = 0; t < triangles; ++t) ++offset[materialOfFace(t) + 1];
+        for (size_t m = 0; m < out->materials.size(); ++m)
+        {
+            if (offset[m + 1] > 0)
+            {
+                objModelRange_t range;
+                range.material = m;
+                range.range.firstIndex = offset[m] * 3;
+                range.range.count = (GLsizei)(offset[m + 1] * 3);
+                out->ranges.push_back(range);
+            }
+            offset[m + 1] += offset[m];
+        }
+        objFaces_t sorted;
+        sorted.corners.resize(faces.corners.size());
+        sorted.smoothing.resize(triangles);
+        for (size_t t = 0; t < triangles; ++t)
+        {
+            const size_t slot = offset[materialOfFace(t)]++;
+            for (size_t c = 0; c < 3; ++c)
+                sorted.corners[(slot * 3) + c] = faces.corners[(t * 3) + c];
+            sorted.smoothing[slot] = faces.smoothing[t];
+        }
+        faces = {};
+
+        // corners without a normal get a made up vn past the real ones: one
+        // per smoothing group, or one per face with smoothing off, so
+        // indexOBJ only merges the vertices that should share a normal
+        const size_t fileNormals = normals.size();
+        unordered_map<uint32_t, uint32_t> smoothingKey;
+        size_t generated = 0;
+        for (size_t t = 0; t < triangles; ++t)
+        {
+            uint32_t key = objNone;
+            for (size_t c = 0; c < 3; ++c)
+            {
+                objCorner_t &corner = sorted.corners[(t * 3) + c];
+                if (corner.vn < fileNormals) continue;
+                if (key == objNone)
+                {
+                    const uint32_t group = sorted.smoothing[t];
+                    if (group == 0) key = (uint32_t)(fileNormals + generated++);
+                    else
+                    {
+                        auto it = smoothingKey.emplace(group, (uint32_t)(fileNormals + generated));
+                        if (it.second) ++generated;
+                        key = it.first->second;
+                    }
+                }
+                corner.vn = key;
+            }
+        }
+        normals.resize(fileNormals + generated, array<float, 3>{{0.0f, 0.0f, 0.0f}});
+
+        vector<_objModelVertex_t> vertices;
+        out->mesh = std::make_shared<mesh_t>();
+        indexOBJ(&positions, &texcoords, &normals, sorted, &vertices, &out->mesh->index);
+        for (auto &vertex : vertices) vertex.uvw[1] = 1.0f - vertex.uvw[1];
+        const auto &index = out->mesh->index;
+
+        if (generated > 0)
+        {
+            // vertices split only by their uv still share a normal
+            vector<uint32_t> remap(vertices.size());
+            vector<bool> missing(vertices.size(), false);
+            unordered_map<uint64_t, uint32_t> canonical;
+            for (size_t i = 0; i < index.size(); ++i)
+            {
+                const objCorner_t &corner = sorted.corners[i];
+                const uint32_t vertex = index[i];
+                if (corner.vn < fileNormals) { remap[vertex] = vertex; continue; }
+                missing[vertex] = true;
+                remap[vertex] = canonical.emplace(((uint64_t)corner.v << 32) | corner.vn, vertex).first->second;
+            }
+            vector<array<float, 3>> smooth(vertices.size());
+            generateNormals(smooth[0].data(), sizeof(smooth[0]),
+                vertices[0].position.data(), sizeof(_objModelVertex_t), vertices.size(),
+                index.data(), index.size(), remap.data(), NORMAL_WEIGHT_AREA_ANGLE, pool);
+            for (size_t v = 0; v < vertices.size(); ++v)
+                if (missing[v]) vertices[v].normal = smooth[v];
+        }
+        sorted = {};
+        out->mesh->indexCount = out->mesh->index.size();
+        out->mesh->drawMode = GL_TRIANGLES;
+
+        // kept as separate elements, mesh_t interlaces them on the first draw
+        out->mesh->vertArray.buffers.resize(1);
+        auto &elements = out->mesh->vertArray.buffers[0].elements;
+        auto element = [&](const char *name, GLint size, size_t offset) {
+            auto &elem = elements[name];
+            elem.type = GL_FLOAT;
+            elem.size = size;
+            elem.normalised = false;
+            elem.active = true;
+            elem.dirty = true;
+            const size_t bytes = sizeof(float) * size;
+            elem.data.init(vertices.size() * bytes, bytes);
+            for (size_t v = 0; v < vertices.size(); ++v)
+                memcpy(&elem.data.data[v * bytes], (const uint8_t*)&vertices[v] + offset, bytes);
+        };
+        element("POSITION", 3, offsetof(_objModelVertex_t, position));
+        element("TEXCOORD_0", 2, offsetof(_objModelVertex_t, uvw));
+        element("NORMAL", 3, offsetof(_objModelVertex_t, normal));
+
+        bool bumped = false;
+        for (const auto &material : out->materials) bumped |= !material.bumpMap.empty();
+        if (bumped && !texcoords.empty() && !vertices.empty())
+        {
+            vector<array<float, 4>> tangents(vertices.size());
+            generateTangents(tangents[0].data(), sizeof(tangents[0]),
+                vertices[0].position.data(), sizeof(_objModelVertex_t),
+                vertices[0].normal.data(), sizeof(_objModelVertex_t),
+                vertices[0].uvw.data(), sizeof(_objModelVertex_t), vertices.size(),
+                index.data(), index.size(), nullptr, pool);
+            auto &elem = elements["TANGENT"];
+            elem.type = GL_FLOAT;
+            elem.size = 4;
+            elem.normalised = false;
+            elem.active = true;
+            elem.dirty = true;
+            elem.data.init(tangents.size() * sizeof(tangents[0]), sizeof(tangents[0]));
+            memcpy(elem.data.data.data(), tangents.data(), tangents.size() * sizeof(tangents[0]));
+        }
+
+        // .obj face order is whatever the exporter left, so reorder for the
+        // vertex cache and overdraw while the element data is still around
+        {
+            vector<drawRange_t> draws(out->ranges.size());
+            for (size_t r = 0; r < out->ranges.size(); ++r) draws[r] = out->ranges[r].range;
+            const meshOptimizeStats_t stats = optimizeMesh(out->mesh.get(), draws.data(), draws.size());
+            LDEBUG(path << " ACMR " << stats.before.acmr << " -> " << stats.after.acmr << ", ATVR " << stats.before.atvr << " -> " << stats.after.atvr);
+        }
+
+        out->textures.resize(out->materials.size());
+        if (cache != nullptr) loadOBJTextures(out, cache, pool);
+        return true;
+    }
+
+    void loadOBJTextures(objModel_t *model, textureCache_t *cache, workerPool_t *pool)
+    {
+        model->textures.clear();
+        model->textures.resize(model->materials.size());
+        auto mapPath = [&](size_t m, const string &map) {
+            if (map.empty()) return string();
+            return m < model->directories.size() ? model->directories[m] + map : map;
+        };
+        vector<string> paths;
+        for (size_t m = 0; m < model->materials.size(); ++m)
+        {
+            const auto &material = model->materials[m];
+            for (const string *map : {&material.ambientMap, &material.diffuseMap, &material.specularMap, &material.emissiveMap, &material.alphaMap, &material.bumpMap})
+                if (!map->empty()) paths.push_back(mapPath(m, *map));
+        }
+        cache->load(paths, pool);
+        for (size_t m = 0; m < model->materials.size(); ++m)
+        {
+            const auto &material = model->materials[m];
+            auto &textures = model->textures[m];
+            textures.ambient = cache->get(mapPath(m, material.ambientMap));
+            textures.diffuse = cache->get(mapPath(m, material.diffuseMap));
+            textures.specular = cache->get(mapPath(m, material.specularMap));
+            textures.emissive = cache->get(mapPath(m, material.emissiveMap));
+            textures.alpha = cache->get(mapPath(m, material.alphaMap));
+            textures.bump = cache->get(mapPath(m, material.bumpMap));
+        }
+    }
+}
@@ -0,0 +1,105 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <vector>
+#include <string>
+#include <memory>
+
+#include "utils/obj.h"
+#include "utils/mtl.h"
+#include "types/mesh.h"
+#include "types/texture.h"
+#include "types/texture_cache.h"
+#include "types/worker_pool.h"
+
+#ifndef LAK_OBJ_MODEL_H
+#define LAK_OBJ_MODEL_H
+
+namespace lak
+{
+    using std::vector;
+    using std::string;
+    using std::shared_ptr;
+
+    struct objModelTextures_t
+    {
+        shared_ptr<texture_t> ambient;
+        shared_ptr<texture_t> diffuse;
+        shared_ptr<texture_t> specular;
+        shared_ptr<texture_t> emissive;
+        shared_ptr<texture_t> alpha;
+        shared_ptr<texture_t> bump;
+    };
+
+    // the triangles of one material
+    struct objModelRange_t
+    {
+        size_t material = -1;   // index into objModel_t::materials
+        drawRange_t range;
+    };
+
+    // an .obj loaded into a single indexed mesh with one draw range per
+    // material. elements are named like gltf batches ("POSITION",
+    // "TEXCOORD_0", "NORMAL" and "TANGENT" if any material has a bump map)
+    // and texture coordinates are flipped to a top left origin to match, so
+    // the same shaders work for both. faces without normals get smooth ones
+    // per smoothing group (flat with "s off"), and the triangles and
+    // vertices are reordered with optimizeMesh
+    struct objModel_t
+    {
+        shared_ptr<mesh_t> mesh;
+        // every material from the mtllibs plus a default one (last) for faces
+        // without a usemtl or with an unknown one
+        vector<objMaterial_t> materials;
+        vector<objModelTextures_t> textures;    // index matches materials
+        vector<objModelRange_t> ranges;         // sorted by material, only used materials
+        vector<string> directories;             // per material, what its maps are relative to
+        vector<string> sources;                 // the .obj and every .mtl read for it
+
+        // draws every range with the textures and uniforms left as they are
+        void draw();
+    };
+
+    // reads path and the .mtl files it uses. the maps of every material are
+    // loaded through cache (if not null) so textures shared between
+    // materials or models are only decoded and uploaded once, decoding in
+    // parallel if pool isn't null (as are generated normals and tangents).
+    // threads is passed to readOBJ. the mesh makes no GL calls until its
+    // first draw, but loading textures must happen on the thread that owns
+    // the GL context (if cache isn't null)
+    bool loadOBJModel(const string &path, objModel_t *out, textureCache_t *cache = nullptr, workerPool_t *pool = nullptr, size_t threads = 1);
+
+    // (re)loads the maps of every material of model through cache, see
+    // loadOBJModel
+    void loadOBJTextures(objModel_t *model, textureCache_t *cache, workerPool_t *pool = nullptr);
+}
+
+#ifdef LAK_OBJ_MODEL_IMPLEM
+#   ifndef LAK_OBJ_MODEL_HAS_IMPLEM
+#       define LAK_OBJ_MODEL_HAS_IMPLEM
+#       include "types/obj_model.cpp"
+#   endif // LAK_OBJ_MODEL_HAS_IMPLEM
+#endif // LAK_OBJ_MODEL_IMPLEM
+
+#endif // LAK_OBJ_MODEL_H
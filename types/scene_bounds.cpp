@@ -0,0 +1,342 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cmath>
+#include <algorithm>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif // __SSE__
+
+#include "types/scene_bounds.h"
+
+namespace lak
+{
+    static const float infiniteExtent = 1e30f;
+
+    void bounds_t::add(const glm::vec3 &point)
+    {
+        min.x = std::min(min.x, point.x); max.x = std::max(max.x, point.x);
+        min.y = std::min(min.y, point.y); max.y = std::max(max.y, point.y);
+        min.z = std::min(min.z, point.z); max.z = std::max(max.z, point.z);
+    }
+
+    void bounds_t::add(const bounds_t &other)
+    {
+        if (other.empty()) return;
+        add(other.min);
+        add(other.max);
+    }
+
+    // accessor min/max are stored in the component type, not normalized
+    static float dequantize(const gltf_t::accessor_t &acc, double v)
+    {
+        if (!acc.normalized) return (float)v;
+        switch (acc.componentType)
+        {
+            case GL_BYTE: return std::max((float)(v / 127.0), -1.0f);
+            case GL_UNSIGNED_BYTE: return (float)(v / 255.0);
+            case GL_SHORT: return std::max((float)(v / 32767.0), -1.0f);
+            case GL_UNSIGNED_SHORT: return (float)(v / 65535.0);
+            case GL_UNSIGNED_INT: return (float)(v / 4294967295.0);
+            default: return (float)v;
+        }
+    }
+
+    static bool accessorBounds(const gltf_t &gltf, const gltfData_t &data, size_t accessor, bounds_t *out)
+    {
+        if (accessor >= gltf.accessors.size()) return false;
+        const auto &acc = gltf.accessors[accessor];
+        if (acc.min.size() >= 3 && acc.max.size() >= 3)
+        {
+            out->min = glm::vec3(dequantize(acc, acc.min[0]), dequantize(acc, acc.min[1]), dequantize(acc, acc.min[2]));
+            out->max = glm::vec3(dequantize(acc, acc.max[0]), dequantize(acc, acc.max[1]), dequantize(acc, acc.max[2]));
+            return true;
+        }
+        // min/max are required for POSITION, but not every exporter agrees
+        vector<float> values;
+        if (accessor >= data.accessors.size() || !accessorToFloat(gltf, accessor, data.accessors[accessor], &values, acc.normalized))
+            return false;
+        *out = bounds_t();
+        for (size_t i = 0; i + 2 < values.size(); i += 3)
+            out->add(glm::vec3(values[i], values[i + 1], values[i + 2]));
+        return !out->empty();
+    }
+
+    bool primitiveBounds(const gltf_t &gltf, const gltfData_t &data, size_t mesh, size_t primitive, bounds_t *out)
+    {
+        *out = bounds_t();
+        if (mesh >= gltf.meshes.size() || primitive >= gltf.meshes[mesh].primitives.size()) return false;
+        const auto &prim = gltf.meshes[mesh].primitives[primitive];
+        const auto position = prim.attributes.find("POSITION");
+        if (position == prim.attributes.end() || !accessorBounds(gltf, data, position->second, out)) return false;
+
+        for (const auto &target : prim.targets)
+        {
+            const auto delta = target.find("POSITION");
+            bounds_t range;
+            if (delta == target.end() || !accessorBounds(gltf, data, delta->second, &range)) continue;
+            out->min.x += std::min(range.min.x, 0.0f); out->max.x += std::max(range.max.x, 0.0f);
+            out->min.y += std::min(range.min.y, 0.0f); out->max.y += std::max(range.max.y, 0.0f);
+            out->min.z += std::min(range.min.z, 0.0f); out->max.z += std::max(range.max.z, 0.0f);
+        }
+        return true;
+    }
+
+    frustum_t::frustum_t(const glm::mat4 &m)
+    {
+        // Gribb/Hartmann, rows of the matrix combined (-w <= x, y, z <= w)
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int s = 0; s < 2; ++s)
+            {
+                const int p = (i * 2) + s;
+                const float sign = s == 0 ? 1.0f : -1.0f;
+                a[p] = m[0][3] + (sign * m[0][i]);
+                b[p] = m[1][3] + (sign * m[1][i]);
+                c[p] = m[2][3] + (sign * m[2][i]);
+                d[p] = m[3][3] + (sign * m[3][i]);
+            }
+        }
+    }
+
+    void sceneBounds_t::build(const gltf_t &gltf, const gltfData_t &data, const sceneGraph_t &graph)
+    {
+        const size_t n = graph.size();
+
+        // local mesh bounds
+        meshBounds.assign(n, bounds_t());
+        vector<uint8_t> skinned(n, false);
+        for (size_t i = 0; i < n; ++i)
+        {
+            const auto &node = gltf.nodes[graph.node[i]];
+            if (node.mesh >= gltf.meshes.size()) continue;
+            skinned[i] = node.skin != (size_t)-1;
+            for (size_t p = 0; p < gltf.meshes[node.mesh].primitives.size(); ++p)
+            {
+                bounds_t b;
+                if (primitiveBounds(gltf, data, node.mesh, p, &b)) meshBounds[i].add(b);
+            }
+            if (skinned[i] && meshBounds[i].empty()) meshBounds[i].add(glm::vec3(0.0f));
+        }
+
+        // depth first order so subtrees are contiguous
+        vector<vector<size_t>> children(n);
+        vector<size_t> stack;
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (graph.parent[i] == (size_t)-1) stack.push_back(i);
+            else children[graph.parent[i]].push_back(i);
+        }
+        std::reverse(stack.begin(), stack.end());
+        order.clear();
+        order.reserve(n);
+        vector<size_t> position(n, -1);
+        while (!stack.empty())
+        {
+            const size_t i = stack.back();
+            stack.pop_back();
+            position[i] = order.size();
+            order.push_back(i);
+            stack.insert(stack.end(), children[i].rbegin(), children[i].rend());
+        }
+
+        parentPos.resize(n);
+        hasMesh.resize(n);
+        subtreeEnd.resize(n);
+        for (size_t p = 0; p < n; ++p)
+        {
+            const size_t g = order[p];
+            parentPos[p] = graph.parent[g] == (size_t)-1 ? (size_t)-1 : position[graph.parent[g]];
+            hasMesh[p] = !meshBounds[g].empty();
+            subtreeEnd[p] = p + 1;
+        }
+        for (size_t p = n; p-- > 0;)
+            if (parentPos[p] != (size_t)-1)
+                subtreeEnd[parentPos[p]] = std::max(subtreeEnd[parentPos[p]], subtreeEnd[p]);
+
+        // skinned meshes move with their joints, so never cull them
+        _infinite.assign(n, false);
+        for (size_t p = 0; p < n; ++p)
+            _infinite[p] = skinned[order[p]];
+
+        for (auto *v : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ,
+            &treeCenterX, &treeCenterY, &treeCenterZ, &treeExtentX, &treeExtentY, &treeExtentZ})
+            v->assign(n, 0.0f);
+
+        update(graph);
+    }
+
+    void sceneBounds_t::update(const sceneGraph_t &graph)
+    {
+        const size_t n = size();
+        thread_local vector<bounds_t> tree;
+        tree.assign(n, bounds_t());
+
+        for (size_t p = 0; p < n; ++p)
+        {
+            if (!hasMesh[p])
+            {
+                centerX[p] = centerY[p] = centerZ[p] = 0.0f;
+                extentX[p] = extentY[p] = extentZ[p] = -1.0f;
+                continue;
+            }
+            if (_infinite[p])
+            {
+                centerX[p] = centerY[p] = centerZ[p] = 0.0f;
+                extentX[p] = extentY[p] = extentZ[p] = infiniteExtent;
+                tree[p].min = glm::vec3(-infiniteExtent);
+                tree[p].max = glm::vec3(infiniteExtent);
+                continue;
+            }
+            // transform the centre, the extent grows by the absolute rotation/scale
+            const glm::mat4 &m = graph.world[order[p]];
+            const bounds_t &b = meshBounds[order[p]];
+            const float c[3] = {(b.min.x + b.max.x) * 0.5f, (b.min.y + b.max.y) * 0.5f, (b.min.z + b.max.z) * 0.5f};
+            const float e[3] = {(b.max.x - b.min.x) * 0.5f, (b.max.y - b.min.y) * 0.5f, (b.max.z - b.min.z) * 0.5f};
+            float wc[3], we[3];
+            for (int r = 0; r < 3; ++r)
+            {
+                wc[r] = m[3][r] + (m[0][r] * c[0]) + (m[1][r] * c[1]) + (m[2][r] * c[2]);
+                we[r] = (std::fabs(m[0][r]) * e[0]) + (std::fabs(m[1][r]) * e[1]) + (std::fabs(m[2][r]) * e[2]);
+            }
+            centerX[p] = wc[0]; centerY[p] = wc[1]; centerZ[p] = wc[2];
+            extentX[p] = we[0]; extentY[p] = we[1]; extentZ[p] = we[2];
+            tree[p].min = glm::vec3(wc[0] - we[0], wc[1] - we[1], wc[2] - we[2]);
+            tree[p].max = glm::vec3(wc[0] + we[0], wc[1] + we[1], wc[2] + we[2]);
+        }
+
+        // children come after their parents, so walking backwards merges
+        // each subtree before its parent is merged into its own parent
+        for (size_t p = n; p-- > 0;)
+            if (parentPos[p] != (size_t)-1)
+                tree[parentPos[p]].add(tree[p]);
+
+        for (size_t p = 0; p < n; ++p)
+        {
+            const bounds_t &b = tree[p];
+            if (b.empty())
+            {
+                treeCenterX[p] = treeCenterY[p] = treeCenterZ[p] = 0.0f;
+                treeExtentX[p] = treeExtentY[p] = treeExtentZ[p] = -1.0f;
+                continue;
+            }
+            treeCenterX[p] = (b.min.x + b.max.x) * 0.5f;
+            treeCenterY[p] = (b.min.y + b.max.y) * 0.5f;
+            treeCenterZ[p] = (b.min.z + b.max.z) * 0.5f;
+            treeExtentX[p] = (b.max.x - b.min.x) * 0.5f;
+            treeExtentY[p] = (b.max.y - b.min.y) * 0.5f;
+            treeExtentZ[p] = (b.max.z - b.min.z) * 0.5f;
+        }
+    }
+
+    enum { OUTSIDE = 0, INTERSECTS = 1, INSIDE = 2 };
+
+    static int classify(const frustum_t &f, float cx, float cy, float cz, float ex, float ey, float ez)
+    {
+        if (ex < 0.0f) return OUTSIDE;
+        int result = INSIDE;
+        for (int i = 0; i < 6; ++i)
+        {
+            const float d = (f.a[i] * cx) + (f.b[i] * cy) + (f.c[i] * cz) + f.d[i];
+            const float r = (std::fabs(f.a[i]) * ex) + (std::fabs(f.b[i]) * ey) + (std::fabs(f.c[i]) * ez);
+            if (d + r < 0.0f) return OUTSIDE;
+            if (d - r < 0.0f) result = INTERSECTS;
+        }
+        return result;
+    }
+
+    void sceneBounds_t::cull(const frustum_t &frustum, vector<size_t> *visible) const
+    {
+        const size_t n = size();
+        // leaves (and meshes of partially visible parents) are tested in
+        // batches afterwards, only subtrees are tested during the walk
+        thread_local vector<size_t> candidates;
+        candidates.clear();
+
+        for (size_t p = 0; p < n;)
+        {
+            const size_t end = subtreeEnd[p];
+            if (end == p + 1)
+            {
+                if (hasMesh[p]) candidates.push_back(p);
+                ++p;
+                continue;
+            }
+            switch (classify(frustum, treeCenterX[p], treeCenterY[p], treeCenterZ[p], treeExtentX[p], treeExtentY[p], treeExtentZ[p]))
+            {
+                case OUTSIDE:
+                    p = end;
+                    break;
+                case INSIDE:
+                    for (; p < end; ++p)
+                        if (hasMesh[p]) visible->push_back(order[p]);
+                    break;
+                default:
+                    if (hasMesh[p]) candidates.push_back(p);
+                    ++p;
+                    break;
+            }
+        }
+
+        size_t i = 0;
+        #ifdef __SSE__
+        const __m128 zero = _mm_setzero_ps();
+        __m128 pa[6], pb[6], pc[6], pd[6], aa[6], ab[6], ac[6];
+        for (int k = 0; k < 6; ++k)
+        {
+            pa[k] = _mm_set1_ps(frustum.a[k]); aa[k] = _mm_set1_ps(std::fabs(frustum.a[k]));
+            pb[k] = _mm_set1_ps(frustum.b[k]); ab[k] = _mm_set1_ps(std::fabs(frustum.b[k]));
+            pc[k] = _mm_set1_ps(frustum.c[k]); ac[k] = _mm_set1_ps(std::fabs(frustum.c[k]));
+            pd[k] = _mm_set1_ps(frustum.d[k]);
+        }
+        for (; i + 4 <= candidates.size(); i += 4)
+        {
+            const size_t *c = &candidates[i];
+            const __m128 cx = _mm_setr_ps(centerX[c[0]], centerX[c[1]], centerX[c[2]], centerX[c[3]]);
+            const __m128 cy = _mm_setr_ps(centerY[c[0]], centerY[c[1]], centerY[c[2]], centerY[c[3]]);
+            const __m128 cz = _mm_setr_ps(centerZ[c[0]], centerZ[c[1]], centerZ[c[2]], centerZ[c[3]]);
+            const __m128 ex = _mm_setr_ps(extentX[c[0]], extentX[c[1]], extentX[c[2]], extentX[c[3]]);
+            const __m128 ey = _mm_setr_ps(extentY[c[0]], extentY[c[1]], extentY[c[2]], extentY[c[3]]);
+            const __m128 ez = _mm_setr_ps(extentZ[c[0]], extentZ[c[1]], extentZ[c[2]], extentZ[c[3]]);
+            __m128 outside = _mm_cmplt_ps(ex, zero);
+            for (int k = 0; k < 6; ++k)
+            {
+                const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pa[k], cx), _mm_mul_ps(pb[k], cy)), _mm_add_ps(_mm_mul_ps(pc[k], cz), pd[k]));
+                const __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(aa[k], ex), _mm_mul_ps(ab[k], ey)), _mm_mul_ps(ac[k], ez));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
+            }
+            const int mask = _mm_movemask_ps(outside);
+            for (int j = 0; j < 4; ++j)
+                if (!(mask & (1 << j))) visible->push_back(order[c[j]]);
+        }
+        #endif // __SSE__
+        for (; i < candidates.size(); ++i)
+        {
+            const size_t p = candidates[i];
+            if (classify(frustum, centerX[p], centerY[p], centerZ[p], extentX[p], extentY[p], extentZ[p]) != OUTSIDE)
+                visible->push_back(order[p]);
+        }
+    }
+}
@@ -0,0 +1,105 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <vector>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "types/gltf.h"
+#include "types/gltf_loader.h"
+#include "types/scene_graph.h"
+
+#ifndef LAK_SCENE_BOUNDS_H
+#define LAK_SCENE_BOUNDS_H
+
+namespace lak
+{
+    using std::vector;
+
+    // axis aligned bounding box, empty if min > max
+    struct bounds_t
+    {
+        glm::vec3 min = glm::vec3(1e30f);
+        glm::vec3 max = glm::vec3(-1e30f);
+        inline bool empty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+        void add(const glm::vec3 &point);
+        void add(const bounds_t &other);
+    };
+
+    // local space bounds of a primitive's POSITION accessor, from its min/max
+    // if present (otherwise computed from the data). morph targets expand the
+    // bounds to cover weights between 0 and 1
+    bool primitiveBounds(const gltf_t &gltf, const gltfData_t &data, size_t mesh, size_t primitive, bounds_t *out);
+
+    // clip planes of a (GL style) view projection matrix, stored SoA
+    struct frustum_t
+    {
+        float a[6], b[6], c[6], d[6];
+        frustum_t() {}
+        frustum_t(const glm::mat4 &viewProj);
+    };
+
+    // world space bounds for every node of a sceneGraph_t, both for the
+    // node's own mesh and for the node plus all of its descendants (tree).
+    // arrays are indexed by position in depth first order so a subtree is
+    // always the range [i, subtreeEnd[i])
+    struct sceneBounds_t
+    {
+        // readonly
+        vector<size_t> order;           // position -> graph index
+        vector<size_t> subtreeEnd;
+        vector<size_t> parentPos;       // position of the parent, -1 for roots
+        vector<bounds_t> meshBounds;    // local space, index matches graph (empty if no mesh)
+        vector<uint8_t> hasMesh;        // by position
+        // world space centre/extent, SoA by position
+        vector<float> centerX, centerY, centerZ, extentX, extentY, extentZ;
+        vector<float> treeCenterX, treeCenterY, treeCenterZ, treeExtentX, treeExtentY, treeExtentZ;
+        vector<uint8_t> _infinite;      // by position
+
+        inline size_t size() const { return order.size(); }
+
+        // skinned nodes are given infinite bounds (they're never culled)
+        void build(const gltf_t &gltf, const gltfData_t &data, const sceneGraph_t &graph);
+
+        // recomputes the world bounds from graph.world, call after graph.update()
+        void update(const sceneGraph_t &graph);
+
+        // appends the graph index of every mesh node that might be visible.
+        // subtrees entirely outside the frustum are skipped and subtrees
+        // entirely inside are accepted without testing their nodes
+        void cull(const frustum_t &frustum, vector<size_t> *visible) const;
+    };
+}
+
+#ifdef LAK_SCENE_BOUNDS_IMPLEM
+#   ifndef LAK_SCENE_BOUNDS_HAS_IMPLEM
+#       define LAK_SCENE_BOUNDS_HAS_IMPLEM
+#       include "types/scene_bounds.cpp"
+#   endif // LAK_SCENE_BOUNDS_HAS_IMPLEM
+#endif // LAK_SCENE_BOUNDS_IMPLEM
+
+#endif // LAK_SCENE_BOUNDS_H
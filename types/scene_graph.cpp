@@ -0,0 +1,141 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+
+#include "types/scene_graph.h"
+
+namespace lak
+{
+    glm::mat4 composeTRS(const glm::vec3 &t, const glm::quat &r, const glm::vec3 &s)
+    {
+        const float x = r.x, y = r.y, z = r.z, w = r.w;
+        glm::mat4 m;
+        m[0] = glm::vec4((1.0f - 2.0f*(y*y + z*z)) * s.x, (2.0f*(x*y + z*w)) * s.x, (2.0f*(x*z - y*w)) * s.x, 0.0f);
+        m[1] = glm::vec4((2.0f*(x*y - z*w)) * s.y, (1.0f - 2.0f*(x*x + z*z)) * s.y, (2.0f*(y*z + x*w)) * s.y, 0.0f);
+        m[2] = glm::vec4((2.0f*(x*z + y*w)) * s.z, (2.0f*(y*z - x*w)) * s.z, (1.0f - 2.0f*(x*x + y*y)) * s.z, 0.0f);
+        m[3] = glm::vec4(t.x, t.y, t.z, 1.0f);
+        return m;
+    }
+
+    void sceneGraph_t::build(const gltf_t &gltf, size_t scene)
+    {
+        const size_t count = gltf.nodes.size();
+        parent.clear(); node.clear(); hasTRS.clear();
+        local.clear(); world.clear();
+        translation.clear(); rotation.clear(); scale.clear(); dirty.clear();
+        weightOffset.clear(); weights.clear();
+        index.assign(count, -1);
+
+        vector<size_t> roots;
+        if (scene < gltf.scenes.size())
+        {
+            roots = gltf.scenes[scene].nodes;
+        }
+        else
+        {
+            vector<uint8_t> isChild(count, false);
+            for (const auto &n : gltf.nodes)
+                for (size_t c : n.children)
+                    if (c < count) isChild[c] = true;
+            for (size_t i = 0; i < count; ++i)
+                if (!isChild[i]) roots.push_back(i);
+        }
+
+        // breadth first, so parents are always visited before their children
+        // (index doubles as the visited flag in case of bad/cyclic files)
+        node.reserve(count);
+        parent.reserve(count);
+        for (size_t r : roots)
+        {
+            if (r >= count || index[r] != (size_t)-1) continue;
+            index[r] = node.size();
+            node.push_back(r);
+            parent.push_back(-1);
+        }
+        for (size_t i = 0; i < node.size(); ++i)
+        {
+            for (size_t c : gltf.nodes[node[i]].children)
+            {
+                if (c >= count || index[c] != (size_t)-1) continue;
+                index[c] = node.size();
+                node.push_back(c);
+                parent.push_back(i);
+            }
+        }
+
+        const size_t size = node.size();
+        hasTRS.resize(size);
+        local.resize(size);
+        world.resize(size);
+        translation.resize(size);
+        rotation.resize(size);
+        scale.resize(size);
+        dirty.assign(size, true);
+        weightOffset.resize(size + 1);
+        for (size_t i = 0; i < size; ++i)
+        {
+            const auto &n = gltf.nodes[node[i]];
+            hasTRS[i] = !n.useMatrix;
+            translation[i] = n.translation;
+            rotation[i] = glm::quat(n.rotation.w, n.rotation.x, n.rotation.y, n.rotation.z);
+            scale[i] = n.scale;
+            local[i] = n.useMatrix ? n.matrix : glm::mat4(1.0f);
+            weightOffset[i] = weights.size();
+            if (n.mesh < gltf.meshes.size())
+            {
+                // one weight per morph target, defaults come from the node
+                // then the mesh, and are otherwise 0
+                const auto &mesh = gltf.meshes[n.mesh];
+                const vector<double> &defaults = n.weights.empty() ? mesh.weights : n.weights;
+                size_t targets = defaults.size();
+                for (const auto &primitive : mesh.primitives)
+                    if (primitive.targets.size() > targets) targets = primitive.targets.size();
+                for (size_t w = 0; w < targets; ++w)
+                    weights.push_back(w < defaults.size() ? (float)defaults[w] : 0.0f);
+            }
+        }
+        weightOffset[size] = weights.size();
+
+        update();
+    }
+
+    void sceneGraph_t::update()
+    {
+        const size_t size = node.size();
+        for (size_t i = 0; i < size; ++i)
+        {
+            const size_t p = parent[i];
+            // parents are always updated first, so their flag has already
+            // been propagated from their own parent
+            if (p != (size_t)-1 && dirty[p]) dirty[i] = true;
+            if (!dirty[i]) continue;
+            if (hasTRS[i])
+                local[i] = composeTRS(translation[i], rotation[i], scale[i]);
+            world[i] = p != (size_t)-1 ? world[p] * local[i] : local[i];
+        }
+        // clear after the pass, children read their parent's flag above
+        std::fill(dirty.begin(), dirty.end(), (uint8_t)false);
+    }
+}
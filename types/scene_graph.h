@@ -0,0 +1,88 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <vector>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "types/gltf.h"
+
+#ifndef LAK_SCENE_GRAPH_H
+#define LAK_SCENE_GRAPH_H
+
+namespace lak
+{
+    using std::vector;
+
+    // builds a local transform from translation, rotation and scale
+    glm::mat4 composeTRS(const glm::vec3 &t, const glm::quat &r, const glm::vec3 &s);
+
+    // flattened node hierarchy, stored as parallel arrays sorted so that
+    // every parent comes before all of its children. this means world
+    // transforms can be computed in a single linear pass
+    struct sceneGraph_t
+    {
+        // readonly
+        vector<size_t> parent;          // graph index of parent, -1 for roots
+        vector<size_t> node;            // gltf_t::nodes index
+        vector<size_t> index;           // gltf_t::nodes index -> graph index (-1 if not in the scene)
+        vector<uint8_t> hasTRS;         // false if local was set from a matrix
+        vector<glm::mat4> local;
+        vector<glm::mat4> world;
+        // params
+        vector<glm::vec3> translation;
+        vector<glm::quat> rotation;
+        vector<glm::vec3> scale;
+        vector<uint8_t> dirty;          // set to true after changing TRS (see setTRS)
+        // morph target weights for node i are weights[weightOffset[i]] to weights[weightOffset[i+1]]
+        vector<size_t> weightOffset;    // size() + 1 entries
+        vector<float> weights;
+
+        inline size_t size() const { return node.size(); }
+
+        // flattens the nodes of gltf.scenes[scene], if scene is out of range
+        // then every node without a parent is treated as a root
+        void build(const gltf_t &gltf, size_t scene);
+
+        inline void setTRS(size_t i, const glm::vec3 &t, const glm::quat &r, const glm::vec3 &s)
+        { translation[i] = t; rotation[i] = r; scale[i] = s; dirty[i] = true; }
+
+        // recomputes local and world transforms for every dirty node and
+        // their descendants, then clears the dirty flags
+        void update();
+    };
+}
+
+#ifdef LAK_SCENE_GRAPH_IMPLEM
+#   ifndef LAK_SCENE_GRAPH_HAS_IMPLEM
+#       define LAK_SCENE_GRAPH_HAS_IMPLEM
+#       include "types/scene_graph.cpp"
+#   endif // LAK_SCENE_GRAPH_HAS_IMPLEM
+#endif // LAK_SCENE_GRAPH_IMPLEM
+
+#endif // LAK_SCENE_GRAPH_H
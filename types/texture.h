@@ -177,6 +177,22 @@ namespace lak
             update();
             imageToTexture(texType, level, cformat, border, img);
         }
+        // same as above but from raw pixel data (w * h pixels of glformat/gltype)
+        void generate(GLenum ttype, GLint level, GLint cformat, GLint border, size_t width, size_t height, GLenum glformat, GLenum gltype, const void *pixels, const vector<texparam_t>& prms)
+        {
+            texType = ttype;
+            w = width;
+            h = height;
+            params = prms;
+            if(!generated)
+            {
+                glGenTextures(1, &tex);
+                generated = true;
+            }
+            update();
+            if(w > 0 && h > 0)
+                glTexImage2D(texType, level, cformat, (GLsizei)w, (GLsizei)h, border, glformat, gltype, pixels);
+        }
         void bind()
         {
             if(!generated) return;
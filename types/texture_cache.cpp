@@ -0,0 +1,92 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+
+#include "utils/mapped_file.h"
+#include "utils/ldebug.h"
+#include "types/gltf_loader.h"
+#include "types/texture_cache.h"
+
+namespace lak
+{
+    string textureCachePath(const string &path)
+    {
+        string result = path;
+        std::replace(result.begin(), result.end(), '\\', '/');
+        return result;
+    }
+
+    void textureCache_t::load(const vector<string> &paths, workerPool_t *pool)
+    {
+        vector<string> missing;
+        for (const auto &path : paths)
+        {
+            const string key = textureCachePath(path);
+            if (key.empty() || textures.count(key)) continue;
+            if (std::find(missing.begin(), missing.end(), key) == missing.end()) missing.push_back(key);
+        }
+        if (missing.empty()) return;
+
+        // decoding is the slow part and doesn't need GL
+        vector<imageRGBA8_t> images(missing.size());
+        vector<char> decoded(missing.size(), 0);
+        auto decode = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+            {
+                mappedFile_t file(missing[i]);
+                decoded[i] = file.isOpen() && gltfDecodeImage(file.data, file.size, &images[i]);
+            }
+        };
+        if (pool != nullptr) parallelFor(*pool, missing.size(), decode);
+        else decode(0, missing.size());
+
+        for (size_t i = 0; i < missing.size(); ++i)
+        {
+            shared_ptr<texture_t> &texture = textures[missing[i]];
+            if (!decoded[i])
+            {
+                LERRLOG("Failed to load texture " << missing[i]);
+                continue;
+            }
+            texture = std::make_shared<texture_t>();
+            texture->generate(GL_TEXTURE_2D, 0, GL_RGBA8, 0, images[i], params);
+            if (mipmap) glGenerateMipmap(GL_TEXTURE_2D);
+            images[i] = {};
+        }
+    }
+
+    shared_ptr<texture_t> textureCache_t::get(const string &path)
+    {
+        const string key = textureCachePath(path);
+        if (key.empty()) return nullptr;
+        auto it = textures.find(key);
+        if (it == textures.end())
+        {
+            load({key});
+            it = textures.find(key);
+        }
+        return it == textures.end() ? nullptr : it->second;
+    }
+}
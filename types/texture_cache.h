@@ -0,0 +1,79 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <unordered_map>
+
+#include "types/texture.h"
+#include "types/worker_pool.h"
+
+#ifndef LAK_TEXTURE_CACHE_H
+#define LAK_TEXTURE_CACHE_H
+
+namespace lak
+{
+    using std::vector;
+    using std::string;
+    using std::shared_ptr;
+    using std::unordered_map;
+
+    // loads image files into textures once no matter how many materials (or
+    // models) refer to them. paths are compared after turning \ into /
+    struct textureCache_t
+    {
+        // params
+        vector<texparam_t> params = {
+            {GL_TEXTURE_MIN_FILTER, (GLint)GL_LINEAR_MIPMAP_LINEAR},
+            {GL_TEXTURE_MAG_FILTER, (GLint)GL_LINEAR},
+            {GL_TEXTURE_WRAP_S, (GLint)GL_REPEAT},
+            {GL_TEXTURE_WRAP_T, (GLint)GL_REPEAT}};
+        bool mipmap = true;
+        // readonly
+        unordered_map<string, shared_ptr<texture_t>> textures;  // null if the file couldn't be loaded
+
+        // decodes every path that isn't cached yet (in parallel if pool isn't
+        // null) and uploads them, must be called from the thread that owns
+        // the GL context
+        void load(const vector<string> &paths, workerPool_t *pool = nullptr);
+
+        // the texture for path, loading it first if needed (null on failure)
+        shared_ptr<texture_t> get(const string &path);
+
+        inline void clear() { textures.clear(); }
+    };
+
+    // \ to / so the same file is always the same key
+    string textureCachePath(const string &path);
+}
+
+#ifdef LAK_TEXTURE_CACHE_IMPLEM
+#   ifndef LAK_TEXTURE_CACHE_HAS_IMPLEM
+#       define LAK_TEXTURE_CACHE_HAS_IMPLEM
+#       include "types/texture_cache.cpp"
+#   endif // LAK_TEXTURE_CACHE_HAS_IMPLEM
+#endif // LAK_TEXTURE_CACHE_IMPLEM
+
+#endif // LAK_TEXTURE_CACHE_H
@@ -0,0 +1,116 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "types/worker_pool.h"
+
+namespace lak
+{
+    workerPool_t::workerPool_t(size_t threads)
+    {
+        if (threads == 0) threads = thread::hardware_concurrency();
+        if (threads == 0) threads = 1;
+        _workers.reserve(threads);
+        for (size_t i = 0; i < threads; ++i)
+            _workers.emplace_back(&workerPool_t::_work, this);
+    }
+
+    workerPool_t::~workerPool_t()
+    {
+        {
+            unique_lock<mutex> lock(_lock);
+            _stop = true;
+        }
+        _taskSignal.notify_all();
+        for (auto &worker : _workers)
+            if (worker.joinable()) worker.join();
+    }
+
+    void workerPool_t::push(function<void()> task)
+    {
+        {
+            unique_lock<mutex> lock(_lock);
+            _tasks.push_back(std::move(task));
+        }
+        _taskSignal.notify_one();
+    }
+
+    void workerPool_t::wait()
+    {
+        unique_lock<mutex> lock(_lock);
+        _doneSignal.wait(lock, [this]{ return _tasks.empty() && _active == 0; });
+    }
+
+    void workerPool_t::_work()
+    {
+        unique_lock<mutex> lock(_lock);
+        while (true)
+        {
+            _taskSignal.wait(lock, [this]{ return _stop || !_tasks.empty(); });
+            if (_tasks.empty()) return; // _stop
+            function<void()> task = std::move(_tasks.front());
+            _tasks.pop_front();
+            ++_active;
+            lock.unlock();
+            task();
+            lock.lock();
+            --_active;
+            if (_tasks.empty() && _active == 0)
+                _doneSignal.notify_all();
+        }
+    }
+
+    void parallelFor(workerPool_t &pool, size_t count, const function<void(size_t, size_t)> &func, size_t minRange)
+    {
+        if (count == 0) return;
+        if (minRange == 0) minRange = 1;
+        size_t ranges = pool.size() * 4;
+        if (ranges > (count + minRange - 1) / minRange) ranges = (count + minRange - 1) / minRange;
+        if (ranges <= 1)
+        {
+            func(0, count);
+            return;
+        }
+
+        // wait on our own ranges rather than pool.wait() so this can be
+        // called while other unrelated tasks are running in the pool
+        mutex lock;
+        condition_variable signal;
+        size_t remaining = ranges;
+        const size_t step = count / ranges;
+        const size_t extra = count % ranges;
+        size_t begin = 0;
+        for (size_t i = 0; i < ranges; ++i)
+        {
+            const size_t end = begin + step + (i < extra ? 1 : 0);
+            pool.push([&, begin, end]{
+                func(begin, end);
+                unique_lock<mutex> guard(lock);
+                if (--remaining == 0) signal.notify_all();
+            });
+            begin = end;
+        }
+        unique_lock<mutex> guard(lock);
+        signal.wait(guard, [&]{ return remaining == 0; });
+    }
+}
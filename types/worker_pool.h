@@ -0,0 +1,82 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#ifndef LAK_WORKER_POOL_H
+#define LAK_WORKER_POOL_H
+
+namespace lak
+{
+    using std::vector;
+    using std::deque;
+    using std::thread;
+    using std::mutex;
+    using std::unique_lock;
+    using std::condition_variable;
+    using std::function;
+
+    struct workerPool_t
+    {
+    private:
+        vector<thread> _workers;
+        deque<function<void()>> _tasks;
+        mutex _lock;
+        condition_variable _taskSignal;
+        condition_variable _doneSignal;
+        size_t _active = 0;
+        bool _stop = false;
+        void _work();
+    public:
+        // threads = 0 uses one thread per hardware thread
+        workerPool_t(size_t threads = 0);
+        ~workerPool_t();
+        workerPool_t(const workerPool_t &) = delete;
+        workerPool_t &operator=(const workerPool_t &) = delete;
+        // queue a task, tasks may push more tasks
+        void push(function<void()> task);
+        // block until the queue is empty and all workers are idle
+        void wait();
+        inline size_t size() const { return _workers.size(); }
+    };
+
+    // split [0, count) into roughly equal ranges and run func(begin, end) on
+    // each of them in the pool, blocks until all ranges are complete
+    // NOTE: don't call this from inside a task running in the same pool
+    void parallelFor(workerPool_t &pool, size_t count, const function<void(size_t, size_t)> &func, size_t minRange = 1);
+}
+
+#ifdef LAK_WORKER_POOL_IMPLEM
+#   ifndef LAK_WORKER_POOL_HAS_IMPLEM
+#       define LAK_WORKER_POOL_HAS_IMPLEM
+#       include "types/worker_pool.cpp"
+#   endif // LAK_WORKER_POOL_HAS_IMPLEM
+#endif // LAK_WORKER_POOL_IMPLEM
+
+#endif // LAK_WORKER_POOL_H
@@ -0,0 +1,164 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // _WIN32
+
+#include "utils/mapped_file.h"
+
+namespace lak
+{
+    bool mappedFile_t::open(const string &path)
+    {
+        close();
+        #ifdef _WIN32
+        _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (_file == INVALID_HANDLE_VALUE) { _file = nullptr; return false; }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(_file, &fileSize)) { close(); return false; }
+        size = (size_t)fileSize.QuadPart;
+        _open = true;
+        if (size == 0) return true;
+        _mapping = CreateFileMappingA(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (_mapping == NULL) { _mapping = nullptr; close(); return false; }
+        data = (const uint8_t*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+        if (data == nullptr) { close(); return false; }
+        #else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) { ::close(fd); return false; }
+        size = (size_t)st.st_size;
+        _open = true;
+        if (size > 0)
+        {
+            void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED) { ::close(fd); size = 0; _open = false; return false; }
+            // most users read front to back once
+            madvise(map, size, MADV_SEQUENTIAL);
+            madvise(map, size, MADV_WILLNEED);
+            data = (const uint8_t*)map;
+        }
+        // the mapping keeps its own reference to the file
+        ::close(fd);
+        #endif // _WIN32
+        return true;
+    }
+
+    void mappedFile_t::close()
+    {
+        #ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (_mapping) CloseHandle(_mapping);
+        if (_file) CloseHandle(_file);
+        _mapping = nullptr;
+        _file = nullptr;
+        #else
+        if (data) munmap((void*)data, size);
+        #endif // _WIN32
+        data = nullptr;
+        size = 0;
+        _open = false;
+    }
+
+    static inline uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+    static inline uint64_t mix64(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    uint64_t hashBytes(const void *data, size_t size, uint64_t seed)
+    {
+        static const uint64_t prime1 = 0x9E3779B185EBCA87ull;
+        static const uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+        const uint8_t *p = (const uint8_t*)data;
+        const uint8_t *end = p + size;
+
+        // 4 independent lanes so the multiplies can overlap
+        uint64_t lane[4] = { seed + prime1 + prime2, seed + prime2, seed, seed - prime1 };
+        for (; end - p >= 32; p += 32)
+        {
+            for (size_t i = 0; i < 4; ++i)
+            {
+                uint64_t w;
+                memcpy(&w, p + (i * 8), 8);
+                lane[i] = rotl64(lane[i] + (w * prime2), 31) * prime1;
+            }
+        }
+        uint64_t h = rotl64(lane[0], 1) + rotl64(lane[1], 7) + rotl64(lane[2], 12) + rotl64(lane[3], 18);
+        h += (uint64_t)size;
+        for (; end - p >= 8; p += 8)
+        {
+            uint64_t w;
+            memcpy(&w, p, 8);
+            h = (rotl64(h ^ (rotl64(w * prime2, 31) * prime1), 27) * prime1) + prime2;
+        }
+        for (; p < end; ++p)
+            h = rotl64(h ^ (*p * prime1), 11) * prime2;
+        return mix64(h);
+    }
+
+    bool hashFile(const string &path, uint64_t *hash, uint64_t seed)
+    {
+        mappedFile_t file;
+        if (!file.open(path)) return false;
+        *hash = hashBytes(file.data, file.size, seed);
+        return true;
+    }
+
+    bool fileStamp(const string &path, uint64_t *size, uint64_t *modified)
+    {
+        #ifdef _WIN32
+        WIN32_FILE_ATTRIBUTE_DATA attributes;
+        if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes)) return false;
+        *size = ((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+        // 100 ns ticks
+        *modified = (((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime) * 100;
+        #else
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) return false;
+        *size = (uint64_t)st.st_size;
+        #ifdef __APPLE__
+        *modified = ((uint64_t)st.st_mtimespec.tv_sec * 1000000000ull) + (uint64_t)st.st_mtimespec.tv_nsec;
+        #else
+        *modified = ((uint64_t)st.st_mtim.tv_sec * 1000000000ull) + (uint64_t)st.st_mtim.tv_nsec;
+        #endif // __APPLE__
+        #endif // _WIN32
+        return true;
+    }
+}
@@ -0,0 +1,79 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+
+#ifndef LAK_MAPPED_FILE_H
+#define LAK_MAPPED_FILE_H
+
+namespace lak
+{
+    using std::string;
+
+    // read only memory mapped file
+    struct mappedFile_t
+    {
+        // readonly
+        const uint8_t *data = nullptr;  // nullptr for empty files
+        size_t size = 0;
+
+        mappedFile_t() {}
+        mappedFile_t(const string &path) { open(path); }
+        mappedFile_t(const mappedFile_t&) = delete;
+        mappedFile_t &operator=(const mappedFile_t&) = delete;
+        ~mappedFile_t() { close(); }
+
+        bool open(const string &path);
+        void close();
+        inline bool isOpen() const { return _open; }
+
+        bool _open = false;
+        #ifdef _WIN32
+        void *_file = nullptr;
+        void *_mapping = nullptr;
+        #endif // _WIN32
+    };
+
+    // fast non-cryptographic 64 bit hash, for spotting changed data
+    uint64_t hashBytes(const void *data, size_t size, uint64_t seed = 0);
+
+    // maps path and hashes its contents, returns false if it can't be opened
+    bool hashFile(const string &path, uint64_t *hash, uint64_t seed = 0);
+
+    // size and last modification time (in ns) of path without reading it,
+    // cheaper than hashFile for spotting changes to big files but fooled by
+    // tools that preserve the time stamp
+    bool fileStamp(const string &path, uint64_t *size, uint64_t *modified);
+}
+
+#ifdef LAK_MAPPED_FILE_IMPLEM
+#   ifndef LAK_MAPPED_FILE_HAS_IMPLEM
+#       define LAK_MAPPED_FILE_HAS_IMPLEM
+#       include "utils/mapped_file.cpp"
+#   endif // LAK_MAPPED_FILE_HAS_IMPLEM
+#endif // LAK_MAPPED_FILE_IMPLEM
+
+#endif // LAK_MAPPED_FILE_H
@@ -0,0 +1,166 @@
+/*
+MIT License
+
+Copyright (c) 2018 LAK132
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <vector>
+#include <string>
+#include <cstring>
+
+#include "utils/obj.h"
+#include "utils/mapped_file.h"
+
+#ifndef LAK_MTL_H
+#define LAK_MTL_H
+
+namespace lak
+{
+    using std::vector;
+    using std::string;
+
+    // one newmtl block of a .mtl file. map paths are as written in the file,
+    // which makes them relative to the .mtl, empty if unused
+    struct objMaterial_t
+    {
+        string name;
+        float ambient[3] = {0.0f, 0.0f, 0.0f};  // Ka
+        float diffuse[3] = {1.0f, 1.0f, 1.0f};  // Kd
+        float specular[3] = {0.0f, 0.0f, 0.0f}; // Ks
+        float emissive[3] = {0.0f, 0.0f, 0.0f}; // Ke
+        float shininess = 0.0f;                 // Ns
+        float opacity = 1.0f;                   // d (or 1 - Tr)
+        float ior = 1.0f;                       // Ni
+        int illum = 2;
+        string ambientMap;                      // map_Ka
+        string diffuseMap;                      // map_Kd
+        string specularMap;                     // map_Ks
+        string emissiveMap;                     // map_Ke
+        string alphaMap;                        // map_d
+        string bumpMap;                         // map_Bump, bump or norm
+        float bumpScale = 1.0f;                 // -bm option of the bump map
+    };
+
+    // skips the options in front of a map's file name (-o 0 0 0 -clamp on
+    // etc), keeping -bm if scale isn't null, and returns the name
+    inline string _mtlMap(const char *p, const char *end, float *scale)
+    {
+        auto token = [&](const char *&s) {
+            while (s < end && (*s == ' ' || *s == '\t')) ++s;
+            const char *t = s;
+            while (s < end && *s != ' ' && *s != '\t') ++s;
+            return string(t, s);
+        };
+        while (end > p && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) --end;
+        for (;;)
+        {
+            const char *s = p;
+            const string option = token(s);
+            if (option.size() < 2 || option[0] != '-') break;
+            double d;
+            if (option == "-bm" && objNumber(s, end, &d))
+            {
+                if (scale != nullptr) *scale = (float)d;
+            }
+            else if (option == "-o" || option == "-s" || option == "-t" || option == "-mm")
+            {
+                // up to 3 numbers
+                for (int i = 0; i < 3 && objNumber(s, end, &d); ++i) {}
+            }
+            else token(s); // everything else takes a single argument
+            p = s;
+        }
+        while (p < end && (*p == ' ' || *p == '\t')) ++p;
+        return string(p, end);
+    }
+
+    // parses the .mtl in [begin, end), appending its materials to materials
+    inline void readMTL(const char *begin, const char *end, vector<objMaterial_t> *materials)
+    {
+        objMaterial_t *material = nullptr;
+        objMaterial_t ignored;  // for lines before the first newmtl
+        auto numbers = [](const char *p, const char *lineEnd, float *out, size_t count) {
+            double d;
+            size_t read = 0;
+            for (; read < count && objNumber(p, lineEnd, &d); ++read) out[read] = (float)d;
+            // a single value sets all the channels
+            for (size_t i = read; read == 1 && i < count; ++i) out[i] = out[0];
+        };
+
+        for (const char *line = begin; line < end;)
+        {
+            const char *lineEnd = (const char*)memchr(line, '\n', end - line);
+            if (lineEnd == nullptr) lineEnd = end;
+            const char *p = line;
+            line = lineEnd + 1;
+            while (p < lineEnd && (*p == ' ' || *p == '\t')) ++p;
+            const char *keyEnd = p;
+            while (keyEnd < lineEnd && *keyEnd != ' ' && *keyEnd != '\t' && *keyEnd != '\r') ++keyEnd;
+            if (keyEnd == p || *p == '#') continue;
+            const string key(p, keyEnd);
+            p = keyEnd;
+            // keywords aren't consistently capitalised between exporters
+            auto is = [&](const char *name) {
+                size_t i = 0;
+                for (; i < key.size() && name[i]; ++i)
+                    if ((key[i] | 0x20) != (name[i] | 0x20)) return false;
+                return i == key.size() && name[i] == 0;
+            };
+
+            if (is("newmtl"))
+            {
+                materials->emplace_back();
+                material = &materials->back();
+                material->name = _mtlMap(p, lineEnd, nullptr);
+                continue;
+            }
+            objMaterial_t &m = material != nullptr ? *material : ignored;
+            float value = 0.0f;
+            if (is("Ka")) numbers(p, lineEnd, m.ambient, 3);
+            else if (is("Kd")) numbers(p, lineEnd, m.diffuse, 3);
+            else if (is("Ks")) numbers(p, lineEnd, m.specular, 3);
+            else if (is("Ke")) numbers(p, lineEnd, m.emissive, 3);
+            else if (is("Ns")) numbers(p, lineEnd, &m.shininess, 1);
+            else if (is("Ni")) numbers(p, lineEnd, &m.ior, 1);
+            else if (is("d")) numbers(p, lineEnd, &m.opacity, 1);
+            else if (is("Tr")) { numbers(p, lineEnd, &value, 1); m.opacity = 1.0f - value; }
+            else if (is("illum")) { numbers(p, lineEnd, &value, 1); m.illum = (int)value; }
+            else if (is("map_Ka")) m.ambientMap = _mtlMap(p, lineEnd, nullptr);
+            else if (is("map_Kd")) m.diffuseMap = _mtlMap(p, lineEnd, nullptr);
+            else if (is("map_Ks")) m.specularMap = _mtlMap(p, lineEnd, nullptr);
+            else if (is("map_Ke")) m.emissiveMap = _mtlMap(p, lineEnd, nullptr);
+            else if (is("map_d")) m.alphaMap = _mtlMap(p, lineEnd, nullptr);
+            else if (is("map_Bump") || is("bump") || is("norm")) m.bumpMap = _mtlMap(p, lineEnd, &m.bumpScale);
+        }
+    }
+
+    // memory maps path and parses it, returns false if it can't be opened
+    inline bool readMTL(const string &path, vector<objMaterial_t> *materials)
+    {
+        mappedFile_t file;
+        if (!file.open(path)) return false;
+        const char *data = (const char*)file.data;
+        readMTL(data, data + file.size, materials);
+        return true;
+    }
+}
+
+#endif // LAK_MTL_H
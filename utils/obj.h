@@ -26,8 +26,17 @@ SOFTWARE.
 #include <tuple>
 #include <iostream>
 #include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <type_traits>
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 
 #include "utils/stream.h"
+#include "utils/mapped_file.h"
 
 #ifndef LAK_OBJ_H
 #define LAK_OBJ_H
@@ -76,128 +85,740 @@ namespace lak
         if (normals != nullptr) *normals = _normals;
     }
 
+    static const uint32_t objNone = 0xFFFFFFFF;
+
+    // one corner of a triangle, objNone for missing indices
+    struct objCorner_t
+    {
+        uint32_t v = objNone;
+        uint32_t vt = objNone;
+        uint32_t vn = objNone;
+    };
+
+    // flat alternative to the vector of vectors of tuples readOBJ can fill,
+    // one allocation for all the faces instead of one per triangle
+    struct objFaces_t
+    {
+        // params
+        bool ids = false;               // fill group, material and smoothing
+        // readonly
+        vector<objCorner_t> corners;    // 3 per triangle
+        vector<uint32_t> group;         // per triangle index into groups, objNone before the first g
+        vector<uint32_t> material;      // per triangle index into materials, objNone before the first usemtl
+        vector<uint32_t> smoothing;     // per triangle smoothing group, 0 for off
+        vector<string> groups;
+        vector<string> materials;
+        vector<string> libraries;       // mtllib files, in the order they were first used
+        inline size_t size() const { return corners.size() / 3; }
+        inline void clear() { corners.clear(); group.clear(); material.clear(); smoothing.clear(); groups.clear(); materials.clear(); libraries.clear(); }
+    };
+
+    // corner c of triangle t as a (v, vt, vn) triple
+    inline tuple<size_t, size_t, size_t> _objCorner(const vector<vector<tuple<size_t, size_t, size_t>>> &faces, size_t t, size_t c) { return faces[t][c]; }
+    inline tuple<size_t, size_t, size_t> _objCorner(const objFaces_t &faces, size_t t, size_t c)
+    {
+        const objCorner_t &corner = faces.corners[(t * 3) + c];
+        return tuple<size_t, size_t, size_t>{corner.v, corner.vt, corner.vn};
+    }
+    inline size_t _objFaceCount(const vector<vector<tuple<size_t, size_t, size_t>>> &faces) { return faces.size(); }
+    inline size_t _objFaceCount(const objFaces_t &faces) { return faces.size(); }
+
+    // one interleaved vertex produced by indexOBJ
     template <typename vert_t, typename uvw_t, typename norm_t>
-    void readOBJ(istream& strm, vector<vert_t>* verts, vector<uvw_t>* uvw, vector<norm_t>* normals, vector<vector<tuple<size_t, size_t, size_t>>>* indices, size_t* vertCount)
+    struct objVertex_t
     {
-        streampos start = strm.tellg();
-        size_t vcount = 0, vtcount = 0, vncount = 0, fcount = 0;
-        skipAll(strm, " \r\n\t");
-        while (strm.good())
-        {
-            string command;
-            strm >> command;
-            if (command == "v") ++vcount;
-            else if (command == "vt") ++vtcount;
-            else if (command == "vn") ++vncount;
-            else if (command == "f") ++fcount;
-            skipOne(strm, "\n"); // skip to end of line
-            skipAll(strm, " \r\n\t"); // skip to next non-whitespace character
-        }
-        strm.clear();
-        strm.seekg(start);
+        vert_t position;
+        uvw_t uvw;
+        norm_t normal;
+    };
 
-        if (verts != nullptr) { verts->clear(); verts->reserve(vcount); }
-        if (uvw != nullptr) { uvw->clear(); uvw->reserve(vtcount); }
-        if (normals != nullptr) { normals->clear(); normals->reserve(vncount); }
-        if (indices != nullptr) { indices->clear(); indices->reserve(fcount); }
+    // turns the per corner (v, vt, vn) triples from readOBJ into unique
+    // interleaved vertices and a triangle index buffer (usable as
+    // mesh_t::index). any of verts, uvw and normals may be null, their part
+    // of each vertex is then zeroed and ignored when deduplicating, as are
+    // out of range indices. faces is either output format of readOBJ
+    template <typename vert_t, typename uvw_t, typename norm_t, typename faces_t>
+    void indexOBJ(const vector<vert_t>* verts, const vector<uvw_t>* uvw, const vector<norm_t>* normals, const faces_t& indices, vector<objVertex_t<vert_t, uvw_t, norm_t>>* vertices, vector<uint32_t>* index)
+    {
+        using key_t = tuple<size_t, size_t, size_t>;
+        static const uint32_t empty = 0xFFFFFFFF;
+        const size_t none = (size_t)-1;
+        auto clean = [&](const key_t &corner) -> key_t {
+            const size_t v = std::get<0>(corner), vt = std::get<1>(corner), vn = std::get<2>(corner);
+            return key_t{
+                verts != nullptr && v < verts->size() ? v : none,
+                uvw != nullptr && vt < uvw->size() ? vt : none,
+                normals != nullptr && vn < normals->size() ? vn : none};
+        };
+        auto hash = [](const key_t &key) {
+            uint64_t h = (uint64_t)std::get<0>(key) * 0x9E3779B97F4A7C15ull;
+            h ^= (uint64_t)std::get<1>(key) * 0xC2B2AE3D27D4EB4Full;
+            h ^= (uint64_t)std::get<2>(key) * 0x165667B19E3779F9ull;
+            return h ^ (h >> 29);
+        };
 
-        size_t vercount = 0;
+        // closed meshes have about half as many unique vertices as faces, so
+        // start with room for that at under half load and grow if needed
+        const size_t faceCount = _objFaceCount(indices);
+        size_t capacity = 16;
+        while (capacity < faceCount) capacity <<= 1;
+        vector<uint32_t> table(capacity, empty);
+        vector<key_t> keys;
+        keys.reserve(faceCount / 2);
 
-        skipAll(strm, " \r\n\t");
-        while (strm.good())
+        index->clear();
+        index->reserve(faceCount * 3);
+        for (size_t t = 0; t < faceCount; ++t)
         {
-            string command;
-            strm >> command;
-            if (command == "v")
+            for (size_t c = 0; c < 3; ++c)
             {
-                if (verts != nullptr)
+                const key_t key = clean(_objCorner(indices, t, c));
+                size_t slot = hash(key) & (capacity - 1);
+                while (table[slot] != empty && keys[table[slot]] != key)
+                    slot = (slot + 1) & (capacity - 1);
+                if (table[slot] == empty)
                 {
-                    vert_t v;
-                    v[0] = getNumber<decltype(v[0])>(strm);
-                    v[1] = getNumber<decltype(v[1])>(strm);
-                    v[2] = getNumber<decltype(v[2])>(strm);
-                    verts->push_back(v);
+                    table[slot] = (uint32_t)keys.size();
+                    keys.push_back(key);
+                    if (keys.size() * 2 > capacity)
+                    {
+                        capacity <<= 1;
+                        table.assign(capacity, empty);
+                        for (uint32_t k = 0; k < keys.size(); ++k)
+                        {
+                            size_t s = hash(keys[k]) & (capacity - 1);
+                            while (table[s] != empty) s = (s + 1) & (capacity - 1);
+                            table[s] = k;
+                        }
+                    }
+                    index->push_back((uint32_t)keys.size() - 1);
                 }
+                else index->push_back(table[slot]);
+            }
+        }
+
+        vertices->resize(keys.size());
+        for (size_t k = 0; k < keys.size(); ++k)
+        {
+            auto &vertex = (*vertices)[k];
+            vertex = {};
+            if (std::get<0>(keys[k]) != none) vertex.position = (*verts)[std::get<0>(keys[k])];
+            if (std::get<1>(keys[k]) != none) vertex.uvw = (*uvw)[std::get<1>(keys[k])];
+            if (std::get<2>(keys[k]) != none) vertex.normal = (*normals)[std::get<2>(keys[k])];
+        }
+    }
+
+    // locale independent number parsing for readOBJ, skips leading spaces
+    // and advances p past the number. returns false (leaving p alone) if
+    // there isn't one before end
+    inline bool objNumber(const char *&p, const char *end, double *out)
+    {
+        static const double pow10[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        const char *s = p;
+        while (s < end && (*s == ' ' || *s == '\t')) ++s;
+        bool negative = false;
+        if (s < end && (*s == '-' || *s == '+')) negative = *s++ == '-';
+
+        // up to 19 significant digits fit in the mantissa, the rest only
+        // move the exponent
+        uint64_t mantissa = 0;
+        int exponent = 0;
+        int digits = 0;
+        bool any = false;
+        for (; s < end && (unsigned)(*s - '0') < 10; ++s, any = true)
+        {
+            if (digits < 19) { mantissa = (mantissa * 10) + (*s - '0'); if (mantissa) ++digits; }
+            else ++exponent;
+        }
+        if (s < end && *s == '.')
+        {
+            for (++s; s < end && (unsigned)(*s - '0') < 10; ++s, any = true)
+            {
+                if (digits < 19) { mantissa = (mantissa * 10) + (*s - '0'); if (mantissa) ++digits; --exponent; }
+            }
+        }
+        if (!any)
+        {
+            // inf/nan and friends are rare enough to leave to strtod
+            if (s >= end || (*s != 'i' && *s != 'I' && *s != 'n' && *s != 'N')) return false;
+            const char *word = s;
+            while (s < end && ((*s | 0x20) >= 'a' && (*s | 0x20) <= 'z')) ++s;
+            string text(word, s);
+            char *used = nullptr;
+            const double value = std::strtod(text.c_str(), &used);
+            if (used == text.c_str()) return false;
+            *out = negative ? -value : value;
+            p = word + (used - text.c_str());
+            return true;
+        }
+        if (s < end && (*s == 'e' || *s == 'E'))
+        {
+            const char *e = s + 1;
+            bool negativeExp = false;
+            if (e < end && (*e == '-' || *e == '+')) negativeExp = *e++ == '-';
+            if (e < end && (unsigned)(*e - '0') < 10)
+            {
+                int value = 0;
+                for (; e < end && (unsigned)(*e - '0') < 10; ++e)
+                    if (value < 10000) value = (value * 10) + (*e - '0');
+                exponent += negativeExp ? -value : value;
+                s = e;
+            }
+        }
+
+        double value = (double)mantissa;
+        if (mantissa == 0) {}
+        else if (exponent < 0 && exponent >= -22) value /= pow10[-exponent];
+        else if (exponent >= 0 && exponent <= 22) value *= pow10[exponent];
+        else value *= std::pow(10.0, (double)exponent);
+        *out = negative ? -value : value;
+        p = s;
+        return true;
+    }
+
+    // face index for readOBJ, negative indices count back from the most
+    // recent element (count is the number read so far), relative (if not
+    // null) is set for them
+    inline bool objIndex(const char *&p, const char *end, size_t count, size_t *out, bool *relative = nullptr)
+    {
+        const char *s = p;
+        while (s < end && (*s == ' ' || *s == '\t')) ++s;
+        bool negative = false;
+        if (s < end && (*s == '-' || *s == '+')) negative = *s++ == '-';
+        if (s >= end || (unsigned)(*s - '0') >= 10) return false;
+        size_t value = 0;
+        for (; s < end && (unsigned)(*s - '0') < 10; ++s)
+            value = (value * 10) + (*s - '0');
+        *out = negative ? count - value : value - 1;
+        if (relative != nullptr) *relative = negative;
+        p = s;
+        return true;
+    }
+
+    // objFaceCorner_t::flags
+    enum objCornerFlags_t : uint8_t
+    {
+        OBJ_HAS_VT = 1 << 0,
+        OBJ_HAS_VN = 1 << 1,
+        OBJ_RELATIVE_V = 1 << 2,    // the index was negative in the file
+        OBJ_RELATIVE_VT = 1 << 3,
+        OBJ_RELATIVE_VN = 1 << 4,
+    };
+
+    // one corner of a face as seen by visitOBJ, indices are 0 based and
+    // relative ones are already resolved. vt and vn are 0 unless flagged
+    struct objFaceCorner_t
+    {
+        size_t v = 0;
+        size_t vt = 0;
+        size_t vn = 0;
+        uint8_t flags = 0;
+    };
+
+    // callbacks for visitOBJ, derive from this and hide the ones you need
+    // (they are called directly, not virtually). values holds the numbers
+    // on the line (count of them, at most 8) so extensions like vertex
+    // colours come through. faces are given as written, n-gons aren't split
+    struct objVisitor_t
+    {
+        inline void onVertex(const double * /*values*/, size_t /*count*/) {}
+        inline void onTexcoord(const double * /*values*/, size_t /*count*/) {}
+        inline void onNormal(const double * /*values*/, size_t /*count*/) {}
+        inline void onFace(const objFaceCorner_t * /*corners*/, size_t /*count*/) {}
+        inline void onGroup(const string & /*name*/) {}
+        inline void onSmoothing(uint32_t /*group*/) {}         // 0 for off
+        inline void onUsemtl(const string & /*name*/) {}
+        inline void onMtllib(const string & /*path*/) {}   // once per file on the line
+    };
+
+    // v/vt/vn lines seen so far, relative indices are resolved against these
+    struct _objState_t
+    {
+        size_t v = 0, vt = 0, vn = 0;
+    };
+
+    template <typename visitor_t>
+    void _visitOBJ(const char *begin, const char *end, visitor_t &visitor, _objState_t &state)
+    {
+        vector<objFaceCorner_t> face;
+        double values[8];
+        auto numbers = [&](const char *p, const char *lineEnd) {
+            size_t count = 0;
+            while (count < 8 && objNumber(p, lineEnd, &values[count])) ++count;
+            return count;
+        };
+        auto name = [](const char *p, const char *lineEnd) {
+            while (p < lineEnd && (*p == ' ' || *p == '\t')) ++p;
+            while (lineEnd > p && (lineEnd[-1] == ' ' || lineEnd[-1] == '\t' || lineEnd[-1] == '\r')) --lineEnd;
+            return string(p, lineEnd);
+        };
+
+        for (const char *line = begin; line < end;)
+        {
+            const char *lineEnd = (const char*)memchr(line, '\n', end - line);
+            if (lineEnd == nullptr) lineEnd = end;
+            const char *p = line;
+            line = lineEnd + 1;
+            while (p < lineEnd && (*p == ' ' || *p == '\t')) ++p;
+            if (lineEnd - p < 2) continue;
+
+            const char c0 = p[0], c1 = p[1];
+            if (c0 == 'v' && (c1 == ' ' || c1 == '\t'))
+            {
+                ++state.v;
+                visitor.onVertex(values, numbers(p + 1, lineEnd));
+            }
+            else if (c0 == 'v' && c1 == 't')
+            {
+                ++state.vt;
+                visitor.onTexcoord(values, numbers(p + 2, lineEnd));
             }
-            else if (command == "vt")
+            else if (c0 == 'v' && c1 == 'n')
             {
-                if (uvw != nullptr)
+                ++state.vn;
+                visitor.onNormal(values, numbers(p + 2, lineEnd));
+            }
+            else if (c0 == 'f' && (c1 == ' ' || c1 == '\t'))
+            {
+                ++p;
+                face.clear();
+                objFaceCorner_t corner;
+                bool relative;
+                while (objIndex(p, lineEnd, state.v, &corner.v, &relative))
                 {
-                    uvw_t u;
-                    u[0] = getNumber<decltype(u[0])>(strm);
-                    u[1] = getNumber<decltype(u[1])>(strm);
-                    if (sizeof(uvw_t) >= sizeof(u[0]) * 3)
+                    // v, v/vt, v//vn or v/vt/vn
+                    corner.vt = corner.vn = 0;
+                    corner.flags = relative ? OBJ_RELATIVE_V : 0;
+                    if (p < lineEnd && *p == '/')
                     {
-                        skipAll(strm, " \t");
-                        char c;
-                        if ((c = strm.peek()) != '\r' && c != '\n')
-                            u[2] = getNumber<decltype(u[2])>(strm);
-                        else u[2] = 0.0f;
+                        ++p;
+                        if (p < lineEnd && *p != '/' && objIndex(p, lineEnd, state.vt, &corner.vt, &relative))
+                            corner.flags |= OBJ_HAS_VT | (relative ? OBJ_RELATIVE_VT : 0);
+                        if (p < lineEnd && *p == '/' && (++p, objIndex(p, lineEnd, state.vn, &corner.vn, &relative)))
+                            corner.flags |= OBJ_HAS_VN | (relative ? OBJ_RELATIVE_VN : 0);
                     }
-                    uvw->push_back(u);
+                    face.push_back(corner);
+                }
+                if (!face.empty()) visitor.onFace(face.data(), face.size());
+            }
+            else if (c0 == 'g' && (c1 == ' ' || c1 == '\t'))
+            {
+                visitor.onGroup(name(p + 1, lineEnd));
+            }
+            else if (c0 == 's' && (c1 == ' ' || c1 == '\t'))
+            {
+                // "s off" and "s 0" both turn smoothing off
+                size_t group = (size_t)-1;
+                const char *s = p + 1;
+                objIndex(s, lineEnd, 0, &group);
+                visitor.onSmoothing((uint32_t)(group + 1));
+            }
+            else if (c0 == 'u' && lineEnd - p > 7 && memcmp(p, "usemtl", 6) == 0 && (p[6] == ' ' || p[6] == '\t'))
+            {
+                visitor.onUsemtl(name(p + 6, lineEnd));
+            }
+            else if (c0 == 'm' && lineEnd - p > 7 && memcmp(p, "mtllib", 6) == 0 && (p[6] == ' ' || p[6] == '\t'))
+            {
+                for (p += 6; p < lineEnd;)
+                {
+                    while (p < lineEnd && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+                    const char *file = p;
+                    while (p < lineEnd && *p != ' ' && *p != '\t' && *p != '\r') ++p;
+                    if (p > file) visitor.onMtllib(string(file, p));
                 }
             }
-            else if (command == "vn")
+            // everything else (comments, objects) is skipped
+        }
+    }
+
+    // calls visitor (see objVisitor_t) for each line of the .obj in
+    // [begin, end) without storing anything
+    template <typename visitor_t>
+    void visitOBJ(const char *begin, const char *end, visitor_t &visitor)
+    {
+        _objState_t state;
+        _visitOBJ(begin, end, visitor, state);
+    }
+
+    // streams strm through visitor blockSize bytes at a time, so memory use
+    // is bounded by the block size (or the longest line if that's bigger)
+    template <typename visitor_t>
+    void visitOBJ(istream &strm, visitor_t &visitor, size_t blockSize = 1 << 20)
+    {
+        _objState_t state;
+        vector<char> block(std::max<size_t>(blockSize, 1));
+        size_t kept = 0;
+        while (strm.good())
+        {
+            if (kept == block.size()) block.resize(block.size() * 2);
+            strm.read(block.data() + kept, block.size() - kept);
+            const size_t filled = kept + (size_t)strm.gcount();
+            // only complete lines are parsed, the rest waits for more data
+            size_t complete = filled;
+            if (strm.good())
+            {
+                while (complete > 0 && block[complete - 1] != '\n') --complete;
+            }
+            _visitOBJ(block.data(), block.data() + complete, visitor, state);
+            kept = filled - complete;
+            memmove(block.data(), block.data() + complete, kept);
+        }
+    }
+
+    // memory maps path and visits it, returns false if it can't be opened
+    template <typename visitor_t>
+    bool visitOBJ(const string &path, visitor_t &visitor)
+    {
+        mappedFile_t file;
+        if (!file.open(path)) return false;
+        const char *data = (const char*)file.data;
+        visitOBJ(data, data + file.size, visitor);
+        return true;
+    }
+
+    // face output helpers so _objReader_t can fill either format
+    inline void _objAddFace(vector<vector<tuple<size_t, size_t, size_t>>> *faces, const objFaceCorner_t *corners, uint32_t, uint32_t, uint32_t)
+    {
+        faces->push_back({
+            {corners[0].v, corners[0].vt, corners[0].vn},
+            {corners[1].v, corners[1].vt, corners[1].vn},
+            {corners[2].v, corners[2].vt, corners[2].vn}});
+    }
+    inline void _objAddFace(objFaces_t *faces, const objFaceCorner_t *corners, uint32_t group, uint32_t material, uint32_t smoothing)
+    {
+        for (size_t c = 0; c < 3; ++c)
+        {
+            objCorner_t corner;
+            corner.v = (uint32_t)corners[c].v;
+            if (corners[c].flags & OBJ_HAS_VT) corner.vt = (uint32_t)corners[c].vt;
+            if (corners[c].flags & OBJ_HAS_VN) corner.vn = (uint32_t)corners[c].vn;
+            faces->corners.push_back(corner);
+        }
+        if (faces->ids)
+        {
+            faces->group.push_back(group);
+            faces->material.push_back(material);
+            faces->smoothing.push_back(smoothing);
+        }
+    }
+    inline vector<string> *_objNames(vector<vector<tuple<size_t, size_t, size_t>>> *, bool) { return nullptr; }
+    inline vector<string> *_objNames(objFaces_t *faces, bool material)
+    {
+        if (!faces->ids) return nullptr;
+        return material ? &faces->materials : &faces->groups;
+    }
+    inline void _objAddLibrary(vector<vector<tuple<size_t, size_t, size_t>>> *, const string &) {}
+    inline void _objAddLibrary(objFaces_t *faces, const string &path)
+    {
+        if (faces == nullptr || !faces->ids) return;
+        if (std::find(faces->libraries.begin(), faces->libraries.end(), path) == faces->libraries.end())
+            faces->libraries.push_back(path);
+    }
+    inline void _objClear(vector<vector<tuple<size_t, size_t, size_t>>> *faces) { faces->clear(); }
+    inline void _objClear(objFaces_t *faces) { faces->clear(); }
+
+    // group/material inherited from the previous chunk (see readOBJParallel)
+    static const uint32_t _objInherit = 0xFFFFFFFE;
+
+    // the visitor behind readOBJ, appends to the outputs. if relative isn't
+    // null the position of each relative index ((face * 3 + corner) * 3 +
+    // component, from the start of indices) is recorded so chunks parsed on
+    // their own can be fixed up later
+    template <typename vert_t, typename uvw_t, typename norm_t, typename faces_t>
+    struct _objReader_t : public objVisitor_t
+    {
+        vector<vert_t>* verts;
+        vector<uvw_t>* uvw;
+        vector<norm_t>* normals;
+        faces_t* indices;
+        vector<size_t> *relative = nullptr;
+        uint32_t group = objNone;
+        uint32_t material = objNone;
+        uint32_t smoothing = 0;
+        std::unordered_map<string, uint32_t> ids[2];    // group and material names
+
+        _objReader_t(vector<vert_t>* v, vector<uvw_t>* t, vector<norm_t>* n, faces_t* f)
+        : verts(v), uvw(t), normals(n), indices(f) {}
+
+        template <typename T>
+        static void store(vector<T> *out, const double *values, size_t count, size_t components)
+        {
+            if (out == nullptr) return;
+            T t{};
+            for (size_t i = 0; i < components && i < count; ++i)
+                t[i] = (std::remove_reference_t<decltype(t[0])>)values[i];
+            out->push_back(t);
+        }
+        inline void onVertex(const double *values, size_t count) { store(verts, values, count, 3); }
+        inline void onTexcoord(const double *values, size_t count) { store(uvw, values, count, sizeof(uvw_t) >= sizeof(std::declval<uvw_t&>()[0]) * 3 ? 3 : 2); }
+        inline void onNormal(const double *values, size_t count) { store(normals, values, count, 3); }
+        inline void onFace(const objFaceCorner_t *corners, size_t count)
+        {
+            if (indices == nullptr) return;
+            objFaceCorner_t triangle[3];
+            for (size_t i = 2; i < count; ++i)
             {
-                if (normals != nullptr)
+                triangle[0] = corners[0];
+                triangle[1] = corners[i - 1];
+                triangle[2] = corners[i];
+                if (relative != nullptr)
                 {
-                    norm_t n;
-                    n[0] = getNumber<decltype(n[0])>(strm);
-                    n[1] = getNumber<decltype(n[1])>(strm);
-                    n[2] = getNumber<decltype(n[2])>(strm);
-                    normals->push_back(n);
+                    const size_t first = _objFaceCount(*indices) * 9;
+                    for (size_t c = 0; c < 3; ++c)
+                    {
+                        if (triangle[c].flags & OBJ_RELATIVE_V) relative->push_back(first + (c * 3) + 0);
+                        if (triangle[c].flags & OBJ_RELATIVE_VT) relative->push_back(first + (c * 3) + 1);
+                        if (triangle[c].flags & OBJ_RELATIVE_VN) relative->push_back(first + (c * 3) + 2);
+                    }
                 }
+                _objAddFace(indices, triangle, group, material, smoothing);
+            }
+        }
+        inline void name(const string &name, bool isMaterial)
+        {
+            vector<string> *names = indices != nullptr ? _objNames(indices, isMaterial) : nullptr;
+            if (names == nullptr) return;
+            const auto it = ids[isMaterial].emplace(name, (uint32_t)names->size());
+            if (it.second) names->push_back(name);
+            (isMaterial ? material : group) = it.first->second;
+        }
+        inline void onGroup(const string &n) { name(n, false); }
+        inline void onSmoothing(uint32_t s) { smoothing = s; }
+        inline void onUsemtl(const string &n) { name(n, true); }
+        inline void onMtllib(const string &path) { _objAddLibrary(indices, path); }
+    };
+
+    // parses the .obj in [begin, end) in a single pass, n-gons are split into
+    // fans of triangles. indices can be a vector of vectors of tuples (with
+    // missing indices set to 0) or an objFaces_t. vertCount (if not null) is
+    // the number of face corners, which is the vertex count noIndexOBJ will
+    // produce
+    template <typename vert_t, typename uvw_t, typename norm_t, typename faces_t>
+    void readOBJ(const char *begin, const char *end, vector<vert_t>* verts, vector<uvw_t>* uvw, vector<norm_t>* normals, faces_t* indices, size_t* vertCount)
+    {
+        if (verts != nullptr) verts->clear();
+        if (uvw != nullptr) uvw->clear();
+        if (normals != nullptr) normals->clear();
+        if (indices != nullptr) _objClear(indices);
+        _objReader_t<vert_t, uvw_t, norm_t, faces_t> reader(verts, uvw, normals, indices);
+        visitOBJ(begin, end, reader);
+        if (vertCount != nullptr) *vertCount = indices != nullptr ? _objFaceCount(*indices) * 3 : 0;
+    }
+
+    // same as readOBJ but splits [begin, end) at line breaks into a chunk per
+    // thread (threads = 0 uses one per hardware thread). each chunk is parsed
+    // on its own and then copied into place in parallel, with the indices
+    // that were relative to the chunk offset by the counts before it.
+    // chunks are at least minChunk bytes so small files stay single threaded
+    template <typename vert_t, typename uvw_t, typename norm_t, typename faces_t>
+    void readOBJParallel(const char *begin, const char *end, vector<vert_t>* verts, vector<uvw_t>* uvw, vector<norm_t>* normals, faces_t* indices, size_t* vertCount, size_t threads = 0, size_t minChunk = 1 << 20)
+    {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = std::max<size_t>(1, std::min(threads, (size_t)(end - begin) / std::max<size_t>(minChunk, 1)));
+        if (threads == 1)
+        {
+            readOBJ(begin, end, verts, uvw, normals, indices, vertCount);
+            return;
+        }
+        constexpr bool flat = std::is_same<faces_t, objFaces_t>::value;
+
+        struct chunk_t
+        {
+            const char *begin, *end;
+            vector<vert_t> verts;
+            vector<uvw_t> uvw;
+            vector<norm_t> normals;
+            faces_t indices;
+            vector<size_t> relative;
+            _objState_t counts;     // within the chunk
+            _objState_t base;       // before the chunk
+            uint32_t group = objNone, material = objNone, smoothing = 0;            // active at the end of the chunk
+            uint32_t baseGroup = objNone, baseMaterial = objNone, baseSmoothing = 0; // active before the chunk
+            size_t faceBase = 0;
+            vector<uint32_t> remap[2];  // group/material ids to the merged ones
+        };
+        vector<chunk_t> chunks(threads);
+        const size_t step = (end - begin) / threads;
+        const char *split = begin;
+        for (size_t t = 0; t < threads; ++t)
+        {
+            auto &chunk = chunks[t];
+            chunk.begin = split;
+            split = t + 1 == threads ? end : std::max(split, begin + (step * (t + 1)));
+            if (split < end)
+            {
+                const char *newline = (const char*)memchr(split, '\n', end - split);
+                split = newline == nullptr ? end : newline + 1;
             }
-            else if (command == "f")
+            chunk.end = split;
+            if constexpr (flat) chunk.indices.ids = indices != nullptr && indices->ids;
+        }
+
+        auto run = [&](auto &&func) {
+            vector<std::thread> workers;
+            workers.reserve(threads - 1);
+            for (size_t t = 1; t < threads; ++t) workers.emplace_back(func, t);
+            func(0);
+            for (auto &worker : workers) worker.join();
+        };
+
+        run([&](size_t t) {
+            auto &chunk = chunks[t];
+            _objReader_t<vert_t, uvw_t, norm_t, faces_t> reader(
+                verts != nullptr ? &chunk.verts : nullptr, uvw != nullptr ? &chunk.uvw : nullptr,
+                normals != nullptr ? &chunk.normals : nullptr, indices != nullptr ? &chunk.indices : nullptr);
+            reader.relative = &chunk.relative;
+            if (t > 0) reader.group = reader.material = reader.smoothing = _objInherit;
+            _visitOBJ(chunk.begin, chunk.end, reader, chunk.counts);
+            chunk.group = reader.group;
+            chunk.material = reader.material;
+            chunk.smoothing = reader.smoothing;
+        });
+
+        // prefix sums give each chunk its place in the outputs
+        _objState_t total;
+        size_t faces = 0;
+        for (auto &chunk : chunks)
+        {
+            chunk.base.v = total.v;
+            chunk.base.vt = total.vt;
+            chunk.base.vn = total.vn;
+            chunk.faceBase = faces;
+            total.v += chunk.counts.v;
+            total.vt += chunk.counts.vt;
+            total.vn += chunk.counts.vn;
+            faces += _objFaceCount(chunk.indices);
+        }
+        if (verts != nullptr) { verts->clear(); verts->resize(total.v); }
+        if (uvw != nullptr) { uvw->clear(); uvw->resize(total.vt); }
+        if (normals != nullptr) { normals->clear(); normals->resize(total.vn); }
+        if (indices != nullptr)
+        {
+            _objClear(indices);
+            if constexpr (flat)
             {
-                if (indices != nullptr)
+                indices->corners.resize(faces * 3);
+                if (indices->ids)
                 {
-                    indices->push_back({});
-                    size_t face = indices->size()-1;
-                    (*indices)[face].reserve(3);
-                    char c;
-                    do
+                    indices->group.resize(faces);
+                    indices->material.resize(faces);
+                    indices->smoothing.resize(faces);
+                    // merge the names and work out which group/material/
+                    // smoothing group is active at the start of each chunk
+                    std::unordered_map<string, uint32_t> ids[2];
+                    vector<string> *names[2] = {&indices->groups, &indices->materials};
+                    uint32_t active[2] = {objNone, objNone};
+                    uint32_t smoothing = 0;
+                    for (auto &chunk : chunks)
                     {
-                        size_t v = getNumber<size_t>(strm); --v;
-                        size_t vt = 0, vn = 0;
-                        skipAll(strm, " \t");
-                        if (strm.peek() == '/')
+                        chunk.baseSmoothing = smoothing;
+                        if (chunk.smoothing != _objInherit) smoothing = chunk.smoothing;
+                        const vector<string> *local[2] = {&chunk.indices.groups, &chunk.indices.materials};
+                        const uint32_t last[2] = {chunk.group, chunk.material};
+                        uint32_t *first[2] = {&chunk.baseGroup, &chunk.baseMaterial};
+                        for (int m = 0; m < 2; ++m)
                         {
-                            strm.get();
-                            skipAll(strm, " \t");
-                            if (strm.peek() != '/')
+                            for (const auto &name : *local[m])
                             {
-                                vt = getNumber<size_t>(strm); --vt;
-                                skipAll(strm, " \t");
-                            }
-                            if (strm.peek() == '/')
-                            {
-                                strm.get();
-                                vn = getNumber<size_t>(strm); --vn;
+                                const auto it = ids[m].emplace(name, (uint32_t)names[m]->size());
+                                if (it.second) names[m]->push_back(name);
+                                chunk.remap[m].push_back(it.first->second);
                             }
+                            *first[m] = active[m];
+                            if (last[m] != _objInherit) active[m] = last[m] == objNone ? objNone : chunk.remap[m][last[m]];
                         }
-                        skipAll(strm, " \t");
-                        (*indices)[face].push_back({v, vt, vn});
-                        ++vcount;
-                    } while ((c = strm.peek()) != '\r' && c != '\n' && strm.good());
-                    // split the face up if it happens to be an n-gon
-                    while ((*indices)[face].size() > 3)
-                    {
-                        indices->push_back({});
-                        auto &newface = indices->back();
-                        newface.reserve(3);
-                        newface.push_back((*indices)[face][0]);
-                        auto &&it = (*indices)[face].begin() + ((*indices)[face].size() - 2);
-                        newface.push_back(*(it++));
-                        newface.push_back(*(it++));
-                        (*indices)[face].pop_back();
+                        for (const auto &library : chunk.indices.libraries)
+                            _objAddLibrary(indices, library);
                     }
                 }
             }
-            skipOne(strm, "\n"); // skip to end of line
-            skipAll(strm, " \r\n\t"); // skip to next non-whitespace character
+            else indices->resize(faces);
         }
-        if (vertCount != nullptr) *vertCount = vercount;
+
+        run([&](size_t t) {
+            auto &chunk = chunks[t];
+            if (verts != nullptr) std::copy(chunk.verts.begin(), chunk.verts.end(), verts->begin() + chunk.base.v);
+            if (uvw != nullptr) std::copy(chunk.uvw.begin(), chunk.uvw.end(), uvw->begin() + chunk.base.vt);
+            if (normals != nullptr) std::copy(chunk.normals.begin(), chunk.normals.end(), normals->begin() + chunk.base.vn);
+            if (indices == nullptr) return;
+            // relative indices were resolved against the chunk's own counts,
+            // unsigned wrap around makes adding the base correct even when
+            // they pointed before the chunk
+            const size_t bases[3] = {chunk.base.v, chunk.base.vt, chunk.base.vn};
+            if constexpr (flat)
+            {
+                for (size_t r : chunk.relative)
+                {
+                    auto &corner = chunk.indices.corners[r / 3];
+                    uint32_t *component[3] = {&corner.v, &corner.vt, &corner.vn};
+                    *component[r % 3] += (uint32_t)bases[r % 3];
+                }
+                std::copy(chunk.indices.corners.begin(), chunk.indices.corners.end(), indices->corners.begin() + (chunk.faceBase * 3));
+                if (!indices->ids) return;
+                const vector<uint32_t> *local[2] = {&chunk.indices.group, &chunk.indices.material};
+                vector<uint32_t> *merged[2] = {&indices->group, &indices->material};
+                const uint32_t first[2] = {chunk.baseGroup, chunk.baseMaterial};
+                for (int m = 0; m < 2; ++m)
+                {
+                    for (size_t f = 0; f < local[m]->size(); ++f)
+                    {
+                        const uint32_t id = (*local[m])[f];
+                        (*merged[m])[chunk.faceBase + f] = id == _objInherit ? first[m] : id == objNone ? objNone : chunk.remap[m][id];
+                    }
+                }
+                for (size_t f = 0; f < chunk.indices.smoothing.size(); ++f)
+                {
+                    const uint32_t s = chunk.indices.smoothing[f];
+                    indices->smoothing[chunk.faceBase + f] = s == _objInherit ? chunk.baseSmoothing : s;
+                }
+            }
+            else
+            {
+                for (size_t r : chunk.relative)
+                {
+                    auto &corner = chunk.indices[r / 9][(r / 3) % 3];
+                    switch (r % 3)
+                    {
+                        case 0: std::get<0>(corner) += bases[0]; break;
+                        case 1: std::get<1>(corner) += bases[1]; break;
+                        case 2: std::get<2>(corner) += bases[2]; break;
+                    }
+                }
+                std::move(chunk.indices.begin(), chunk.indices.end(), indices->begin() + chunk.faceBase);
+            }
+        });
+
+        if (vertCount != nullptr) *vertCount = indices != nullptr ? _objFaceCount(*indices) * 3 : 0;
+    }
+
+    // memory maps path and parses it (with readOBJParallel if threads isn't
+    // 1), returns false if it can't be opened
+    template <typename vert_t, typename uvw_t, typename norm_t, typename faces_t>
+    bool readOBJ(const string &path, vector<vert_t>* verts, vector<uvw_t>* uvw, vector<norm_t>* normals, faces_t* indices, size_t* vertCount, size_t threads = 1)
+    {
+        mappedFile_t file;
+        if (!file.open(path)) return false;
+        const char *data = (const char*)file.data;
+        if (threads == 1) readOBJ(data, data + file.size, verts, uvw, normals, indices, vertCount);
+        else readOBJParallel(data, data + file.size, verts, uvw, normals, indices, vertCount, threads);
+        return true;
+    }
+
+    // streams the rest of strm through the parser, strm is left where it started
+    template <typename vert_t, typename uvw_t, typename norm_t, typename faces_t>
+    void readOBJ(istream& strm, vector<vert_t>* verts, vector<uvw_t>* uvw, vector<norm_t>* normals, faces_t* indices, size_t* vertCount)
+    {
+        streampos start = strm.tellg();
+        if (verts != nullptr) verts->clear();
+        if (uvw != nullptr) uvw->clear();
+        if (normals != nullptr) normals->clear();
+        if (indices != nullptr) _objClear(indices);
+        _objReader_t<vert_t, uvw_t, norm_t, faces_t> reader(verts, uvw, normals, indices);
+        visitOBJ(strm, reader);
+        if (vertCount != nullptr) *vertCount = indices != nullptr ? _objFaceCount(*indices) * 3 : 0;
         strm.clear();
         strm.seekg(start);
     }